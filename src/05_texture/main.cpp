@@ -1,5 +1,8 @@
 #include <chrono>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <optional>
 
 #include <vma/vk_mem_alloc.h>
 
@@ -46,6 +49,38 @@ void main()
 }
 )___";
 
+// spir-v of the shaders. compiled without a device
+struct ShaderByteCode
+{
+    std::vector<uint32_t> vert;
+    std::vector<uint32_t> frag;
+};
+
+ShaderByteCode compileShaders()
+{
+    ShaderByteCode ret;
+
+    ret.vert = compileGLSLToSPIRV(
+        VERTEX_SHADER_SOURCE, "vertex shader", {},
+        agz::vlab::ShaderModuleType::Vertex, false);
+
+    ret.frag = compileGLSLToSPIRV(
+        FRAGMENT_SHADER_SOURCE, "fragment shader", {},
+        agz::vlab::ShaderModuleType::Fragment, false);
+
+    return ret;
+}
+
+using ImageData = decltype(agz::img::load_rgba_from_file(""));
+
+ImageData loadImage()
+{
+    auto imgData = agz::img::load_rgba_from_file("05_texture.png");
+    if(!imgData.is_available())
+        throw std::runtime_error("failed to load image data");
+    return imgData;
+}
+
 class TexturePipeline : public agz::misc::uncopyable_t
 {
     struct Vertex
@@ -88,14 +123,11 @@ class TexturePipeline : public agz::misc::uncopyable_t
 
     struct FrameResource
     {
-        vk::UniqueFramebuffer framebuffer;
         vk::CommandBuffer cmdBuf;
 
         vk::UniqueSemaphore imageSemaphore;
         vk::UniqueSemaphore renderSemaphore;
 
-        vk::UniqueFence frameFence;
-
         agz::vlab::VMAUniqueBuffer uniformBuf;
         vk::DescriptorSet descSet;
     };
@@ -120,7 +152,8 @@ class TexturePipeline : public agz::misc::uncopyable_t
 
     // vertex/index buffer
 
-    std::unique_ptr<agz::vlab::VMAAlloc> allocator_;
+    // shared by all windows on the device. not owner
+    agz::vlab::VMAAlloc *allocator_ = nullptr;
 
     agz::vlab::VMAUniqueBuffer vertexBuffer_;
     agz::vlab::VMAUniqueBuffer indexBuffer_;
@@ -136,16 +169,53 @@ class TexturePipeline : public agz::misc::uncopyable_t
 
     static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 3;
 
-    uint32_t currentFrame_ = 0;
+    // record once per (swapchain image, frame resource) pair and replay
+    // until the swapchain is recreated. only the ubo changes per frame
+    static constexpr bool USE_CACHED_COMMAND_BUFFERS = true;
+
+    // timeline semaphore based frame pacing. null if not supported,
+    // in which case frameCtx_ falls back to per-frame fences
+    std::unique_ptr<agz::vlab::FrameScheduler> scheduler_;
+
+    std::unique_ptr<agz::vlab::FrameContext> frameCtx_;
+
+    // adjusts frames in flight (up to MAX_FRAMES_IN_FLIGHT) and swapchain
+    // image count. used only with scheduler_
+    agz::vlab::FramePacingTuner framePacingTuner_{
+        agz::vlab::FramePacingDesc{ 1, MAX_FRAMES_IN_FLIGHT } };
+
+    std::chrono::steady_clock::time_point lastFrameStart_;
+
+    // gpu time of whole frames and of the main pass. null if timestamps
+    // are unsupported by the graphics queue
+    std::unique_ptr<agz::vlab::GpuProfiler> gpuProfiler_;
+
+    // opt-in draw counters. command buffers are not cached while enabled
+    // since queries are assigned at record time
+    std::unique_ptr<agz::vlab::PipelineStatsProfiler> pipelineStats_;
+
+    bool cacheCmdBufs_ = USE_CACHED_COMMAND_BUFFERS;
+
+    // animation state (rotation in radians), updated with fixed timestep
+
+    float prevAngle_ = 0;
+    float angle_     = 0;
+
+    std::unique_ptr<agz::vlab::CachedCommandBuffers> cachedCmdBufs_;
+
+    std::vector<vk::UniqueFramebuffer> framebuffers_;
 
     vk::UniqueCommandPool    cmdPool_;
     vk::UniqueDescriptorPool descPool_;
 
     std::vector<FrameResource> frameRscs_;
 
+    // staging buffers of the startup upload, released once it completes
+    using StagingBuffers = std::vector<agz::vlab::VMAUniqueBuffer>;
+
     agz::vlab::VMAUniqueBuffer createDeviceBuffer(
         size_t byteSize, vk::BufferUsageFlags usage, const void *initData,
-        const agz::vlab::Window &window)
+        vk::CommandBuffer copyCmdBuf, StagingBuffers &stagingBuffers)
     {
         // create staging buffer
 
@@ -165,63 +235,38 @@ class TexturePipeline : public agz::misc::uncopyable_t
 
         auto ret = allocator_->createBufferUnique(bufInfo, allocInfo);
 
-        // copy command buffer
-
-        vk::CommandBufferAllocateInfo cmdBufAllocInfo;
-        cmdBufAllocInfo
-            .setCommandPool(cmdPool_.get())
-            .setCommandBufferCount(1)
-            .setLevel(vk::CommandBufferLevel::ePrimary);
-
-        auto copyCmdBuf = std::move(
-            device_.allocateCommandBuffersUnique(cmdBufAllocInfo)[0]);
-
-        vk::CommandBufferBeginInfo begInfo;
-        begInfo.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+        // record copy
 
         vk::BufferCopy copy;
         copy.setSrcOffset(0).setDstOffset(0).setSize(byteSize);
 
         vk::BufferMemoryBarrier barrier(
             vk::AccessFlagBits::eTransferWrite,
-            vk::AccessFlagBits::eVertexAttributeRead,
+            vk::AccessFlagBits::eVertexAttributeRead |
+            vk::AccessFlagBits::eIndexRead,
             VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
             ret.get(), 0, byteSize);
 
-        copyCmdBuf->begin(begInfo);
-
-        copyCmdBuf->copyBuffer(stagingBuffer.get(), ret.get(), 1, &copy);
-        copyCmdBuf->pipelineBarrier(
+        copyCmdBuf.copyBuffer(stagingBuffer.get(), ret.get(), 1, &copy);
+        copyCmdBuf.pipelineBarrier(
             vk::PipelineStageFlagBits::eTransfer,
             vk::PipelineStageFlagBits::eVertexInput,
             {}, 0, nullptr, 1, &barrier, 0, nullptr);
 
-        copyCmdBuf->end();
-
-        vk::SubmitInfo submit;
-        submit
-            .setCommandBufferCount(1)
-            .setPCommandBuffers(&copyCmdBuf.get());
-
-        (void)window.getGraphicsQueue().submit(1, &submit, nullptr);
-        window.getGraphicsQueue().waitIdle();
+        stagingBuffers.push_back(std::move(stagingBuffer));
 
         return ret;
     }
 
-    void initShaders(vk::Device device)
+    void initShaders(vk::Device device, const ShaderByteCode &byteCode)
     {
         vk::ShaderModuleCreateInfo info;
 
         // vertex shader module
 
-        const auto vertByteCode = compileGLSLToSPIRV(
-            VERTEX_SHADER_SOURCE, "vertex shader", {},
-            agz::vlab::ShaderModuleType::Vertex, false);
         info
-            .setCodeSize(vertByteCode.size() *
-                sizeof(decltype(vertByteCode)::value_type))
-            .setPCode(vertByteCode.data());
+            .setCodeSize(byteCode.vert.size() * sizeof(uint32_t))
+            .setPCode(byteCode.vert.data());
         vertShader_ = device.createShaderModuleUnique(info);
 
         // vertex shader stage
@@ -233,13 +278,9 @@ class TexturePipeline : public agz::misc::uncopyable_t
 
         // fragment shader module
 
-        const auto fragByteCode = compileGLSLToSPIRV(
-            FRAGMENT_SHADER_SOURCE, "fragment shader", {},
-            agz::vlab::ShaderModuleType::Fragment, false);
         info
-            .setCodeSize(fragByteCode.size() *
-                sizeof(decltype(fragByteCode)::value_type))
-            .setPCode(fragByteCode.data());
+            .setCodeSize(byteCode.frag.size() * sizeof(uint32_t))
+            .setPCode(byteCode.frag.data());
         fragShader_ = device.createShaderModuleUnique(info);
 
         // fragment shader stage
@@ -256,8 +297,65 @@ class TexturePipeline : public agz::misc::uncopyable_t
         poolInfo
             .setQueueFamilyIndex(
                 window.getGraphicsDevice().graphicsQueueFamilyIndex())
-            .setFlags(vk::CommandPoolCreateFlagBits::eResetCommandBuffer);
+            .setFlags(vk::CommandPoolCreateFlagBits::eTransient);
         cmdPool_ = device_.createCommandPoolUnique(poolInfo);
+
+        if(window.getGraphicsDevice().isTimelineSemaphoreEnabled())
+        {
+            scheduler_ = std::make_unique<agz::vlab::FrameScheduler>(
+                device_, MAX_FRAMES_IN_FLIGHT);
+
+            frameCtx_ = std::make_unique<agz::vlab::FrameContext>(
+                device_,
+                window.getGraphicsDevice().graphicsQueueFamilyIndex(),
+                *scheduler_);
+        }
+        else
+        {
+            frameCtx_ = std::make_unique<agz::vlab::FrameContext>(
+                device_,
+                window.getGraphicsDevice().graphicsQueueFamilyIndex(),
+                MAX_FRAMES_IN_FLIGHT);
+        }
+
+        cachedCmdBufs_ = std::make_unique<agz::vlab::CachedCommandBuffers>(
+            device_, window.getGraphicsDevice().graphicsQueueFamilyIndex());
+
+        agz::vlab::GpuProfilerDesc profilerDesc;
+        profilerDesc.frameCount  = MAX_FRAMES_IN_FLIGHT;
+        profilerDesc.traceEvents =
+            window.getGraphicsDevice().isCalibratedTimestampsEnabled();
+
+        gpuProfiler_ = std::make_unique<agz::vlab::GpuProfiler>(
+            window.getPhysicalDevice(), device_,
+            window.getGraphicsDevice().graphicsQueueFamilyIndex(),
+            profilerDesc);
+        if(!gpuProfiler_->isAvailable())
+            gpuProfiler_.reset();
+    }
+
+    void initFramebuffers(const agz::vlab::Window &window)
+    {
+        framebuffers_.clear();
+
+        for(auto &iv : window.getSwapchainImageViews())
+        {
+            vk::ImageView attachments[] = { iv.get() };
+
+            vk::FramebufferCreateInfo info;
+            info
+                .setRenderPass(renderpass_.get())
+                .setAttachmentCount(1)
+                .setPAttachments(attachments)
+                .setWidth(window.getSwapchainExtent().width)
+                .setHeight(window.getSwapchainExtent().height)
+                .setLayers(1);
+
+            framebuffers_.push_back(device_.createFramebufferUnique(info));
+        }
+
+        cachedCmdBufs_->resize(
+            window.getSwapchainImageCount() * MAX_FRAMES_IN_FLIGHT);
     }
 
     vk::UniqueDescriptorSetLayout createDescSetLayout(vk::Device device)
@@ -404,16 +502,12 @@ class TexturePipeline : public agz::misc::uncopyable_t
             .setBasePipelineIndex(-1);
 
         pipeline_ = device_.createGraphicsPipelineUnique(
-            nullptr, pipelineInfo);
+            window.getContext().getPipelineCache(), pipelineInfo);
     }
 
-    void initVertexIndexBuffer(const agz::vlab::Window &window)
+    void initVertexIndexBuffer(
+        vk::CommandBuffer copyCmdBuf, StagingBuffers &stagingBuffers)
     {
-        allocator_ = std::make_unique<agz::vlab::VMAAlloc>(
-            window.getInstance(),
-            window.getPhysicalDevice(),
-            device_);
-
         // vertex buffer
 
         const Vertex vertexData[] = {
@@ -426,7 +520,7 @@ class TexturePipeline : public agz::misc::uncopyable_t
         vertexBuffer_ = createDeviceBuffer(
             sizeof(vertexData),
             vk::BufferUsageFlagBits::eVertexBuffer,
-            vertexData, window);
+            vertexData, copyCmdBuf, stagingBuffers);
 
         // index buffer
 
@@ -435,7 +529,7 @@ class TexturePipeline : public agz::misc::uncopyable_t
         indexBuffer_ = createDeviceBuffer(
             sizeof(indexData),
             vk::BufferUsageFlagBits::eIndexBuffer,
-            indexData, window);
+            indexData, copyCmdBuf, stagingBuffers);
     }
 
     void initDescriptorPool()
@@ -457,14 +551,12 @@ class TexturePipeline : public agz::misc::uncopyable_t
         descPool_ = device_.createDescriptorPoolUnique(info);
     }
 
-    void initImage(const agz::vlab::Window &window)
+    void initImage(
+        const agz::vlab::GraphicsDevice &graphicsDevice,
+        const ImageData                 &imgData,
+        vk::CommandBuffer                copyCmdBuf,
+        StagingBuffers                  &stagingBuffers)
     {
-        // load image data
-
-        auto imgData = agz::img::load_rgba_from_file("05_texture.png");
-        if(!imgData.is_available())
-            throw std::runtime_error("failed to load image data");
-
         // create image
 
         vk::ImageCreateInfo imgInfo;
@@ -487,7 +579,8 @@ class TexturePipeline : public agz::misc::uncopyable_t
         VmaAllocationCreateInfo allocInfo = {};
         allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
 
-        image_ = allocator_->createImageUnique(imgInfo, allocInfo);
+        image_ = allocator_->createImageUnique(
+            imgInfo, allocInfo, "texture");
 
         // create image view
 
@@ -506,6 +599,7 @@ class TexturePipeline : public agz::misc::uncopyable_t
                 0, 1, 0, 1});
 
         imageView_ = device_.createImageViewUnique(viewInfo);
+        agz::vlab::setDebugName(device_, imageView_.get(), "texture view");
 
         // create staging buffer
 
@@ -515,39 +609,17 @@ class TexturePipeline : public agz::misc::uncopyable_t
 
         // copy texture data
 
-        vk::CommandBufferAllocateInfo cmdBufAllocInfo;
-        cmdBufAllocInfo
-            .setCommandPool(cmdPool_.get())
-            .setCommandBufferCount(1)
-            .setLevel(vk::CommandBufferLevel::ePrimary);
-
-        auto copyCmdBuf = std::move(
-            device_.allocateCommandBuffersUnique(cmdBufAllocInfo)[0]);
-
-        vk::CommandBufferBeginInfo cmdBegInfo;
-        cmdBegInfo.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
-
-        copyCmdBuf->begin(cmdBegInfo);
-
-        vk::ImageSubresourceRange imgRng(
-            vk::ImageAspectFlagBits::eColor,
-            0, 1, 0, 1);
+        agz::vlab::ResourceStateTracker stateTracker(graphicsDevice);
+        stateTracker.trackImage(
+            image_.get(), vk::ImageAspectFlagBits::eColor, 1, 1, {});
 
-        vk::ImageMemoryBarrier imgBarrier1;
-        imgBarrier1
-            .setSrcAccessMask({})
-            .setDstAccessMask(vk::AccessFlagBits::eTransferWrite)
-            .setOldLayout(vk::ImageLayout::eUndefined)
-            .setNewLayout(vk::ImageLayout::eTransferDstOptimal)
-            .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
-            .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
-            .setImage(image_.get())
-            .setSubresourceRange(imgRng);
-
-        copyCmdBuf->pipelineBarrier(
-            vk::PipelineStageFlagBits::eTopOfPipe,
-            vk::PipelineStageFlagBits::eTransfer,
-            {}, 0, nullptr, 0, nullptr, 1, &imgBarrier1);
+        stateTracker.useImage(
+            image_.get(),
+            { vk::ImageLayout::eTransferDstOptimal,
+              vk::PipelineStageFlagBits::eTransfer,
+              vk::AccessFlagBits::eTransferWrite },
+            {}, true);
+        stateTracker.flush(copyCmdBuf);
 
         vk::BufferImageCopy bufImgCopy;
         bufImgCopy
@@ -562,41 +634,22 @@ class TexturePipeline : public agz::misc::uncopyable_t
                 uint32_t(imgData.shape()[0]),
                 1 });
 
-        copyCmdBuf->copyBufferToImage(
+        copyCmdBuf.copyBufferToImage(
             stagingBuffer.get(), image_.get(),
             vk::ImageLayout::eTransferDstOptimal, 1,
             &bufImgCopy);
 
-        vk::ImageMemoryBarrier imgBarrier2;
-        imgBarrier2
-            .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
-            .setDstAccessMask(vk::AccessFlagBits::eShaderRead)
-            .setOldLayout(vk::ImageLayout::eTransferDstOptimal)
-            .setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
-            .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
-            .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
-            .setImage(image_.get())
-            .setSubresourceRange(imgRng);
-
-        copyCmdBuf->pipelineBarrier(
-            vk::PipelineStageFlagBits::eTransfer,
-            vk::PipelineStageFlagBits::eFragmentShader,
-            {}, 0, nullptr, 0, nullptr,
-            1, &imgBarrier2);
+        stateTracker.useImage(
+            image_.get(),
+            { vk::ImageLayout::eShaderReadOnlyOptimal,
+              vk::PipelineStageFlagBits::eFragmentShader,
+              vk::AccessFlagBits::eShaderRead });
+        stateTracker.flush(copyCmdBuf);
 
-        copyCmdBuf->end();
-
-        vk::SubmitInfo submit;
-        submit
-            .setCommandBufferCount(1)
-            .setPCommandBuffers(&copyCmdBuf.get());
-
-        (void)window.getGraphicsQueue().submit(1, &submit, nullptr);
-
-        device_.waitIdle();
+        stagingBuffers.push_back(std::move(stagingBuffer));
     }
 
-    void initSampler()
+    void initSampler(const agz::vlab::Window &window)
     {
         vk::SamplerCreateInfo info;
         info
@@ -607,6 +660,16 @@ class TexturePipeline : public agz::misc::uncopyable_t
             .setAddressModeV(vk::SamplerAddressMode::eClampToEdge)
             .setAddressModeW(vk::SamplerAddressMode::eClampToEdge);
 
+        if(window.getGraphicsDevice().isFeatureEnabled(
+            agz::vlab::DeviceFeature::SamplerAnisotropy))
+        {
+            const float maxAnisotropy = window.getPhysicalDevice()
+                .getProperties().limits.maxSamplerAnisotropy;
+            info
+                .setAnisotropyEnable(true)
+                .setMaxAnisotropy((std::min)(16.0f, maxAnisotropy));
+        }
+
         sampler_ = device_.createSamplerUnique(info);
     }
 
@@ -618,12 +681,6 @@ class TexturePipeline : public agz::misc::uncopyable_t
         frame.imageSemaphore  = device_.createSemaphoreUnique(semaphoreInfo);
         frame.renderSemaphore = device_.createSemaphoreUnique(semaphoreInfo);
 
-        // fence
-
-        vk::FenceCreateInfo fenceInfo;
-        fenceInfo.setFlags(vk::FenceCreateFlagBits::eSignaled);
-        frame.frameFence = device_.createFenceUnique(fenceInfo);
-
         // uniform buffer
 
         vk::BufferCreateInfo uniformBufInfo;
@@ -636,7 +693,7 @@ class TexturePipeline : public agz::misc::uncopyable_t
         uniformBufAllocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
 
         frame.uniformBuf = allocator_->createBufferUnique(
-            uniformBufInfo, uniformBufAllocInfo);
+            uniformBufInfo, uniformBufAllocInfo, "uniform buffer");
 
         // desc set
 
@@ -677,25 +734,16 @@ class TexturePipeline : public agz::misc::uncopyable_t
             .setPImageInfo(&imageInfo);
 
         device_.updateDescriptorSets(2, descWrite, 0, nullptr);
-
-        // command buffer
-
-        vk::CommandBufferAllocateInfo cmdBufInfo;
-        cmdBufInfo
-            .setCommandPool(cmdPool_.get())
-            .setLevel(vk::CommandBufferLevel::ePrimary)
-            .setCommandBufferCount(1);
-
-        frame.cmdBuf = device_.allocateCommandBuffers(cmdBufInfo).front();
     }
 
+    // cached command buffers are recorded without queries
     void recordCommandBuffer(
-        const agz::vlab::Window &window, FrameResource &frame)
+        const agz::vlab::Window &window, vk::CommandBuffer cb,
+        vk::Framebuffer framebuffer, const FrameResource &frame, bool cached)
     {
-        auto cb = frame.cmdBuf;
-
-        vk::CommandBufferBeginInfo beginInfo;
-        beginInfo.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+        agz::vlab::GpuScope scope(
+            cached ? nullptr : gpuProfiler_.get(), cb, "main pass");
+        AGZ_VLAB_DEBUG_LABEL(cb, "main pass");
 
         vk::ClearValue clearValue(vk::ClearColorValue(
             std::array<float, 4>{ 0, 0, 0, 1 }));
@@ -703,12 +751,11 @@ class TexturePipeline : public agz::misc::uncopyable_t
         vk::RenderPassBeginInfo renderpassInfo;
         renderpassInfo
             .setRenderPass(renderpass_.get())
-            .setFramebuffer(frame.framebuffer.get())
+            .setFramebuffer(framebuffer)
             .setRenderArea({ { 0, 0 }, window.getSwapchainExtent() })
             .setClearValueCount(1)
             .setPClearValues(&clearValue);
 
-        cb.begin(beginInfo);
         cb.beginRenderPass(renderpassInfo, vk::SubpassContents::eInline);
 
         cb.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline_.get());
@@ -723,39 +770,20 @@ class TexturePipeline : public agz::misc::uncopyable_t
             vk::PipelineBindPoint::eGraphics, pipelineLayout_.get(),
             0, 1, &frame.descSet, 0, nullptr);
 
-        cb.drawIndexed(6, 1, 0, 0, 0);
-
-        cb.endRenderPass();
-        cb.end();
-    }
-
-    void initSync()
-    {
-        vk::SemaphoreCreateInfo semaphoreInfo;
-
-        vk::FenceCreateInfo fenceInfo;
-        fenceInfo.setFlags(vk::FenceCreateFlagBits::eSignaled);
-
-        for(uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
         {
-            frameRscs_[i].imageSemaphore = device_.createSemaphoreUnique(
-                semaphoreInfo);
-
-            frameRscs_[i].renderSemaphore = device_.createSemaphoreUnique(
-                semaphoreInfo);
-
-            frameRscs_[i].frameFence = device_.createFenceUnique(fenceInfo);
+            agz::vlab::PipelineStatsScope statsScope(
+                cached ? nullptr : pipelineStats_.get(), cb, "textured quad");
+            cb.drawIndexed(6, 1, 0, 0, 0);
         }
+
+        cb.endRenderPass();
     }
 
-    void updateUniformBuffer(const float wOverH, FrameResource &frame)
+    void updateUniformBuffer(
+        const float wOverH, float interpolation, FrameResource &frame)
     {
-        using Clock = std::chrono::high_resolution_clock;
-
-        const static auto start = Clock::now();
-
-        const float durationS = std::chrono::duration_cast<
-            std::chrono::microseconds>(Clock::now() - start).count() / 1e6f;
+        const float angle =
+            prevAngle_ + (angle_ - prevAngle_) * interpolation;
 
         Mat4 proj = Trans4::perspective(
             agz::math::deg2rad(60.0f), wOverH, 0.1f, 100.0f);
@@ -764,7 +792,7 @@ class TexturePipeline : public agz::misc::uncopyable_t
         const Mat4 projViewModel =
             proj
             * Trans4::look_at({ 0, 0, -1.5f }, { 0, 0, 0 }, { 0, 1, 0 })
-            * Trans4::rotate_y(durationS);
+            * Trans4::rotate_y(angle);
 
         const UniformBufferObject ubData = { projViewModel };
 
@@ -774,50 +802,88 @@ class TexturePipeline : public agz::misc::uncopyable_t
         ub.unmap();
     }
 
-    void preRecreateSwapchain()
+    void preRecreateSwapchain(const agz::vlab::Window &window)
     {
-        device_.waitIdle();
+        if(!scheduler_)
+        {
+            frameCtx_->waitIdle();
 
-        for(auto &f : frameRscs_)
-            f.framebuffer.reset();
+            cachedCmdBufs_->invalidate();
+            framebuffers_.clear();
 
-        pipeline_.reset();
-        pipelineLayout_.reset();
-        renderpass_.reset();
+            pipeline_.reset();
+            pipelineLayout_.reset();
+            renderpass_.reset();
+
+            return;
+        }
+
+        // frames in flight still reference these objects.
+        // destroy them after the frames retire instead of draining the gpu
+
+        struct RetiredResources
+        {
+            std::unique_ptr<agz::vlab::CachedCommandBuffers> cachedCmdBufs;
+            std::vector<vk::UniqueFramebuffer>               framebuffers;
+
+            vk::UniquePipeline       pipeline;
+            vk::UniquePipelineLayout pipelineLayout;
+            vk::UniqueRenderPass     renderpass;
+        };
+
+        auto retired = std::make_shared<RetiredResources>();
+        retired->cachedCmdBufs  = std::move(cachedCmdBufs_);
+        retired->framebuffers   = std::move(framebuffers_);
+        retired->pipeline       = std::move(pipeline_);
+        retired->pipelineLayout = std::move(pipelineLayout_);
+        retired->renderpass     = std::move(renderpass_);
+
+        framebuffers_.clear();
+
+        scheduler_->defer([retired]
+        {
+            retired->cachedCmdBufs.reset();
+            retired->framebuffers.clear();
+            retired->pipeline.reset();
+            retired->pipelineLayout.reset();
+            retired->renderpass.reset();
+        });
+
+        cachedCmdBufs_ = std::make_unique<agz::vlab::CachedCommandBuffers>(
+            device_, window.getGraphicsDevice().graphicsQueueFamilyIndex());
     }
 
     void postRecreateSwapchain(const agz::vlab::Window &window)
     {
         initRenderpass(window);
         initGraphicsPipeline(window);
+        initFramebuffers(window);
     }
 
 public:
 
-    explicit TexturePipeline(agz::vlab::Window &window)
+    // device objects only. call uploadResources before rendering
+    TexturePipeline(agz::vlab::Window &window, const ShaderByteCode &shaders)
     {
-        device_ = window.getDevice();
+        device_    = window.getDevice();
+        allocator_ = &window.getContext().getAllocator();
 
         frameRscs_.resize(MAX_FRAMES_IN_FLIGHT);
 
         initCmdPool(window);
         initRenderpass(window);
-        initShaders(device_);
+        initFramebuffers(window);
+        initShaders(device_, shaders);
         descSetLayout_ = createDescSetLayout(device_);
         initGraphicsPipeline(window);
-        initVertexIndexBuffer(window);
-        initImage(window);
-        initSampler();
+        initSampler(window);
         initDescriptorPool();
 
-        for(auto &f : frameRscs_)
-            initFramebufferResource(f);
-
         auto preHandler = std::make_shared<agz::event::functional_receiver_t<
             agz::vlab::WindowPreRecreateSwapchainEvent>>(
                 [&](const agz::vlab::WindowPreRecreateSwapchainEvent &)
         {
-            preRecreateSwapchain();
+            preRecreateSwapchain(window);
         });
 
         auto postHandler = std::make_shared<agz::event::functional_receiver_t<
@@ -829,10 +895,92 @@ public:
 
         window.attach<agz::vlab::WindowPreRecreateSwapchainEvent>(preHandler);
         window.attach<agz::vlab::WindowPostRecreateSwapchainEvent>(postHandler);
+
+        if(scheduler_)
+        {
+            window.setDeferredDestroyer([&](std::function<void()> func)
+            {
+                scheduler_->defer(std::move(func));
+            });
+
+            auto pacingHandler = std::make_shared<
+                agz::event::functional_receiver_t<
+                    agz::vlab::WindowFramePacingEvent>>(
+                        [&](const agz::vlab::WindowFramePacingEvent &e)
+            {
+                scheduler_->setFramesInFlight(e.framesInFlight);
+            });
+
+            window.attach<agz::vlab::WindowFramePacingEvent>(pacingHandler);
+        }
+    }
+
+    // create vertex/index buffers and the texture, uploaded by a single
+    // submission, then the per-frame resources referring to them
+    void uploadResources(
+        const agz::vlab::Window &window, const ImageData &imgData)
+    {
+        vk::CommandBufferAllocateInfo cmdBufAllocInfo;
+        cmdBufAllocInfo
+            .setCommandPool(cmdPool_.get())
+            .setCommandBufferCount(1)
+            .setLevel(vk::CommandBufferLevel::ePrimary);
+
+        auto copyCmdBuf = std::move(
+            device_.allocateCommandBuffersUnique(cmdBufAllocInfo)[0]);
+
+        vk::CommandBufferBeginInfo cmdBegInfo;
+        cmdBegInfo.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+
+        StagingBuffers stagingBuffers;
+
+        copyCmdBuf->begin(cmdBegInfo);
+        initVertexIndexBuffer(copyCmdBuf.get(), stagingBuffers);
+        initImage(
+            window.getGraphicsDevice(), imgData,
+            copyCmdBuf.get(), stagingBuffers);
+        copyCmdBuf->end();
+
+        for(auto &f : frameRscs_)
+            initFramebufferResource(f);
+
+        vk::SubmitInfo submit;
+        submit
+            .setCommandBufferCount(1)
+            .setPCommandBuffers(&copyCmdBuf.get());
+
+        if(!scheduler_)
+        {
+            (void)window.getGraphicsQueue().submit(1, &submit, nullptr);
+            device_.waitIdle();
+            return;
+        }
+
+        // the first frame is submitted to the same queue after the upload,
+        // so only the staging resources need to wait for its completion
+
+        const auto uploadPoint = scheduler_->submit(
+            window.getGraphicsQueue(), submit);
+
+        auto uploadRscs = std::make_shared<std::pair<
+            StagingBuffers, vk::UniqueCommandBuffer>>(
+                std::move(stagingBuffers), std::move(copyCmdBuf));
+
+        scheduler_->deferUntil(uploadPoint, [uploadRscs]
+        {
+            uploadRscs->first.clear();
+            uploadRscs->second.reset();
+        });
     }
 
     ~TexturePipeline()
     {
+        frameCtx_.reset();
+        scheduler_.reset();
+        gpuProfiler_.reset();
+        pipelineStats_.reset();
+        cachedCmdBufs_.reset();
+        framebuffers_.clear();
         frameRscs_.clear();
 
         descPool_.reset();
@@ -844,7 +992,7 @@ public:
         vertexBuffer_.reset();
         indexBuffer_.reset();
 
-        allocator_.reset();
+        allocator_ = nullptr;
 
         pipeline_.reset();
         pipelineLayout_.reset();
@@ -857,40 +1005,73 @@ public:
         cmdPool_.reset();
     }
 
-    void renderFrame(agz::vlab::Window &window)
+    // null if gpu timestamps are unsupported
+    const agz::vlab::GpuProfiler *getGpuProfiler() const noexcept
+    {
+        return gpuProfiler_.get();
+    }
+
+    // call before the first frame. no-op if the device lacks
+    // DeviceFeature::PipelineStatisticsQuery
+    void enablePipelineStatistics(const agz::vlab::Window &window)
+    {
+        const auto &gd = window.getGraphicsDevice();
+        if(!gd.isFeatureEnabled(
+            agz::vlab::DeviceFeature::PipelineStatisticsQuery))
+            return;
+
+        agz::vlab::PipelineStatsDesc desc;
+        desc.frameCount       = MAX_FRAMES_IN_FLIGHT;
+        desc.occlusion        = true;
+        desc.preciseOcclusion = gd.isFeatureEnabled(
+            agz::vlab::DeviceFeature::OcclusionQueryPrecise);
+
+        pipelineStats_ = std::make_unique<agz::vlab::PipelineStatsProfiler>(
+            device_, desc);
+        cacheCmdBufs_ = false;
+    }
+
+    // print per-frame averages since the last call
+    void printPipelineStatistics(std::ostream &out)
+    {
+        if(pipelineStats_)
+        {
+            pipelineStats_->printAverages(out);
+            pipelineStats_->resetAccumulated();
+        }
+    }
+
+    // advance the animation by a fixed timestep
+    void update(double dt)
+    {
+        prevAngle_ = angle_;
+        angle_    += static_cast<float>(dt);
+    }
+
+    // interpolation: in [0, 1), between previous and current update
+    void renderFrame(agz::vlab::Window &window, float interpolation)
     {
-        auto &frame = frameRscs_[currentFrame_];
+        AGZ_VLAB_TRACE_SCOPE("renderFrame");
+
+        const auto frameStart = std::chrono::steady_clock::now();
+
+        if(scheduler_)
+            scheduler_->beginFrame();
+        frameCtx_->beginFrame();
 
-        vk::Fence frameFence[] = { frame.frameFence.get() };
-        (void)device_.waitForFences(1, frameFence, true, UINT64_MAX);
-        (void)device_.resetFences(1, frameFence);
+        auto &frame = frameRscs_[frameCtx_->getFrameIndex()];
 
         const auto nextImageResult = window.acquireNextImage(
             UINT64_MAX, frame.imageSemaphore.get(), nullptr);
+        // swapchain is recreated by next window.doEvents()
         if(nextImageResult.result == vk::Result::eErrorOutOfDateKHR)
-            return window.recreateSwapchain();
+            return;
         const uint32_t imageIndex = nextImageResult.value;
 
-        if(frame.framebuffer)
-            frame.framebuffer.reset();
-
-        {
-            auto &iv = window.getSwapchainImageViews()[imageIndex];
-            vk::ImageView attachments[] = { iv.get() };
+        const auto cpuStart = std::chrono::steady_clock::now();
 
-            vk::FramebufferCreateInfo info;
-            info
-                .setRenderPass(renderpass_.get())
-                .setAttachmentCount(1)
-                .setPAttachments(attachments)
-                .setWidth(window.getSwapchainExtent().width)
-                .setHeight(window.getSwapchainExtent().height)
-                .setLayers(1);
-
-            frame.framebuffer = device_.createFramebufferUnique(info);
-        }
-
-        updateUniformBuffer(window.getSwapchainAspectRatio(), frame);
+        updateUniformBuffer(
+            window.getSwapchainAspectRatio(), interpolation, frame);
 
         vk::Semaphore waitSemaphores[] = {
             frame.imageSemaphore.get()
@@ -904,61 +1085,371 @@ public:
             frame.renderSemaphore.get()
         };
 
-        recordCommandBuffer(window, frame);
+        const auto framebuffer = framebuffers_[imageIndex].get();
+
+        // the frame scope spans separate command buffers around the main
+        // one, which may be a cached buffer without scopes of its own
+
+        vk::CommandBuffer cmdBufs[3];
+        uint32_t cmdBufCount = 0;
+
+        agz::vlab::GpuProfiler::ScopeID frameScope =
+            agz::vlab::GpuProfiler::INVALID_SCOPE;
+
+        auto beginProfileCmdBuf = [&]
+        {
+            vk::CommandBufferBeginInfo beginInfo;
+            beginInfo.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+
+            auto cb = frameCtx_->allocateCommandBuffer();
+            cb.begin(beginInfo);
+            cmdBufs[cmdBufCount++] = cb;
+            return cb;
+        };
+
+        if(gpuProfiler_ || pipelineStats_)
+        {
+            auto cb = beginProfileCmdBuf();
+
+            if(pipelineStats_)
+            {
+                pipelineStats_->beginFrame(frameCtx_->getFrameIndex());
+                pipelineStats_->resetQueries(cb);
+            }
+
+            if(gpuProfiler_)
+            {
+                gpuProfiler_->beginFrame(frameCtx_->getFrameIndex());
+                gpuProfiler_->resetQueries(cb);
+                frameScope = gpuProfiler_->beginScope(cb, "frame");
+            }
+
+            cb.end();
+        }
+
+        if(cacheCmdBufs_)
+        {
+            AGZ_VLAB_TRACE_SCOPE("record");
+
+            const uint32_t slot =
+                imageIndex * MAX_FRAMES_IN_FLIGHT + frameCtx_->getFrameIndex();
+
+            frame.cmdBuf = cachedCmdBufs_->get(
+                slot, [&](vk::CommandBuffer cb)
+            {
+                recordCommandBuffer(window, cb, framebuffer, frame, true);
+            });
+        }
+        else
+        {
+            AGZ_VLAB_TRACE_SCOPE("record");
+
+            vk::CommandBufferBeginInfo beginInfo;
+            beginInfo.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+
+            frame.cmdBuf = frameCtx_->allocateCommandBuffer();
+            frame.cmdBuf.begin(beginInfo);
+            recordCommandBuffer(
+                window, frame.cmdBuf, framebuffer, frame, false);
+            frame.cmdBuf.end();
+        }
+
+        cmdBufs[cmdBufCount++] = frame.cmdBuf;
+
+        if(gpuProfiler_)
+        {
+            auto cb = beginProfileCmdBuf();
+            gpuProfiler_->endScope(cb, frameScope);
+            cb.end();
+        }
 
         vk::SubmitInfo submitInfo;
         submitInfo
             .setWaitSemaphoreCount(1)
             .setPWaitSemaphores(waitSemaphores)
             .setPWaitDstStageMask(waitStages)
-            .setCommandBufferCount(1)
-            .setPCommandBuffers(&frame.cmdBuf)
+            .setCommandBufferCount(cmdBufCount)
+            .setPCommandBuffers(cmdBufs)
             .setSignalSemaphoreCount(1)
             .setPSignalSemaphores(signalSemaphores);
 
-        (void)window.getGraphicsQueue().submit(1, &submitInfo, frameFence[0]);
+        {
+            AGZ_VLAB_TRACE_SCOPE("submit");
+
+            if(scheduler_)
+            {
+                scheduler_->submit(window.getGraphicsQueue(), submitInfo);
+            }
+            else
+            {
+                (void)window.getGraphicsQueue().submit(
+                    1, &submitInfo, frameCtx_->getSubmitFence());
+            }
+        }
 
-        vk::SwapchainKHR swapchains[] = { window.getSwapchain() };
+        // out of date/suboptimal swapchain is recreated by next doEvents
+        (void)window.present(imageIndex, signalSemaphores[0]);
 
-        vk::PresentInfoKHR presentInfo;
-        presentInfo
-            .setWaitSemaphoreCount(1)
-            .setPWaitSemaphores(signalSemaphores)
-            .setSwapchainCount(1)
-            .setPSwapchains(swapchains)
-            .setPImageIndices(&imageIndex);
+        frameCtx_->endFrame();
+        if(scheduler_)
+            scheduler_->endFrame();
 
-        (void)window.getPresentQueue().presentKHR(presentInfo);
+        // the frame period stands in for the gpu time until the first
+        // timestamps are read back, or if they are unsupported
 
-        currentFrame_ = (currentFrame_ + 1) % MAX_FRAMES_IN_FLIGHT;
+        if(scheduler_)
+        {
+            using Ms = std::chrono::duration<float, std::milli>;
+
+            const auto cpuEnd = std::chrono::steady_clock::now();
+            if(lastFrameStart_.time_since_epoch().count())
+            {
+                const float gpuTime = gpuProfiler_ ?
+                    gpuProfiler_->getLastTime("frame") : 0.0f;
+
+                framePacingTuner_.addSample(
+                    Ms(cpuEnd - cpuStart).count(),
+                    gpuTime > 0 ? gpuTime :
+                    Ms(frameStart - lastFrameStart_).count());
+            }
+
+            if(framePacingTuner_.update())
+            {
+                window.setFramePacing(
+                    framePacingTuner_.getFramesInFlight(),
+                    framePacingTuner_.getImageCount());
+            }
+        }
+
+        lastFrameStart_ = frameStart;
     }
 };
 
+// render a fixed number of frames without a window, then print a checksum of
+// the first swapchain image. enabled by setting VLAB_HEADLESS
+void runHeadless(agz::vlab::Window &window, TexturePipeline &pipeline)
+{
+    constexpr int FRAME_COUNT = 16;
+
+    for(int i = 0; i < FRAME_COUNT; ++i)
+    {
+        window.doEvents();
+        pipeline.update(1.0 / 60);
+        pipeline.renderFrame(window, 1);
+    }
+
+    window.getDevice().waitIdle();
+
+    const auto pixels = window.readbackSwapchainImage(0);
+
+    // fnv-1a
+    uint64_t checksum = 14695981039346656037ull;
+    for(uint8_t b : pixels)
+        checksum = (checksum ^ b) * 1099511628211ull;
+
+    std::cout << "headless: " << FRAME_COUNT << " frames, "
+              << window.getSwapchainExtent().width << "x"
+              << window.getSwapchainExtent().height << ", checksum = "
+              << std::hex << checksum << std::dec << std::endl;
+}
+
 void run()
 {
     agz::vlab::ValidationLayerManager layers;
     layers.add("VK_LAYER_KHRONOS_validation");
 
+    const bool headless = std::getenv("VLAB_HEADLESS") != nullptr;
+
+    // per-draw counters printed with the periodic report
+    const bool pipelineStats = std::getenv("VLAB_PIPELINE_STATS") != nullptr;
+
+    agz::vlab::DeviceFeatureManager features;
+    features.request(agz::vlab::DeviceFeature::SamplerAnisotropy);
+    // lets ResourceStateTracker record vkCmdPipelineBarrier2
+    features.request(agz::vlab::DeviceFeature::Synchronization2);
+    if(pipelineStats)
+    {
+        features.request(agz::vlab::DeviceFeature::PipelineStatisticsQuery);
+        features.request(agz::vlab::DeviceFeature::OcclusionQueryPrecise);
+    }
+
     agz::vlab::Window window;
-    window.Initialize(agz::vlab::WindowDesc()
-        .setSize(640, 480)
-        .setTitle("AirGuanZ's Vulkan Lab: 05.texture")
-        .setDebugMessage(true)
-        .setLayers(&layers)
-        .setResizable(true));
 
-    window.getDebugMsgMgr()->enableStdErrOutput(
-        agz::vlab::DebugMsgLevel::Verbose);
+    ShaderByteCode                   shaders;
+    std::optional<ImageData>         imgData;
+    std::unique_ptr<TexturePipeline> pipelinePtr;
 
-    TexturePipeline pipeline(window);
+    // startup. shaders are compiled during device creation, the image is
+    // decoded while the pipeline is built, and uploads are submitted last
 
-    while(!window.getCloseFlag())
+    // record a chrome trace of the whole run if VLAB_TRACE is set to
+    // the output path
+
+    const char *tracePath = std::getenv("VLAB_TRACE");
+    if(tracePath)
     {
-        window.doEvents();
-        pipeline.renderFrame(window);
+        agz::vlab::CpuTracer::setThreadName("main thread");
+        agz::vlab::CpuTracer::start();
+    }
+
+    auto writeTrace = [&]
+    {
+        if(!tracePath)
+            return;
+
+        agz::vlab::CpuTracer::stop();
+
+        const std::string path = tracePath;
+        std::ofstream fout(path);
+        if(!fout)
+            throw std::runtime_error("failed to open " + path);
+        agz::vlab::CpuTracer::writeChromeTrace(fout);
+    };
+
+    agz::vlab::TaskGraph startup;
+
+    const auto initWindow = startup.addTask("window", [&]
+    {
+        window.Initialize(agz::vlab::WindowDesc()
+            .setSize(640, 480)
+            .setTitle("AirGuanZ's Vulkan Lab: 05.texture")
+            .setDebugMessage(true)
+            .setLayers(&layers)
+            .setResizable(true)
+            .setDeviceFeatures(&features)
+            .setHeadless(headless));
+
+        window.getDebugMsgMgr()->enableStdErrOutput(
+            agz::vlab::DebugMsgLevel::Verbose);
+    }, {}, true);
+
+    const auto compile = startup.addTask("shader compile", [&]
+    {
+        shaders = compileShaders();
+    });
+
+    const auto decode = startup.addTask("image decode", [&]
+    {
+        imgData = loadImage();
+    });
+
+    const auto build = startup.addTask("pipeline", [&]
+    {
+        pipelinePtr = std::make_unique<TexturePipeline>(window, shaders);
+    }, { initWindow, compile });
+
+    startup.addTask("upload", [&]
+    {
+        pipelinePtr->uploadResources(window, *imgData);
+    }, { build, decode });
+
+    startup.run();
+
+    std::cout << "startup:" << std::endl;
+    startup.printTimings(std::cout);
+
+    TexturePipeline &pipeline = *pipelinePtr;
+
+    if(pipelineStats)
+        pipeline.enablePipelineStatistics(window);
+
+    if(headless)
+    {
+        runHeadless(window, pipeline);
+        writeTrace();
+        return;
     }
 
+    // redraw only on input/resizing, animating at a low rate
+    constexpr bool   RENDER_ON_DEMAND   = false;
+    constexpr double ON_DEMAND_INTERVAL = 1.0 / 30;
+
+    window.setRenderOnDemand(RENDER_ON_DEMAND);
+
+    // without vsync, cap the frame rate instead of burning the cpu
+    agz::vlab::FrameLoop frameLoop(agz::vlab::FrameLoopDesc{
+        window.getPresentMode() == vk::PresentModeKHR::eFifo ? 0.0 : 240.0,
+        1.0 / 60 });
+
+    auto lastReportTime = std::chrono::steady_clock::now();
+
+    auto update = [&](double dt)
+    {
+        pipeline.update(dt);
+    };
+
+    auto render = [&](float interpolation)
+    {
+        pipeline.renderFrame(window, interpolation);
+
+        if(window.isRenderOnDemand())
+            window.requestRedrawAfter(ON_DEMAND_INTERVAL);
+
+        const auto now = std::chrono::steady_clock::now();
+        if(now - lastReportTime >= std::chrono::seconds(2))
+        {
+            lastReportTime = now;
+
+            const auto stats      = window.getPresentStatistics();
+            const auto frameStats = frameLoop.getStatistics();
+            std::cout << agz::vlab::getPresentModeName(window.getPresentMode())
+                      << ": fps = "             << stats.fps
+                      << ", frame time = "      << stats.avgFrameTime
+                      << "ms (p99 "             << frameStats.p99FrameTime
+                      << "ms), acquire wait = " << stats.avgAcquireWait
+                      << "ms, latency = "       << stats.avgPresentLatency
+                      << "ms";
+
+            if(auto profiler = pipeline.getGpuProfiler())
+            {
+                std::cout << ", gpu = "
+                          << profiler->getStats("frame").avg << "ms";
+            }
+
+            std::cout << std::endl;
+
+            pipeline.printPipelineStatistics(std::cout);
+        }
+    };
+
+    auto frame = [&]
+    {
+        frameLoop.frame(update, render);
+    };
+
+    // submission is not delayed by os event handling (e.g. modal resize loop)
+    constexpr bool USE_RENDER_THREAD = true;
+
+    if(USE_RENDER_THREAD)
+        window.runRenderThread(frame);
+    else
+        frameLoop.run(window, update, render);
+
+    const auto &scStats = window.getSwapchainStatistics();
+    std::cout << "swapchain recreations: " << scStats.recreateCount
+              << ", avoided: "             << scStats.avoidedRecreations
+              << std::endl;
+
     window.getDevice().waitIdle();
+
+    // export gpu timing history as json if the path ends with .json,
+    // otherwise as csv
+    const char *profilePath = std::getenv("VLAB_GPU_PROFILE");
+    auto profiler = pipeline.getGpuProfiler();
+    if(profilePath && profiler)
+    {
+        const std::string path = profilePath;
+        std::ofstream fout(path);
+        if(!fout)
+            throw std::runtime_error("failed to open " + path);
+
+        if(path.size() >= 5 && path.substr(path.size() - 5) == ".json")
+            profiler->exportJSON(fout);
+        else
+            profiler->exportCSV(fout);
+    }
+
+    writeTrace();
 }
 
 int main()
@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <limits>
+
+#include <agz/vlab/vlab.h>
+
+// measures the cost of recording cheap state commands through:
+//   loader  : device functions from vkGetInstanceProcAddr (loader trampolines)
+//   default : VULKAN_HPP_DEFAULT_DISPATCHER, bound to this context
+//   context : VulkanContext::getDispatch
+constexpr int CALLS_PER_BUFFER = 100000;
+constexpr int REPEAT_COUNT     = 20;
+
+// returns the best time per call in nanoseconds
+template<typename Dispatch>
+double measure(
+    vk::Device device, vk::CommandPool pool, vk::CommandBuffer cmd,
+    const Dispatch &d)
+{
+    const vk::Viewport viewport(0, 0, 64, 64, 0, 1);
+    const vk::Rect2D   scissor({ 0, 0 }, { 64, 64 });
+
+    double best = std::numeric_limits<double>::max();
+
+    // the first round is a warm-up
+    for(int r = 0; r <= REPEAT_COUNT; ++r)
+    {
+        device.resetCommandPool(pool, {}, d);
+        cmd.begin(vk::CommandBufferBeginInfo(
+            vk::CommandBufferUsageFlagBits::eOneTimeSubmit), d);
+
+        const auto start = std::chrono::steady_clock::now();
+
+        for(int i = 0; i < CALLS_PER_BUFFER; ++i)
+        {
+            cmd.setViewport(0, viewport, d);
+            cmd.setScissor(0, scissor, d);
+        }
+
+        const auto end = std::chrono::steady_clock::now();
+
+        cmd.end(d);
+
+        const double ns = std::chrono::duration<double, std::nano>(
+            end - start).count() / (2.0 * CALLS_PER_BUFFER);
+        if(r > 0)
+            best = (std::min)(best, ns);
+    }
+
+    return best;
+}
+
+void run()
+{
+    // offscreen context. no surface is needed for recording
+
+    agz::vlab::VulkanContextDesc desc;
+    desc.appName            = "AirGuanZ's Vulkan Lab: 06.dispatch";
+    desc.enableDebugMessage = false;
+    desc.windowSurfaces     = false;
+
+    agz::vlab::VulkanContext context;
+    context.InitializeInstance(desc);
+    context.InitializeDevice(nullptr);
+
+    const vk::Device device = context.getDevice();
+
+    auto pool = device.createCommandPoolUnique(vk::CommandPoolCreateInfo(
+        vk::CommandPoolCreateFlagBits::eTransient,
+        context.getGraphicsDevice().graphicsQueueFamilyIndex()));
+
+    auto cmdBufs = device.allocateCommandBuffersUnique(
+        vk::CommandBufferAllocateInfo(
+            pool.get(), vk::CommandBufferLevel::ePrimary, 1));
+    const vk::CommandBuffer cmd = cmdBufs[0].get();
+
+    const vk::DispatchLoaderDynamic loaderDispatch(
+        context.getInstance(),
+        VULKAN_HPP_DEFAULT_DISPATCHER.vkGetInstanceProcAddr);
+
+    const double loaderNs = measure(
+        device, pool.get(), cmd, loaderDispatch);
+    const double defaultNs = measure(
+        device, pool.get(), cmd, VULKAN_HPP_DEFAULT_DISPATCHER);
+    const double contextNs = measure(
+        device, pool.get(), cmd, context.getDispatch());
+
+    std::cout << "ns per command ("
+              << 2 * CALLS_PER_BUFFER << " commands, best of "
+              << REPEAT_COUNT << ")" << std::endl;
+    std::cout << "loader  : " << loaderNs  << std::endl;
+    std::cout << "default : " << defaultNs << std::endl;
+    std::cout << "context : " << contextNs << std::endl;
+
+    cmdBufs.clear();
+    pool.reset();
+}
+
+int main()
+{
+    try
+    {
+        run();
+    }
+    catch(const std::exception &err)
+    {
+        std::cout << err.what() << std::endl;
+        return -1;
+    }
+}
@@ -0,0 +1,131 @@
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include <agz/vlab/vlab.h>
+
+// compares the cpu cost of recycling per-frame command buffers through
+// FrameContext::ResetMode:
+//   pool   : one vkResetCommandPool per frame
+//   buffer : one vkResetCommandBuffer per used command buffer
+constexpr uint32_t FRAME_COUNT         = 3;
+constexpr int      WARMUP_FRAMES       = 100;
+constexpr int      MEASURED_FRAMES     = 2000;
+constexpr int      BUFFERS_PER_FRAME   = 16;
+constexpr int      COMMANDS_PER_BUFFER = 64;
+
+using Clock = std::chrono::steady_clock;
+
+struct Result
+{
+    // average microseconds per frame
+    double reset  = 0;
+    double record = 0;
+};
+
+double toUs(Clock::duration d)
+{
+    return std::chrono::duration<double, std::micro>(d).count();
+}
+
+Result measure(
+    agz::vlab::VulkanContext &context, agz::vlab::FrameContext::ResetMode mode)
+{
+    const vk::Device device = context.getDevice();
+    const vk::Queue  queue  = context.getGraphicsDevice().graphicsQueue();
+
+    agz::vlab::FrameContext frames(
+        device, context.getGraphicsDevice().graphicsQueueFamilyIndex(),
+        FRAME_COUNT, mode);
+
+    const vk::Viewport viewport(0, 0, 64, 64, 0, 1);
+    const vk::Rect2D   scissor({ 0, 0 }, { 64, 64 });
+
+    Clock::duration resetTime{}, recordTime{};
+
+    for(int f = 0; f < WARMUP_FRAMES + MEASURED_FRAMES; ++f)
+    {
+        // keep fence waits out of the reset time
+        queue.waitIdle();
+
+        const auto resetStart = Clock::now();
+        frames.beginFrame();
+        const auto resetEnd = Clock::now();
+
+        std::vector<vk::CommandBuffer> cmdBufs;
+        for(int b = 0; b < BUFFERS_PER_FRAME; ++b)
+        {
+            const auto cmd = frames.allocateCommandBuffer();
+            cmd.begin(vk::CommandBufferBeginInfo(
+                vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+            for(int i = 0; i < COMMANDS_PER_BUFFER; ++i)
+            {
+                cmd.setViewport(0, viewport);
+                cmd.setScissor(0, scissor);
+            }
+            cmd.end();
+            cmdBufs.push_back(cmd);
+        }
+        const auto recordEnd = Clock::now();
+
+        vk::SubmitInfo submitInfo;
+        submitInfo
+            .setCommandBufferCount(static_cast<uint32_t>(cmdBufs.size()))
+            .setPCommandBuffers(cmdBufs.data());
+        (void)queue.submit(1, &submitInfo, frames.getSubmitFence());
+
+        frames.endFrame();
+
+        if(f >= WARMUP_FRAMES)
+        {
+            resetTime  += resetEnd - resetStart;
+            recordTime += recordEnd - resetEnd;
+        }
+    }
+
+    frames.waitIdle();
+
+    Result ret;
+    ret.reset  = toUs(resetTime)  / MEASURED_FRAMES;
+    ret.record = toUs(recordTime) / MEASURED_FRAMES;
+    return ret;
+}
+
+void run()
+{
+    // offscreen context. no surface is needed for recording
+
+    agz::vlab::VulkanContextDesc desc;
+    desc.appName            = "AirGuanZ's Vulkan Lab: 07.frameReset";
+    desc.enableDebugMessage = false;
+    desc.windowSurfaces     = false;
+
+    agz::vlab::VulkanContext context;
+    context.InitializeInstance(desc);
+    context.InitializeDevice(nullptr);
+
+    using ResetMode = agz::vlab::FrameContext::ResetMode;
+
+    const Result pool   = measure(context, ResetMode::Pool);
+    const Result buffer = measure(context, ResetMode::Buffer);
+
+    std::cout << "us per frame (" << MEASURED_FRAMES << " frames, "
+              << BUFFERS_PER_FRAME << " command buffers each)" << std::endl;
+    std::cout << "pool   : reset = " << pool.reset
+              << ", record = " << pool.record << std::endl;
+    std::cout << "buffer : reset = " << buffer.reset
+              << ", record = " << buffer.record << std::endl;
+}
+
+int main()
+{
+    try
+    {
+        run();
+    }
+    catch(const std::exception &err)
+    {
+        std::cout << err.what() << std::endl;
+        return -1;
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <functional>
+
+#include <agz/vlab/common.h>
+
+AGZ_VULKAN_LAB_BEGIN
+
+/**
+ * @brief record-once primary command buffers
+ *
+ * each slot (e.g. a swapchain image/frame resource pair) is recorded on
+ * first use and replayed until invalidate() is called. dynamic data should
+ * be passed through buffers instead of being baked into the commands.
+ */
+class CachedCommandBuffers : public misc::uncopyable_t
+{
+public:
+
+    using RecordFunc = std::function<void(vk::CommandBuffer)>;
+
+    CachedCommandBuffers(
+        vk::Device device, uint32_t queueFamilyIndex, uint32_t slotCount = 0);
+
+    ~CachedCommandBuffers();
+
+    // invalidates all slots
+    void resize(uint32_t slotCount);
+
+    uint32_t getSlotCount() const noexcept;
+
+    // drop all recorded commands. none of the cached buffers
+    // may be pending execution when this is called
+    void invalidate();
+
+    bool isRecorded(uint32_t slot) const noexcept;
+
+    // returns recorded command buffer of given slot.
+    // func is called between begin() and end() if slot is not recorded yet
+    vk::CommandBuffer get(uint32_t slot, const RecordFunc &func);
+
+    uint64_t getRecordCount() const noexcept;
+
+    uint64_t getReplayCount() const noexcept;
+
+private:
+
+    vk::Device device_;
+
+    vk::UniqueCommandPool pool_;
+
+    std::vector<vk::CommandBuffer> cmdBufs_;
+    std::vector<bool>              recorded_;
+
+    uint64_t recordCount_ = 0;
+    uint64_t replayCount_ = 0;
+};
+
+inline uint32_t CachedCommandBuffers::getSlotCount() const noexcept
+{
+    return static_cast<uint32_t>(cmdBufs_.size());
+}
+
+inline bool CachedCommandBuffers::isRecorded(uint32_t slot) const noexcept
+{
+    return recorded_[slot];
+}
+
+inline uint64_t CachedCommandBuffers::getRecordCount() const noexcept
+{
+    return recordCount_;
+}
+
+inline uint64_t CachedCommandBuffers::getReplayCount() const noexcept
+{
+    return replayCount_;
+}
+
+AGZ_VULKAN_LAB_END
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <agz/vlab/sync/frameScheduler.h>
+
+AGZ_VULKAN_LAB_BEGIN
+
+/**
+ * @brief per-frame command buffer allocation
+ *
+ * owns one transient command pool and one fence for each frame in flight.
+ * command buffers are handed out linearly and recycled by resetting the
+ * whole pool once the frame's fence signals.
+ *
+ * when constructed with a FrameScheduler, no fence is created: the frame
+ * index follows the scheduler, and the caller must submit through the
+ * scheduler and call its beginFrame() before beginFrame() of this context.
+ * the scheduler may reduce its frames in flight later, but not exceed the
+ * count at construction.
+ */
+class FrameContext : public misc::uncopyable_t
+{
+public:
+
+    enum class ResetMode
+    {
+        // reset the whole pool with vkResetCommandPool (default)
+        Pool,
+        // reset each command buffer separately. for comparison only
+        Buffer
+    };
+
+    FrameContext(
+        vk::Device device,
+        uint32_t   queueFamilyIndex,
+        uint32_t   frameCount,
+        ResetMode  resetMode = ResetMode::Pool);
+
+    FrameContext(
+        vk::Device      device,
+        uint32_t        queueFamilyIndex,
+        FrameScheduler &scheduler,
+        ResetMode       resetMode = ResetMode::Pool);
+
+    ~FrameContext();
+
+    uint32_t getFrameCount() const noexcept;
+
+    uint32_t getFrameIndex() const noexcept;
+
+    ResetMode getResetMode() const noexcept;
+
+    // wait until the previous submission of current frame completes,
+    // then recycle all of its command buffers
+    void beginFrame();
+
+    // command buffers are valid until next beginFrame of the same frame
+    vk::CommandBuffer allocateCommandBuffer(
+        vk::CommandBufferLevel level = vk::CommandBufferLevel::ePrimary);
+
+    // fence for the last submission of current frame.
+    // must be submitted once it is fetched.
+    // returns null handle when driven by a FrameScheduler
+    vk::Fence getSubmitFence();
+
+    // move to next frame
+    void endFrame();
+
+    // wait for all pending frames
+    void waitIdle();
+
+private:
+
+    struct Frame
+    {
+        vk::UniqueCommandPool pool;
+        vk::UniqueFence       fence;
+        bool                  pending = false;
+
+        std::vector<vk::CommandBuffer> cmdBufs[2];
+        size_t                         usedCount[2] = { 0, 0 };
+    };
+
+    static size_t levelIndex(vk::CommandBufferLevel level) noexcept;
+
+    void initFrames(uint32_t queueFamilyIndex, uint32_t frameCount);
+
+    vk::Device device_;
+
+    FrameScheduler *scheduler_ = nullptr;
+
+    ResetMode resetMode_;
+
+    uint32_t frameIndex_ = 0;
+
+    std::vector<Frame> frames_;
+};
+
+inline uint32_t FrameContext::getFrameCount() const noexcept
+{
+    return static_cast<uint32_t>(frames_.size());
+}
+
+inline uint32_t FrameContext::getFrameIndex() const noexcept
+{
+    return frameIndex_;
+}
+
+inline FrameContext::ResetMode FrameContext::getResetMode() const noexcept
+{
+    return resetMode_;
+}
+
+inline size_t FrameContext::levelIndex(vk::CommandBufferLevel level) noexcept
+{
+    return level == vk::CommandBufferLevel::ePrimary ? 0 : 1;
+}
+
+AGZ_VULKAN_LAB_END
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include <agz/vlab/common.h>
+
+AGZ_VULKAN_LAB_BEGIN
+
+/**
+ * @brief records secondary command buffers on a worker pool
+ *
+ * each (thread, frame) pair owns a transient command pool, so recording never
+ * needs external synchronization. the calling thread participates as worker 0.
+ */
+class ParallelCommandRecorder : public misc::uncopyable_t
+{
+public:
+
+    using RecordFunc = std::function<void(vk::CommandBuffer, uint32_t)>;
+
+    // threadCount == 0 means std::thread::hardware_concurrency()
+    ParallelCommandRecorder(
+        vk::Device device,
+        uint32_t   queueFamilyIndex,
+        uint32_t   frameCount,
+        uint32_t   threadCount = 0);
+
+    ~ParallelCommandRecorder();
+
+    uint32_t getThreadCount() const noexcept;
+
+    uint32_t getFrameCount() const noexcept;
+
+    // reset all command pools of given frame.
+    // previous submission of this frame must have been completed
+    void beginFrame(uint32_t frameIndex);
+
+    // record taskCount secondary command buffers in parallel.
+    // func(cmdBuf, taskIndex) is called between begin() and end().
+    // returned buffers are in task order and valid until next beginFrame
+    // with the same frame index
+    const std::vector<vk::CommandBuffer> &record(
+        const vk::CommandBufferInheritanceInfo &inheritance,
+        uint32_t                                taskCount,
+        const RecordFunc                       &func);
+
+    // record and stitch the results into primary with executeCommands.
+    // primary must be inside a render pass begun with
+    // vk::SubpassContents::eSecondaryCommandBuffers
+    void recordInto(
+        vk::CommandBuffer                       primary,
+        const vk::CommandBufferInheritanceInfo &inheritance,
+        uint32_t                                taskCount,
+        const RecordFunc                       &func);
+
+private:
+
+    struct ThreadContext
+    {
+        vk::UniqueCommandPool          pool;
+        std::vector<vk::CommandBuffer> cmdBufs;
+        size_t                         usedCount = 0;
+    };
+
+    ThreadContext &getContext(uint32_t frame, uint32_t thread) noexcept;
+
+    vk::CommandBuffer allocate(ThreadContext &context);
+
+    void workerMain(uint32_t threadIndex);
+
+    void runTasks(uint32_t threadIndex);
+
+    vk::Device device_;
+
+    uint32_t frameCount_  = 0;
+    uint32_t threadCount_ = 0;
+
+    std::vector<ThreadContext> contexts_;
+
+    // current job
+
+    uint32_t currentFrame_ = 0;
+
+    const RecordFunc                 *func_ = nullptr;
+    vk::CommandBufferInheritanceInfo  inheritance_;
+    uint32_t                          taskCount_ = 0;
+    std::atomic<uint32_t>             nextTask_  = 0;
+
+    std::vector<vk::CommandBuffer> results_;
+
+    std::mutex         exceptionMutex_;
+    std::exception_ptr exception_;
+
+    // worker threads
+
+    std::mutex              mutex_;
+    std::condition_variable jobCond_;
+    std::condition_variable doneCond_;
+
+    uint64_t jobID_         = 0;
+    uint32_t activeWorkers_ = 0;
+    bool     exit_          = false;
+
+    std::vector<std::thread> workers_;
+};
+
+inline uint32_t ParallelCommandRecorder::getThreadCount() const noexcept
+{
+    return threadCount_;
+}
+
+inline uint32_t ParallelCommandRecorder::getFrameCount() const noexcept
+{
+    return frameCount_;
+}
+
+AGZ_VULKAN_LAB_END
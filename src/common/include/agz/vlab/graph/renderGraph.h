@@ -0,0 +1,356 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <optional>
+
+#include <agz/vlab/sync/resourceStateTracker.h>
+#include <agz/vlab/vma/vmaAlloc.h>
+
+AGZ_VULKAN_LAB_BEGIN
+
+struct RGImage
+{
+    uint32_t index = UINT32_MAX;
+
+    bool isValid() const noexcept { return index != UINT32_MAX; }
+};
+
+struct RGPass
+{
+    uint32_t index = UINT32_MAX;
+
+    bool isValid() const noexcept { return index != UINT32_MAX; }
+};
+
+struct RGImageDesc
+{
+    vk::Format              format  = vk::Format::eUndefined;
+    vk::Extent2D            extent  = {};
+    vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1;
+    vk::ImageAspectFlags    aspect  = vk::ImageAspectFlagBits::eColor;
+};
+
+using RGImageState = ResourceState;
+
+struct RenderGraphStatistics
+{
+    uint32_t passCount       = 0;
+    uint32_t culledPassCount = 0;
+
+    uint32_t barrierBatchCount = 0;
+    uint32_t imageBarrierCount = 0;
+
+    // memory actually allocated for transient images
+    vk::DeviceSize transientMemory = 0;
+    // memory transient images would take without aliasing
+    vk::DeviceSize unaliasedMemory = 0;
+};
+
+class RenderGraph;
+
+class RGPassContext
+{
+public:
+
+    vk::RenderPass  renderPass;
+    vk::Framebuffer framebuffer;
+    vk::Extent2D    extent;
+
+    // dispatcher passed to execute()
+    const vk::DispatchLoaderDynamic *dispatch = nullptr;
+
+    vk::Image getImage(RGImage image) const;
+
+    vk::ImageView getImageView(RGImage image) const;
+
+private:
+
+    friend class RenderGraph;
+
+    const RenderGraph *graph_ = nullptr;
+};
+
+class RGPassBuilder
+{
+public:
+
+    RGPassBuilder &colorAttachment(
+        RGImage image, std::optional<vk::ClearColorValue> clear = {});
+
+    RGPassBuilder &depthAttachment(
+        RGImage image, std::optional<vk::ClearDepthStencilValue> clear = {});
+
+    RGPassBuilder &depthAttachmentReadOnly(RGImage image);
+
+    RGPassBuilder &sampled(
+        RGImage image,
+        vk::PipelineStageFlags stages = vk::PipelineStageFlagBits::eFragmentShader);
+
+    RGPassBuilder &storage(
+        RGImage image, bool write,
+        vk::PipelineStageFlags stages = vk::PipelineStageFlagBits::eComputeShader);
+
+    RGPassBuilder &transferSrc(RGImage image);
+
+    // discard: previous content of image is not needed
+    RGPassBuilder &transferDst(RGImage image, bool discard = true);
+
+    // keep this pass even if none of its outputs is consumed
+    RGPassBuilder &sideEffect();
+
+    RGPass getPass() const noexcept;
+
+private:
+
+    friend class RenderGraph;
+
+    RGPassBuilder(RenderGraph *graph, uint32_t pass) noexcept;
+
+    RenderGraph *graph_;
+    uint32_t     pass_;
+};
+
+/**
+ * @brief frame graph with automatic barriers and transient image aliasing
+ *
+ * passes declare how they use images, at most once per image; the builder
+ * throws on a second usage. compile() culls passes whose outputs
+ * are never consumed, computes batched barriers and attachment load/store
+ * ops, creates render passes and lets transient images with disjoint
+ * lifetimes share memory. the compiled graph can be executed repeatedly;
+ * imported images (e.g. swapchain images) are bound with setImportedImage
+ * before each execute().
+ *
+ * transient memory is shared by all executions. the first use of each
+ * memory slot waits for its last use in the previous execution, so
+ * executions overlapping on the gpu (frames in flight) are safe as long as
+ * they are submitted to the same queue.
+ *
+ * framebuffers are cached by imported views. call invalidateImportedViews
+ * when these views are destroyed (e.g. on swapchain recreation).
+ */
+class RenderGraph : public misc::uncopyable_t
+{
+public:
+
+    using ExecuteFunc = std::function<
+                            void(vk::CommandBuffer, const RGPassContext &)>;
+
+    RenderGraph(vk::Device device, VMAAlloc &alloc);
+
+    ~RenderGraph();
+
+    // resources
+
+    // imported images are expected to be in 'initial' state at the beginning
+    // of each execution and are left in 'final' state at the end
+    RGImage importImage(
+        std::string         name,
+        const RGImageDesc  &desc,
+        const RGImageState &initial,
+        const RGImageState &final);
+
+    RGImage createImage(std::string name, const RGImageDesc &desc);
+
+    // passes
+
+    RGPassBuilder addPass(std::string name, ExecuteFunc func);
+
+    // build
+
+    void compile();
+
+    bool isCompiled() const noexcept;
+
+    // drop all passes, resources and compiled objects
+    void reset();
+
+    // execution
+
+    void setImportedImage(RGImage image, vk::Image handle, vk::ImageView view);
+
+    // destroy framebuffers created for previously bound imported views.
+    // the gpu must have finished executions using them
+    void invalidateImportedViews();
+
+    // dispatch is that of the device owning cmdBuf
+    void execute(
+        vk::CommandBuffer                cmdBuf,
+        const vk::DispatchLoaderDynamic &dispatch =
+            VULKAN_HPP_DEFAULT_DISPATCHER);
+
+    // queries. valid after compile
+
+    bool isCulled(RGPass pass) const;
+
+    // null if pass has no attachment
+    vk::RenderPass getRenderPass(RGPass pass) const;
+
+    const RenderGraphStatistics &getStatistics() const noexcept;
+
+private:
+
+    friend class RGPassBuilder;
+    friend class RGPassContext;
+
+    struct Usage
+    {
+        uint32_t            image      = 0;
+        RGImageState        state;
+        vk::ImageUsageFlags imageUsage = {};
+
+        bool read    = false;
+        bool write   = false;
+        bool discard = false;
+
+        // 0: none; 1: color attachment; 2: depth attachment
+        int attachment = 0;
+        std::optional<vk::ClearValue> clear;
+    };
+
+    struct Barrier
+    {
+        uint32_t        image;
+        vk::AccessFlags srcAccess;
+        vk::AccessFlags dstAccess;
+        vk::ImageLayout oldLayout;
+        vk::ImageLayout newLayout;
+    };
+
+    struct BarrierBatch
+    {
+        vk::PipelineStageFlags srcStages;
+        vk::PipelineStageFlags dstStages;
+        std::vector<Barrier>   barriers;
+
+        bool empty() const noexcept { return !srcStages && !dstStages; }
+    };
+
+    struct Pass
+    {
+        std::string name;
+        ExecuteFunc func;
+
+        std::vector<Usage> usages;
+        bool sideEffect = false;
+
+        // compiled
+
+        bool culled = false;
+
+        BarrierBatch barriers;
+
+        vk::UniqueRenderPass        renderPass;
+        std::vector<uint32_t>       attachments;
+        std::vector<vk::ClearValue> clearValues;
+        vk::Extent2D                extent;
+
+        std::map<std::vector<VkImageView>, vk::UniqueFramebuffer> framebuffers;
+    };
+
+    struct Image
+    {
+        std::string name;
+        RGImageDesc desc;
+
+        bool         imported = false;
+        RGImageState initial;
+        RGImageState final;
+
+        // compiled
+
+        vk::ImageUsageFlags usage;
+
+        uint32_t firstPass = UINT32_MAX;
+        uint32_t lastPass  = 0;
+
+        uint32_t memorySlot      = UINT32_MAX;
+        uint32_t aliasPrecursor  = UINT32_MAX;
+
+        vk::UniqueImage     ownedImage;
+        vk::UniqueImageView ownedView;
+
+        // runtime
+
+        vk::Image     image;
+        vk::ImageView view;
+    };
+
+    // distinct imported view combinations per pass before execute throws.
+    // more usually means invalidateImportedViews is never called
+    static constexpr size_t MAX_CACHED_FRAMEBUFFERS = 16;
+
+    struct MemorySlot
+    {
+        vk::DeviceSize size           = 0;
+        vk::DeviceSize alignment      = 1;
+        uint32_t       memoryTypeBits = ~0u;
+
+        std::vector<uint32_t> images;
+
+        // image using the memory last in an execution
+        uint32_t lastImage = UINT32_MAX;
+
+        VmaAllocation alloc = nullptr;
+    };
+
+    // throws if the pass already uses the image
+    void addUsage(uint32_t pass, const Usage &usage);
+
+    void cullPasses();
+
+    void collectLifetimes();
+
+    void allocateTransientImages();
+
+    void computeBarriersAndRenderPasses();
+
+    void createRenderPass(Pass &pass, const std::vector<bool> &hasContent);
+
+    vk::Framebuffer getFramebuffer(Pass &pass);
+
+    void recordBarriers(
+        vk::CommandBuffer                cmdBuf,
+        const BarrierBatch              &batch,
+        const vk::DispatchLoaderDynamic &dispatch) const;
+
+    void destroyCompiled();
+
+    vk::Device device_;
+    VMAAlloc  &alloc_;
+
+    std::vector<Pass>  passes_;
+    std::vector<Image> images_;
+
+    bool compiled_ = false;
+
+    std::vector<MemorySlot> memorySlots_;
+
+    BarrierBatch finalBarriers_;
+
+    RenderGraphStatistics statistics_;
+};
+
+inline RGPassBuilder::RGPassBuilder(RenderGraph *graph, uint32_t pass) noexcept
+    : graph_(graph), pass_(pass)
+{
+    
+}
+
+inline RGPass RGPassBuilder::getPass() const noexcept
+{
+    return { pass_ };
+}
+
+inline bool RenderGraph::isCompiled() const noexcept
+{
+    return compiled_;
+}
+
+inline const RenderGraphStatistics &RenderGraph::getStatistics() const noexcept
+{
+    return statistics_;
+}
+
+AGZ_VULKAN_LAB_END
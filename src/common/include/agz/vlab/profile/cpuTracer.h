@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <ostream>
+#include <string>
+
+#include <agz/vlab/common.h>
+
+AGZ_VULKAN_LAB_BEGIN
+
+/**
+ * @brief process-wide recorder of cpu scopes in chrome trace event format
+ *
+ * each thread appends completed scopes to its own buffer, made of linked
+ * chunks that are never reallocated. recording takes no lock; only the
+ * first event of a thread registers its buffer. the output can be opened
+ * in chrome://tracing or ui.perfetto.dev.
+ *
+ * timestamps are nanoseconds of std::chrono::steady_clock. gpu events
+ * converted to this clock (see GpuProfilerDesc::traceEvents) are shown on
+ * a separate 'GPU' track.
+ *
+ * event names are stored as pointers and must outlive the export, e.g.
+ * string literals or names returned by internName.
+ */
+class CpuTracer
+{
+public:
+
+    static void start();
+
+    static void stop();
+
+    static bool isEnabled() noexcept;
+
+    static uint64_t now() noexcept;
+
+    // shown as the name of the calling thread's track
+    static void setThreadName(const std::string &name);
+
+    // returns a pointer valid until the process exits
+    static const char *internName(const std::string &name);
+
+    static void addEvent(const char *name, uint64_t beginNs, uint64_t endNs);
+
+    static void addGpuEvent(const char *name, uint64_t beginNs, uint64_t endNs);
+
+    // drop recorded events and free their memory, except the chunk each
+    // thread is writing to. may be called while other threads are recording
+    static void clear();
+
+    static void writeChromeTrace(std::ostream &out);
+
+private:
+
+    static inline std::atomic<bool> enabled_ = false;
+};
+
+class CpuTraceScope : public misc::uncopyable_t
+{
+public:
+
+    explicit CpuTraceScope(const char *name) noexcept;
+
+    ~CpuTraceScope();
+
+private:
+
+    const char *name_;
+    uint64_t    begin_;
+};
+
+inline bool CpuTracer::isEnabled() noexcept
+{
+    return enabled_.load(std::memory_order_relaxed);
+}
+
+inline CpuTraceScope::CpuTraceScope(const char *name) noexcept
+    : name_(name), begin_(CpuTracer::isEnabled() ? CpuTracer::now() : 0)
+{
+
+}
+
+inline CpuTraceScope::~CpuTraceScope()
+{
+    if(begin_)
+        CpuTracer::addEvent(name_, begin_, CpuTracer::now());
+}
+
+AGZ_VULKAN_LAB_END
+
+// scopes compile to nothing with AGZ_VLAB_DISABLE_TRACE
+
+#define AGZ_VLAB_TRACE_CAT_IMPL(A, B) A##B
+#define AGZ_VLAB_TRACE_CAT(A, B) AGZ_VLAB_TRACE_CAT_IMPL(A, B)
+
+#ifdef AGZ_VLAB_DISABLE_TRACE
+
+#define AGZ_VLAB_TRACE_SCOPE(NAME) ((void)0)
+
+#else
+
+#define AGZ_VLAB_TRACE_SCOPE(NAME) \
+    ::agz::vlab::CpuTraceScope AGZ_VLAB_TRACE_CAT(agzVLabTraceScope, __LINE__)(NAME)
+
+#endif
+
+#define AGZ_VLAB_TRACE_FUNCTION() AGZ_VLAB_TRACE_SCOPE(__func__)
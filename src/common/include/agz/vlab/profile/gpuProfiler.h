@@ -0,0 +1,233 @@
+#pragma once
+
+#include <deque>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <agz/vlab/common.h>
+
+AGZ_VULKAN_LAB_BEGIN
+
+struct GpuProfilerDesc
+{
+    // number of per-frame query pools. must not be less than the frames
+    // in flight, since a pool is read back when its frame index comes again
+    uint32_t frameCount = 3;
+
+    // scopes exceeding this in one frame are dropped
+    uint32_t maxScopesPerFrame = 64;
+
+    // samples kept for each scope name
+    uint32_t historySize = 256;
+
+    // emit scopes to CpuTracer while it is enabled. ignored unless
+    // VK_EXT_calibrated_timestamps is enabled on the device
+    // (see GraphicsDevice::isCalibratedTimestampsEnabled)
+    bool traceEvents = false;
+};
+
+/**
+ * @brief gpu timing of command ranges with timestamp queries
+ *
+ * owns one query pool for each frame index. per frame:
+ *
+ *   1. beginFrame(frameIndex), after the previous submission using
+ *      frameIndex is known to be complete (e.g. after FrameScheduler or
+ *      FrameContext::beginFrame). results of that submission are read back
+ *      without waiting and appended to the history.
+ *   2. resetQueries(cmd), outside of any render pass, before other commands
+ *      of the profiler in the same submission.
+ *   3. beginScope/endScope or GpuScope around the commands to measure.
+ *
+ * scopes with the same name in one frame are summed. timestamps are written
+ * at top/bottom of pipe and converted to milliseconds with timestampPeriod.
+ *
+ * not thread safe. scopes must not be recorded into command buffers that are
+ * replayed in later frames, since queries are assigned at record time.
+ */
+class GpuProfiler : public misc::uncopyable_t
+{
+public:
+
+    using ScopeID = uint32_t;
+
+    static constexpr ScopeID INVALID_SCOPE = UINT32_MAX;
+
+    struct Sample
+    {
+        // number of profiler frames since construction, starting from 1
+        uint64_t frame = 0;
+
+        float ms = 0;
+    };
+
+    struct ScopeStats
+    {
+        std::string name;
+
+        float last = 0;
+        float avg  = 0;
+        float min  = 0;
+        float max  = 0;
+
+        uint32_t sampleCount = 0;
+    };
+
+    GpuProfiler(
+        vk::PhysicalDevice     physicalDevice,
+        vk::Device             device,
+        uint32_t               queueFamilyIndex,
+        const GpuProfilerDesc &desc = {});
+
+    ~GpuProfiler();
+
+    // false if the queue family doesn't support timestamps,
+    // in which case all recording functions are no-ops
+    bool isAvailable() const noexcept;
+
+    // read back results of the previous use of 'frameIndex' and start
+    // a new frame with it
+    void beginFrame(uint32_t frameIndex);
+
+    // recording functions take the dispatcher of the device owning cmd
+
+    void resetQueries(
+        vk::CommandBuffer                cmd,
+        const vk::DispatchLoaderDynamic &dispatch =
+            VULKAN_HPP_DEFAULT_DISPATCHER);
+
+    ScopeID beginScope(
+        vk::CommandBuffer                cmd,
+        const char                      *name,
+        const vk::DispatchLoaderDynamic &dispatch =
+            VULKAN_HPP_DEFAULT_DISPATCHER);
+
+    // cmd may differ from the one passed to beginScope if both are
+    // submitted to the same queue in order
+    void endScope(
+        vk::CommandBuffer                cmd,
+        ScopeID                          scope,
+        const vk::DispatchLoaderDynamic &dispatch =
+            VULKAN_HPP_DEFAULT_DISPATCHER);
+
+    // scope names having at least one sample, in lexicographical order
+    std::vector<std::string> getScopeNames() const;
+
+    // oldest first. nullptr if no sample of 'name' is collected
+    const std::deque<Sample> *getHistory(const std::string &name) const;
+
+    // all zero if no sample of 'name' is collected
+    ScopeStats getStats(const std::string &name) const;
+
+    std::vector<ScopeStats> getAllStats() const;
+
+    // latest sample of 'name' or 0
+    float getLastTime(const std::string &name) const;
+
+    // one 'frame,scope,ms' row per sample
+    void exportCSV(std::ostream &out) const;
+
+    // { "scopes": [ { "name", "frames": [...], "ms": [...] } ] }
+    void exportJSON(std::ostream &out) const;
+
+    void clearHistory();
+
+private:
+
+    struct Scope
+    {
+        std::string name;
+        bool        ended = false;
+    };
+
+    struct Frame
+    {
+        vk::UniqueQueryPool pool;
+
+        uint64_t frame   = 0;
+        bool     reset   = false;
+        bool     pending = false;
+
+        // scope i uses query 2i and 2i + 1
+        std::vector<Scope> scopes;
+    };
+
+    void collect(Frame &frame);
+
+    // a device timestamp and the steady_clock time (ns) it corresponds to
+    bool calibrate(uint64_t &gpuTicks, uint64_t &hostNs) const;
+
+    GpuProfilerDesc desc_;
+
+    vk::Device device_;
+
+    bool     available_       = false;
+    double   timestampPeriod_ = 1;
+    uint64_t timestampMask_   = 0;
+
+    bool traceEvents_        = false;
+    bool hostClockMonotonic_ = false;
+
+    uint64_t frameNumber_ = 0;
+
+    Frame *currentFrame_ = nullptr;
+
+    std::vector<Frame> frames_;
+
+    std::map<std::string, std::deque<Sample>> history_;
+
+    std::vector<uint64_t> queryResults_;
+};
+
+/**
+ * @brief RAII wrapper of GpuProfiler::beginScope/endScope
+ *
+ * no-op if profiler is nullptr
+ */
+class GpuScope : public misc::uncopyable_t
+{
+public:
+
+    GpuScope(
+        GpuProfiler                     *profiler,
+        vk::CommandBuffer                cmd,
+        const char                      *name,
+        const vk::DispatchLoaderDynamic &dispatch =
+            VULKAN_HPP_DEFAULT_DISPATCHER);
+
+    ~GpuScope();
+
+private:
+
+    GpuProfiler                     *profiler_;
+    vk::CommandBuffer                cmd_;
+    const vk::DispatchLoaderDynamic *dispatch_;
+    GpuProfiler::ScopeID             scope_;
+};
+
+inline bool GpuProfiler::isAvailable() const noexcept
+{
+    return available_;
+}
+
+inline GpuScope::GpuScope(
+    GpuProfiler                     *profiler,
+    vk::CommandBuffer                cmd,
+    const char                      *name,
+    const vk::DispatchLoaderDynamic &dispatch)
+    : profiler_(profiler), cmd_(cmd), dispatch_(&dispatch),
+      scope_(GpuProfiler::INVALID_SCOPE)
+{
+    if(profiler_)
+        scope_ = profiler_->beginScope(cmd_, name, *dispatch_);
+}
+
+inline GpuScope::~GpuScope()
+{
+    if(profiler_)
+        profiler_->endScope(cmd_, scope_, *dispatch_);
+}
+
+AGZ_VULKAN_LAB_END
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <agz/vlab/common.h>
+
+AGZ_VULKAN_LAB_BEGIN
+
+struct PipelineStatsDesc
+{
+    // see GpuProfilerDesc::frameCount
+    uint32_t frameCount = 3;
+
+    // scopes exceeding this in one frame are dropped
+    uint32_t maxScopesPerFrame = 64;
+
+    // also count samples passing depth/stencil tests in each scope
+    bool occlusion = false;
+
+    // exact sample counts instead of zero/non-zero. requires
+    // DeviceFeature::OcclusionQueryPrecise
+    bool preciseOcclusion = false;
+};
+
+struct PipelineStats
+{
+    uint64_t vertexInvocations   = 0;
+    uint64_t clippingInvocations = 0;
+    uint64_t clippingPrimitives  = 0;
+    uint64_t fragmentInvocations = 0;
+
+    // 0 unless occlusion is enabled
+    uint64_t samplesPassed = 0;
+
+    PipelineStats &operator+=(const PipelineStats &rhs) noexcept;
+};
+
+/**
+ * @brief pipeline statistics (and optionally occlusion) queries around
+ *        draws, aggregated by scope name
+ *
+ * names are typically passes or materials. results are read back in the
+ * same way as GpuProfiler: call beginFrame(frameIndex) once the previous
+ * use of frameIndex completed, and resetQueries(cmd) outside of render
+ * passes before any scope of the frame.
+ *
+ * requires DeviceFeature::PipelineStatisticsQuery. since only one query of
+ * each type can be active in a command buffer, scopes can't be nested.
+ * a scope begun inside a render pass must end in the same subpass.
+ */
+class PipelineStatsProfiler : public misc::uncopyable_t
+{
+public:
+
+    using ScopeID = uint32_t;
+
+    static constexpr ScopeID INVALID_SCOPE = UINT32_MAX;
+
+    struct Accumulated
+    {
+        PipelineStats sum;
+
+        // frames containing the scope since the last resetAccumulated
+        uint64_t frameCount = 0;
+    };
+
+    PipelineStatsProfiler(
+        vk::Device device, const PipelineStatsDesc &desc = {});
+
+    ~PipelineStatsProfiler();
+
+    void beginFrame(uint32_t frameIndex);
+
+    // recording functions take the dispatcher of the device owning cmd
+
+    void resetQueries(
+        vk::CommandBuffer                cmd,
+        const vk::DispatchLoaderDynamic &dispatch =
+            VULKAN_HPP_DEFAULT_DISPATCHER);
+
+    ScopeID beginScope(
+        vk::CommandBuffer                cmd,
+        const char                      *name,
+        const vk::DispatchLoaderDynamic &dispatch =
+            VULKAN_HPP_DEFAULT_DISPATCHER);
+
+    void endScope(
+        vk::CommandBuffer                cmd,
+        ScopeID                          scope,
+        const vk::DispatchLoaderDynamic &dispatch =
+            VULKAN_HPP_DEFAULT_DISPATCHER);
+
+    // stats of the latest collected frame containing 'name'
+    PipelineStats getLastFrame(const std::string &name) const;
+
+    const std::map<std::string, Accumulated> &getAccumulated() const noexcept;
+
+    void resetAccumulated();
+
+    // per-frame averages since the last resetAccumulated, one scope a line
+    void printAverages(std::ostream &out) const;
+
+private:
+
+    struct Scope
+    {
+        std::string name;
+        bool        ended = false;
+    };
+
+    struct Frame
+    {
+        vk::UniqueQueryPool statsPool;
+        vk::UniqueQueryPool occlusionPool;
+
+        bool reset   = false;
+        bool pending = false;
+
+        // scope i uses query i of each pool
+        std::vector<Scope> scopes;
+    };
+
+    void collect(Frame &frame);
+
+    PipelineStatsDesc desc_;
+
+    vk::Device device_;
+
+    Frame *currentFrame_ = nullptr;
+
+    std::vector<Frame> frames_;
+
+    std::map<std::string, PipelineStats> lastFrame_;
+    std::map<std::string, Accumulated>   accumulated_;
+
+    std::vector<uint64_t> queryResults_;
+};
+
+/**
+ * @brief RAII wrapper of PipelineStatsProfiler::beginScope/endScope
+ *
+ * no-op if profiler is nullptr
+ */
+class PipelineStatsScope : public misc::uncopyable_t
+{
+public:
+
+    PipelineStatsScope(
+        PipelineStatsProfiler           *profiler,
+        vk::CommandBuffer                cmd,
+        const char                      *name,
+        const vk::DispatchLoaderDynamic &dispatch =
+            VULKAN_HPP_DEFAULT_DISPATCHER);
+
+    ~PipelineStatsScope();
+
+private:
+
+    PipelineStatsProfiler           *profiler_;
+    vk::CommandBuffer                cmd_;
+    const vk::DispatchLoaderDynamic *dispatch_;
+    PipelineStatsProfiler::ScopeID   scope_;
+};
+
+inline PipelineStats &PipelineStats::operator+=(
+    const PipelineStats &rhs) noexcept
+{
+    vertexInvocations   += rhs.vertexInvocations;
+    clippingInvocations += rhs.clippingInvocations;
+    clippingPrimitives  += rhs.clippingPrimitives;
+    fragmentInvocations += rhs.fragmentInvocations;
+    samplesPassed       += rhs.samplesPassed;
+    return *this;
+}
+
+inline const std::map<std::string, PipelineStatsProfiler::Accumulated> &
+    PipelineStatsProfiler::getAccumulated() const noexcept
+{
+    return accumulated_;
+}
+
+inline PipelineStatsScope::PipelineStatsScope(
+    PipelineStatsProfiler           *profiler,
+    vk::CommandBuffer                cmd,
+    const char                      *name,
+    const vk::DispatchLoaderDynamic &dispatch)
+    : profiler_(profiler), cmd_(cmd), dispatch_(&dispatch),
+      scope_(PipelineStatsProfiler::INVALID_SCOPE)
+{
+    if(profiler_)
+        scope_ = profiler_->beginScope(cmd_, name, *dispatch_);
+}
+
+inline PipelineStatsScope::~PipelineStatsScope()
+{
+    if(profiler_)
+        profiler_->endScope(cmd_, scope_, *dispatch_);
+}
+
+AGZ_VULKAN_LAB_END
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <memory>
+
+#include <agz/vlab/common.h>
+
+AGZ_VULKAN_LAB_BEGIN
+
+/**
+ * @brief position on the timeline of a queue
+ *
+ * returned by FrameScheduler::submit. can be polled/waited to track
+ * completion of a specific submission (e.g. a texture upload).
+ */
+struct TimelinePoint
+{
+    vk::Queue queue;
+    uint64_t  value = 0;
+};
+
+/**
+ * @brief frame pacing based on timeline semaphores
+ *
+ * owns one timeline semaphore per queue. every submission made through
+ * submit() signals the next value of its queue's timeline, and the scheduler
+ * remembers which frame each value belongs to. frame numbers start from 1 and
+ * increase monotonically; frame n is complete once every queue has reached
+ * the last value it signaled in frames <= n.
+ *
+ * beginFrame() blocks until the frame 'framesInFlight' frames ago completes,
+ * so per-frame resources indexed by getFrameIndex() can be reused safely
+ * without fences.
+ *
+ * the device must have the timelineSemaphore feature enabled
+ * (see GraphicsDevice::isTimelineSemaphoreEnabled).
+ */
+class FrameScheduler : public misc::uncopyable_t
+{
+public:
+
+    // wait for all work submitted so far to 'queue' before 'stages'
+    struct QueueDependency
+    {
+        vk::Queue              queue;
+        vk::PipelineStageFlags stages;
+    };
+
+    FrameScheduler(vk::Device device, uint32_t framesInFlight);
+
+    ~FrameScheduler();
+
+    uint32_t getFramesInFlight() const noexcept;
+
+    // waits for all submitted work since frame indices are remapped
+    void setFramesInFlight(uint32_t framesInFlight);
+
+    // number of the frame being recorded
+    uint64_t getCurrentFrame() const noexcept;
+
+    // index of per-frame resources of current frame
+    uint32_t getFrameIndex() const noexcept;
+
+    // wait for the frame using the same frame index,
+    // then run deferred tasks whose frames have completed
+    void beginFrame();
+
+    // move to next frame
+    void endFrame();
+
+    // submit 'info' with an additional signal operation on the timeline of
+    // 'queue'. binary semaphores in 'info' are kept as is
+    TimelinePoint submit(
+        vk::Queue                           queue,
+        const vk::SubmitInfo               &info,
+        const std::vector<QueueDependency> &deps  = {},
+        vk::Fence                           fence = nullptr);
+
+    // non-blocking
+    bool isFrameComplete(uint64_t frame) const;
+
+    bool isComplete(const TimelinePoint &point) const;
+
+    void waitFrame(uint64_t frame);
+
+    void wait(const TimelinePoint &point);
+
+    // wait for all submitted work and run all deferred tasks
+    void waitIdle();
+
+    // run 'func' after all work submitted in current frame completes.
+    // typically used to destroy resources still referenced by the gpu
+    void defer(std::function<void()> func);
+
+    // run 'func' after 'point' completes
+    void deferUntil(const TimelinePoint &point, std::function<void()> func);
+
+    // run completed deferred tasks without blocking
+    void collect();
+
+    // timeline semaphore of 'queue'. can be used in submissions not made
+    // through submit(), which must not signal it
+    vk::Semaphore getTimeline(vk::Queue queue);
+
+    // last value signaled on the timeline of 'queue'
+    uint64_t getLastSubmittedValue(vk::Queue queue);
+
+private:
+
+    struct QueueTimeline
+    {
+        vk::Queue           queue;
+        vk::UniqueSemaphore semaphore;
+        uint64_t            lastValue = 0;
+
+        // (frame, last value signaled in that frame) not known to be reached
+        mutable std::deque<std::pair<uint64_t, uint64_t>> pending;
+    };
+
+    struct DeferredTask
+    {
+        // frame != 0: wait for frame; otherwise wait for point
+        uint64_t              frame = 0;
+        TimelinePoint         point;
+        std::function<void()> func;
+    };
+
+    QueueTimeline &getQueueTimeline(vk::Queue queue);
+
+    const QueueTimeline *findQueueTimeline(vk::Queue queue) const noexcept;
+
+    bool isTaskReady(const DeferredTask &task) const;
+
+    vk::Device device_;
+
+    uint32_t framesInFlight_;
+    uint64_t currentFrame_ = 1;
+
+    std::vector<std::unique_ptr<QueueTimeline>> timelines_;
+
+    std::vector<DeferredTask> deferredTasks_;
+};
+
+inline uint32_t FrameScheduler::getFramesInFlight() const noexcept
+{
+    return framesInFlight_;
+}
+
+inline uint64_t FrameScheduler::getCurrentFrame() const noexcept
+{
+    return currentFrame_;
+}
+
+inline uint32_t FrameScheduler::getFrameIndex() const noexcept
+{
+    return static_cast<uint32_t>(currentFrame_ % framesInFlight_);
+}
+
+AGZ_VULKAN_LAB_END
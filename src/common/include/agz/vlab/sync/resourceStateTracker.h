@@ -0,0 +1,207 @@
+#pragma once
+
+#include <unordered_map>
+
+#include <agz/vlab/common.h>
+
+AGZ_VULKAN_LAB_BEGIN
+
+class GraphicsDevice;
+
+struct ResourceState
+{
+    vk::ImageLayout        layout = vk::ImageLayout::eUndefined;
+    vk::PipelineStageFlags stages = vk::PipelineStageFlagBits::eTopOfPipe;
+    vk::AccessFlags        access = {};
+};
+
+struct ResourceTransition
+{
+    vk::PipelineStageFlags srcStages;
+    vk::PipelineStageFlags dstStages;
+
+    vk::AccessFlags srcAccess;
+    vk::AccessFlags dstAccess;
+
+    vk::ImageLayout oldLayout = vk::ImageLayout::eUndefined;
+    vk::ImageLayout newLayout = vk::ImageLayout::eUndefined;
+
+    // false if an execution dependency is enough
+    bool memoryBarrier = false;
+};
+
+/**
+ * @brief synchronization state machine of a single (sub)resource
+ */
+struct ResourceAccessState
+{
+    vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+
+    // last writer (or layout transition)
+    vk::PipelineStageFlags writeStages;
+    vk::AccessFlags        writeAccess;
+
+    // readers since last write
+    vk::PipelineStageFlags readStages;
+
+    // stages/accesses to which the last write has been made visible
+    vk::PipelineStageFlags visibleStages;
+    vk::AccessFlags        visibleAccess;
+
+    static ResourceAccessState fromState(const ResourceState &state) noexcept;
+
+    // move to 'next'. returns false if no dependency is required.
+    // discard: previous content is not needed (allows oldLayout = undefined)
+    bool transition(
+        const ResourceState &next, bool discard, ResourceTransition &out);
+};
+
+bool isWriteAccess(vk::AccessFlags access) noexcept;
+
+/**
+ * @brief tracks layout/stage/access of images (per subresource) and buffers
+ *
+ * callers declare the next usage of a resource with use*(). transitions are
+ * accumulated and recorded by flush() as a single barrier command; redundant
+ * transitions are dropped and repeated usages of the same subresource
+ * within one batch are merged.
+ *
+ * when constructed with useSynchronization2 and the vulkan headers provide
+ * VK_KHR_synchronization2, flush() emits one vkCmdPipelineBarrier2KHR with
+ * per-barrier stage masks. the device must have synchronization2 enabled.
+ * constructed from a GraphicsDevice, it is used whenever
+ * DeviceFeature::Synchronization2 is enabled on that device.
+ */
+class ResourceStateTracker : public misc::uncopyable_t
+{
+public:
+
+    struct Statistics
+    {
+        uint64_t requestCount = 0;
+        uint64_t droppedCount = 0;
+        uint64_t mergedCount  = 0;
+        uint64_t barrierCount = 0;
+        uint64_t flushCount   = 0;
+    };
+
+    explicit ResourceStateTracker(bool useSynchronization2 = false);
+
+    explicit ResourceStateTracker(const GraphicsDevice &device);
+
+    bool isUsingSynchronization2() const noexcept;
+
+    // registration
+
+    void trackImage(
+        vk::Image            image,
+        vk::ImageAspectFlags aspect,
+        uint32_t             mipLevels,
+        uint32_t             arrayLayers,
+        const ResourceState &initial);
+
+    void trackBuffer(vk::Buffer buffer, const ResourceState &initial);
+
+    void untrackImage(vk::Image image);
+
+    void untrackBuffer(vk::Buffer buffer);
+
+    void clear();
+
+    // usages
+
+    // an empty range (levelCount == 0) means the whole image
+    void useImage(
+        vk::Image                        image,
+        const ResourceState             &next,
+        const vk::ImageSubresourceRange &range   = {},
+        bool                             discard = false);
+
+    void useBuffer(vk::Buffer buffer, const ResourceState &next);
+
+    // record pending transitions as one barrier command. dispatch is that
+    // of the device owning cmdBuf
+    void flush(
+        vk::CommandBuffer                cmdBuf,
+        const vk::DispatchLoaderDynamic &dispatch =
+            VULKAN_HPP_DEFAULT_DISPATCHER);
+
+    bool hasPendingBarriers() const noexcept;
+
+    // queries
+
+    ResourceState getImageState(
+        vk::Image image, uint32_t mipLevel = 0, uint32_t arrayLayer = 0) const;
+
+    const Statistics &getStatistics() const noexcept;
+
+private:
+
+    struct PendingImageBarrier
+    {
+        vk::Image                 image;
+        vk::ImageSubresourceRange range;
+        ResourceTransition        transition;
+    };
+
+    struct PendingBufferBarrier
+    {
+        vk::Buffer         buffer;
+        ResourceTransition transition;
+    };
+
+    struct ImageRecord
+    {
+        vk::ImageAspectFlags aspect;
+        uint32_t             mipLevels   = 1;
+        uint32_t             arrayLayers = 1;
+
+        std::vector<ResourceAccessState> states;
+
+        // index of pending barrier of each subresource, -1 for none
+        std::vector<int> pending;
+    };
+
+    struct BufferRecord
+    {
+        ResourceAccessState state;
+        int                 pending = -1;
+    };
+
+    static void merge(ResourceTransition &dst, const ResourceTransition &src);
+
+    bool useSync2_;
+
+    std::unordered_map<VkImage,  ImageRecord>  images_;
+    std::unordered_map<VkBuffer, BufferRecord> buffers_;
+
+    // execution-only dependencies
+    vk::PipelineStageFlags execSrcStages_;
+    vk::PipelineStageFlags execDstStages_;
+
+    std::vector<PendingImageBarrier>  imageBarriers_;
+    std::vector<PendingBufferBarrier> bufferBarriers_;
+
+    // (image, subresource index) with pending barrier
+    std::vector<std::pair<VkImage, size_t>> pendingSubrscs_;
+
+    Statistics statistics_;
+};
+
+inline bool ResourceStateTracker::isUsingSynchronization2() const noexcept
+{
+    return useSync2_;
+}
+
+inline bool ResourceStateTracker::hasPendingBarriers() const noexcept
+{
+    return execSrcStages_ || !imageBarriers_.empty() || !bufferBarriers_.empty();
+}
+
+inline const ResourceStateTracker::Statistics &
+    ResourceStateTracker::getStatistics() const noexcept
+{
+    return statistics_;
+}
+
+AGZ_VULKAN_LAB_END
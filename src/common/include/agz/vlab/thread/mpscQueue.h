@@ -0,0 +1,120 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+#include <agz/vlab/common.h>
+
+AGZ_VULKAN_LAB_BEGIN
+
+/**
+ * @brief bounded lock-free multi-producer single-consumer queue
+ *
+ * tryPush may be called by any thread and tryPop by one thread only.
+ * capacity is rounded up to a power of 2.
+ *
+ * each cell carries a sequence number telling whether it is ready to be
+ * written or read in the current round, so producers only contend on the
+ * tail index.
+ */
+template<typename T>
+class MPSCQueue : public misc::uncopyable_t
+{
+public:
+
+    explicit MPSCQueue(size_t capacity);
+
+    size_t getCapacity() const noexcept;
+
+    // returns false if the queue is full
+    bool tryPush(T value);
+
+    // returns false if the queue is empty
+    bool tryPop(T &value);
+
+private:
+
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T                   value;
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t                  size_;
+    size_t                  mask_;
+
+    // next index to pop. written by consumer
+    alignas(CACHE_LINE_SIZE) size_t head_ = 0;
+
+    // next index to push. claimed by producers
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail_ = { 0 };
+};
+
+template<typename T>
+MPSCQueue<T>::MPSCQueue(size_t capacity)
+{
+    size_ = 2;
+    while(size_ < capacity)
+        size_ <<= 1;
+
+    cells_ = std::make_unique<Cell[]>(size_);
+    mask_  = size_ - 1;
+
+    for(size_t i = 0; i < size_; ++i)
+        cells_[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+template<typename T>
+size_t MPSCQueue<T>::getCapacity() const noexcept
+{
+    return size_;
+}
+
+template<typename T>
+bool MPSCQueue<T>::tryPush(T value)
+{
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    for(;;)
+    {
+        Cell &cell = cells_[tail & mask_];
+        const size_t seq = cell.sequence.load(std::memory_order_acquire);
+        const auto diff = static_cast<std::ptrdiff_t>(seq - tail);
+
+        // cell is free in this round
+        if(diff == 0)
+        {
+            if(tail_.compare_exchange_weak(
+                tail, tail + 1, std::memory_order_relaxed))
+            {
+                cell.value = std::move(value);
+                cell.sequence.store(tail + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        // cell still holds the value of the previous round
+        else if(diff < 0)
+            return false;
+        else
+            tail = tail_.load(std::memory_order_relaxed);
+    }
+}
+
+template<typename T>
+bool MPSCQueue<T>::tryPop(T &value)
+{
+    Cell &cell = cells_[head_ & mask_];
+    if(cell.sequence.load(std::memory_order_acquire) != head_ + 1)
+        return false;
+
+    value = std::move(cell.value);
+    cell.sequence.store(head_ + size_, std::memory_order_release);
+    ++head_;
+
+    return true;
+}
+
+AGZ_VULKAN_LAB_END
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+#include <agz/vlab/common.h>
+
+AGZ_VULKAN_LAB_BEGIN
+
+/**
+ * @brief bounded lock-free single-producer single-consumer queue
+ *
+ * tryPush must only be called by one thread and tryPop by another one.
+ * capacity is rounded up to a power of 2.
+ */
+template<typename T>
+class SPSCQueue : public misc::uncopyable_t
+{
+public:
+
+    explicit SPSCQueue(size_t capacity);
+
+    size_t getCapacity() const noexcept;
+
+    // returns false if the queue is full
+    bool tryPush(T value);
+
+    // returns false if the queue is empty
+    bool tryPop(T &value);
+
+    // approximate when called concurrently with tryPush/tryPop
+    bool empty() const noexcept;
+
+private:
+
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    std::vector<T> buffer_;
+    size_t         mask_;
+
+    // next index to pop. written by consumer
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> head_ = { 0 };
+
+    // next index to push. written by producer
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail_ = { 0 };
+};
+
+template<typename T>
+SPSCQueue<T>::SPSCQueue(size_t capacity)
+{
+    size_t size = 2;
+    while(size < capacity)
+        size <<= 1;
+
+    buffer_.resize(size);
+    mask_ = size - 1;
+}
+
+template<typename T>
+size_t SPSCQueue<T>::getCapacity() const noexcept
+{
+    return buffer_.size();
+}
+
+template<typename T>
+bool SPSCQueue<T>::tryPush(T value)
+{
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if(tail - head_.load(std::memory_order_acquire) >= buffer_.size())
+        return false;
+
+    buffer_[tail & mask_] = std::move(value);
+    tail_.store(tail + 1, std::memory_order_release);
+
+    return true;
+}
+
+template<typename T>
+bool SPSCQueue<T>::tryPop(T &value)
+{
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if(head == tail_.load(std::memory_order_acquire))
+        return false;
+
+    value = std::move(buffer_[head & mask_]);
+    head_.store(head + 1, std::memory_order_release);
+
+    return true;
+}
+
+template<typename T>
+bool SPSCQueue<T>::empty() const noexcept
+{
+    return head_.load(std::memory_order_acquire) ==
+           tail_.load(std::memory_order_acquire);
+}
+
+AGZ_VULKAN_LAB_END
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <agz/vlab/common.h>
+
+AGZ_VULKAN_LAB_BEGIN
+
+/**
+ * @brief runs a dag of one-shot tasks on a temporary thread pool
+ *
+ * a task starts once all its dependencies have finished. tasks marked as
+ * main thread tasks (e.g. glfw window creation) only run on the thread
+ * calling run(), which also executes other tasks while waiting.
+ *
+ * if a task throws, no new task is started and the first exception is
+ * rethrown by run() after running tasks have finished.
+ */
+class TaskGraph : public misc::uncopyable_t
+{
+public:
+
+    using TaskID = size_t;
+
+    struct TaskTiming
+    {
+        std::string name;
+
+        // milliseconds since run() was called
+        double start    = 0;
+        double duration = 0;
+
+        // 0 is the calling thread
+        uint32_t thread = 0;
+    };
+
+    // dependencies must have been added before
+    TaskID addTask(
+        std::string                  name,
+        std::function<void()>        func,
+        const std::vector<TaskID>   &dependencies = {},
+        bool                         mainThread   = false);
+
+    // threadCount == 0 means std::thread::hardware_concurrency().
+    // the calling thread is counted as one of them
+    void run(uint32_t threadCount = 0);
+
+    // in task order. valid after run()
+    const std::vector<TaskTiming> &getTimings() const noexcept;
+
+    // total time of the last run() in milliseconds
+    double getTotalTime() const noexcept;
+
+    // one line per task with start, duration and a bar on a common timeline
+    void printTimings(std::ostream &out) const;
+
+private:
+
+    struct Task
+    {
+        std::string           name;
+        std::function<void()> func;
+        std::vector<TaskID>   dependents;
+        size_t                dependencyCount = 0;
+        bool                  mainThread      = false;
+    };
+
+    std::vector<Task>       tasks_;
+    std::vector<TaskTiming> timings_;
+    double                  totalTime_ = 0;
+};
+
+inline const std::vector<TaskGraph::TaskTiming> &
+    TaskGraph::getTimings() const noexcept
+{
+    return timings_;
+}
+
+inline double TaskGraph::getTotalTime() const noexcept
+{
+    return totalTime_;
+}
+
+AGZ_VULKAN_LAB_END
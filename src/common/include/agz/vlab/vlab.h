@@ -1,5 +1,16 @@
 #pragma once
 
+#include <agz/vlab/command/cachedCommandBuffers.h>
+#include <agz/vlab/command/frameContext.h>
+#include <agz/vlab/command/parallelCommandRecorder.h>
+#include <agz/vlab/graph/renderGraph.h>
+#include <agz/vlab/profile/cpuTracer.h>
+#include <agz/vlab/profile/gpuProfiler.h>
+#include <agz/vlab/profile/pipelineStatistics.h>
 #include <agz/vlab/shader/shaderCompiler.h>
+#include <agz/vlab/sync/frameScheduler.h>
+#include <agz/vlab/sync/resourceStateTracker.h>
+#include <agz/vlab/thread/taskGraph.h>
 #include <agz/vlab/vma/vmaAlloc.h>
+#include <agz/vlab/window/debugUtils.h>
 #include <agz/vlab/window/window.h>
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <atomic>
+
 #include <agz/vlab/common.h>
+#include <agz/vlab/window/debugUtils.h>
 
 #include <vma/vk_mem_alloc.h>
 
@@ -79,35 +82,54 @@ class VMAAlloc : public misc::uncopyable_t
 {
 public:
 
+    // dispatch is used to name objects and must outlive the allocator
     VMAAlloc(
-        vk::Instance       instance,
-        vk::PhysicalDevice physicalDevice,
-        vk::Device         device);
+        vk::Instance                     instance,
+        vk::PhysicalDevice               physicalDevice,
+        vk::Device                       device,
+        const vk::DispatchLoaderDynamic &dispatch =
+            VULKAN_HPP_DEFAULT_DISPATCHER);
 
     ~VMAAlloc();
 
+    // name is the debug utils object name (see setDebugName). objects
+    // without a name are called "vma buffer/image <index>"
+
     std::pair<vk::Buffer, VmaAllocation> createBuffer(
         const vk::BufferCreateInfo    &bufferCreateInfo,
-        const VmaAllocationCreateInfo &allocCreateInfo);
+        const VmaAllocationCreateInfo &allocCreateInfo,
+        const char                    *name = nullptr);
 
     std::pair<vk::Image, VmaAllocation> createImage(
         const vk::ImageCreateInfo     &imageCreateInfo,
-        const VmaAllocationCreateInfo &allocCreateInfo);
+        const VmaAllocationCreateInfo &allocCreateInfo,
+        const char                    *name = nullptr);
 
     VMAUniqueBuffer createBufferUnique(
         const vk::BufferCreateInfo    &bufferCreateInfo,
-        const VmaAllocationCreateInfo &allocCreateInfo);
+        const VmaAllocationCreateInfo &allocCreateInfo,
+        const char                    *name = nullptr);
     
     VMAUniqueImage createImageUnique(
         const vk::ImageCreateInfo     &imageCreateInfo,
-        const VmaAllocationCreateInfo &allocCreateInfo);
+        const VmaAllocationCreateInfo &allocCreateInfo,
+        const char                    *name = nullptr);
 
     VMAUniqueBuffer createStagingBufferUnique(
         size_t byteSize, const void *initData);
 
+    VmaAllocator getAllocator() const noexcept;
+
 private:
 
+    vk::Device device_;
+
+    const vk::DispatchLoaderDynamic *dispatch_;
+
     VmaAllocator alloc_ = nullptr;
+
+    std::atomic<uint32_t> bufferCount_ = { 0 };
+    std::atomic<uint32_t> imageCount_  = { 0 };
 };
 
 inline VMAUniqueBuffer::VMAUniqueBuffer()
@@ -248,9 +270,11 @@ inline void VMAUniqueImage::swap(VMAUniqueImage &other) noexcept
 }
 
 inline VMAAlloc::VMAAlloc(
-    vk::Instance       instance,
-    vk::PhysicalDevice physicalDevice,
-    vk::Device         device)
+    vk::Instance                     instance,
+    vk::PhysicalDevice               physicalDevice,
+    vk::Device                       device,
+    const vk::DispatchLoaderDynamic &dispatch)
+    : device_(device), dispatch_(&dispatch)
 {
     VmaAllocatorCreateInfo info = {};
     info.instance       = instance;
@@ -272,7 +296,8 @@ inline VMAAlloc::~VMAAlloc()
 
 inline std::pair<vk::Buffer, VmaAllocation> VMAAlloc::createBuffer(
     const vk::BufferCreateInfo    &bufferCreateInfo,
-    const VmaAllocationCreateInfo &allocCreateInfo)
+    const VmaAllocationCreateInfo &allocCreateInfo,
+    const char                    *name)
 {
     const VkBufferCreateInfo &vkInfo = bufferCreateInfo;
     VkBuffer buffer; VmaAllocation alloc;
@@ -284,12 +309,22 @@ inline std::pair<vk::Buffer, VmaAllocation> VMAAlloc::createBuffer(
             "failed to create vma buffer. err code = " +
             std::to_string(rt));
     }
+    const uint32_t index = bufferCount_++;
+    if(name)
+        setDebugName(device_, vk::Buffer(buffer), name, *dispatch_);
+    else if(dispatch_->vkSetDebugUtilsObjectNameEXT)
+    {
+        setDebugName(
+            device_, vk::Buffer(buffer),
+            "vma buffer " + std::to_string(index), *dispatch_);
+    }
     return { buffer, alloc };
 }
 
 inline std::pair<vk::Image, VmaAllocation> VMAAlloc::createImage(
     const vk::ImageCreateInfo     &imageCreateInfo,
-    const VmaAllocationCreateInfo &allocCreateInfo)
+    const VmaAllocationCreateInfo &allocCreateInfo,
+    const char                    *name)
 {
     const VkImageCreateInfo vkInfo = imageCreateInfo;
     VkImage image; VmaAllocation alloc;
@@ -301,22 +336,34 @@ inline std::pair<vk::Image, VmaAllocation> VMAAlloc::createImage(
             "failed to create vma image. err code = " +
             std::to_string(rt));
     }
+    const uint32_t index = imageCount_++;
+    if(name)
+        setDebugName(device_, vk::Image(image), name, *dispatch_);
+    else if(dispatch_->vkSetDebugUtilsObjectNameEXT)
+    {
+        setDebugName(
+            device_, vk::Image(image),
+            "vma image " + std::to_string(index), *dispatch_);
+    }
     return { image, alloc };
 }
 
 inline VMAUniqueBuffer VMAAlloc::createBufferUnique(
     const vk::BufferCreateInfo    &bufferCreateInfo,
-    const VmaAllocationCreateInfo &allocCreateInfo)
+    const VmaAllocationCreateInfo &allocCreateInfo,
+    const char                    *name)
 {
-    auto [buffer, alloc] = createBuffer(bufferCreateInfo, allocCreateInfo);
+    auto [buffer, alloc] = createBuffer(
+        bufferCreateInfo, allocCreateInfo, name);
     return VMAUniqueBuffer(buffer, alloc, alloc_);
 }
 
 inline VMAUniqueImage VMAAlloc::createImageUnique(
     const vk::ImageCreateInfo     &imageCreateInfo,
-    const VmaAllocationCreateInfo &allocCreateInfo)
+    const VmaAllocationCreateInfo &allocCreateInfo,
+    const char                    *name)
 {
-    auto [image, alloc] = createImage(imageCreateInfo, allocCreateInfo);
+    auto [image, alloc] = createImage(imageCreateInfo, allocCreateInfo, name);
     return VMAUniqueImage(image, alloc, alloc_);
 }
 
@@ -332,7 +379,7 @@ inline VMAUniqueBuffer VMAAlloc::createStagingBufferUnique(
     VmaAllocationCreateInfo allocInfo = {};
     allocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
 
-    auto ret = createBufferUnique(bufInfo, allocInfo);
+    auto ret = createBufferUnique(bufInfo, allocInfo, "staging buffer");
 
     if(initData)
     {
@@ -345,4 +392,9 @@ inline VMAUniqueBuffer VMAAlloc::createStagingBufferUnique(
     return ret;
 }
 
+inline VmaAllocator VMAAlloc::getAllocator() const noexcept
+{
+    return alloc_;
+}
+
 AGZ_VULKAN_LAB_END
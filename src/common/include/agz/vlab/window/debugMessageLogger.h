@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <agz/vlab/common.h>
+#include <agz/vlab/thread/mpscQueue.h>
+
+AGZ_VULKAN_LAB_BEGIN
+
+struct DebugMessageLoggerDesc
+{
+    // messages logged while the queue is full are dropped and counted
+    size_t queueCapacity = 1024;
+
+    // messages of the same messageIdNumber printed in one second. further
+    // ones are counted and reported as a single line. 0 for no limit.
+    // messages with id 0 (e.g. from the loader) are never limited
+    uint32_t maxPerIDPerSecond = 5;
+
+    // messages with these ids are discarded
+    std::unordered_set<int32_t> mutedIDs;
+
+    // if not empty, only messages with these ids are kept
+    std::unordered_set<int32_t> onlyIDs;
+};
+
+/**
+ * @brief prints debug utils messages on a dedicated thread
+ *
+ * log is called from the messenger callback, which runs synchronously on
+ * the thread making the vulkan call. it checks the id filters with a hash
+ * lookup and copies the message into a lock-free queue; deduplication and
+ * formatting happen on the logger thread. filters are fixed at
+ * construction so that log never locks.
+ *
+ * the destructor prints all queued messages before returning.
+ */
+class DebugMessageLogger : public misc::uncopyable_t
+{
+public:
+
+    explicit DebugMessageLogger(
+        const DebugMessageLoggerDesc &desc = {},
+        std::ostream                 &out  = std::cerr);
+
+    ~DebugMessageLogger();
+
+    // thread-safe
+    void log(const VkDebugUtilsMessengerCallbackDataEXT *data);
+
+    bool isFiltered(int32_t messageID) const noexcept;
+
+    uint64_t getDroppedCount() const noexcept;
+
+private:
+
+    struct Message
+    {
+        int32_t     id     = 0;
+        uint64_t    second = 0;
+        std::string text;
+    };
+
+    struct IDState
+    {
+        uint64_t window     = 0;
+        uint32_t printed    = 0;
+        uint32_t suppressed = 0;
+    };
+
+    void loggerMain();
+
+    void print(const Message &msg);
+
+    void printSuppressed(int32_t id, IDState &state);
+
+    // these return true if anything is printed
+
+    bool printExpired(uint64_t second);
+
+    bool printDropped();
+
+    DebugMessageLoggerDesc desc_;
+
+    std::ostream &out_;
+
+    MPSCQueue<Message> queue_;
+
+    std::atomic<uint64_t> dropped_         = { 0 };
+    uint64_t              reportedDropped_ = 0;
+
+    // written by the logger thread only
+    std::unordered_map<int32_t, IDState> idStates_;
+    bool                                 hasSuppressed_ = false;
+
+    std::atomic<bool> exit_ = { false };
+    std::thread       thread_;
+};
+
+inline bool DebugMessageLogger::isFiltered(int32_t messageID) const noexcept
+{
+    if(!desc_.onlyIDs.empty() && !desc_.onlyIDs.count(messageID))
+        return true;
+    return desc_.mutedIDs.count(messageID) != 0;
+}
+
+inline uint64_t DebugMessageLogger::getDroppedCount() const noexcept
+{
+    return dropped_.load(std::memory_order_relaxed);
+}
+
+AGZ_VULKAN_LAB_END
@@ -1,8 +1,10 @@
 #pragma once
 
+#include <memory>
+
 #include <agz/utility/event.h>
 
-#include <agz/vlab/common.h>
+#include <agz/vlab/window/debugMessageLogger.h>
 
 AGZ_VULKAN_LAB_BEGIN
 
@@ -25,7 +27,11 @@ public:
         Error      = 3
     };
 
-    DebugMessageManager(vk::Instance instance, Level level);
+    // stderr output goes through logger. a default one is created if null
+    DebugMessageManager(
+        vk::Instance                        instance,
+        Level                               level,
+        std::shared_ptr<DebugMessageLogger> logger = nullptr);
 
     void enableStdErrOutput(Level level);
 
@@ -49,6 +55,9 @@ private:
 
     PrintToStdErr printToStdErr_;
 
+    // outlives the messenger
+    std::shared_ptr<DebugMessageLogger> logger_;
+
     vk::UniqueDebugUtilsMessengerEXT messenger_;
 
     vk::Instance instance_;
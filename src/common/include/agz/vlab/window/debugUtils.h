@@ -0,0 +1,168 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+#include <agz/vlab/common.h>
+
+AGZ_VULKAN_LAB_BEGIN
+
+/*
+ * object names and command labels of VK_EXT_debug_utils, shown in
+ * validation messages and frame captures.
+ *
+ * all functions are no-ops unless the extension is enabled on the instance
+ * the default dispatcher is initialized with (see enableDebugMessage of
+ * VulkanContextDesc), and compile to nothing with
+ * AGZ_VLAB_DISABLE_DEBUG_UTILS. functions taking a dispatcher use it instead
+ * of the default one (see VulkanContext::getDispatch).
+ */
+
+using DebugLabelColor = std::array<float, 4>;
+
+#ifndef AGZ_VLAB_DISABLE_DEBUG_UTILS
+
+bool isDebugUtilsEnabled() noexcept;
+
+void setDebugObjectName(
+    vk::Device device, vk::ObjectType type, uint64_t handle, const char *name,
+    const vk::DispatchLoaderDynamic &dispatch = VULKAN_HPP_DEFAULT_DISPATCHER);
+
+void beginDebugLabel(
+    vk::CommandBuffer cmd, const char *name, const DebugLabelColor &color = {},
+    const vk::DispatchLoaderDynamic &dispatch = VULKAN_HPP_DEFAULT_DISPATCHER);
+
+void endDebugLabel(
+    vk::CommandBuffer cmd,
+    const vk::DispatchLoaderDynamic &dispatch = VULKAN_HPP_DEFAULT_DISPATCHER);
+
+void insertDebugLabel(
+    vk::CommandBuffer cmd, const char *name, const DebugLabelColor &color = {},
+    const vk::DispatchLoaderDynamic &dispatch = VULKAN_HPP_DEFAULT_DISPATCHER);
+
+void beginDebugLabel(
+    vk::Queue queue, const char *name, const DebugLabelColor &color = {});
+
+void endDebugLabel(vk::Queue queue);
+
+#else
+
+inline bool isDebugUtilsEnabled() noexcept { return false; }
+
+inline void setDebugObjectName(
+    vk::Device, vk::ObjectType, uint64_t, const char *,
+    const vk::DispatchLoaderDynamic & = VULKAN_HPP_DEFAULT_DISPATCHER) { }
+
+inline void beginDebugLabel(
+    vk::CommandBuffer, const char *, const DebugLabelColor & = {},
+    const vk::DispatchLoaderDynamic & = VULKAN_HPP_DEFAULT_DISPATCHER) { }
+
+inline void endDebugLabel(
+    vk::CommandBuffer,
+    const vk::DispatchLoaderDynamic & = VULKAN_HPP_DEFAULT_DISPATCHER) { }
+
+inline void insertDebugLabel(
+    vk::CommandBuffer, const char *, const DebugLabelColor & = {},
+    const vk::DispatchLoaderDynamic & = VULKAN_HPP_DEFAULT_DISPATCHER) { }
+
+inline void beginDebugLabel(
+    vk::Queue, const char *, const DebugLabelColor & = {}) { }
+
+inline void endDebugLabel(vk::Queue) { }
+
+#endif
+
+// works with any vulkan.hpp handle type, e.g. vk::Buffer
+template<typename Handle>
+void setDebugName(
+    vk::Device device, Handle object, const char *name,
+    const vk::DispatchLoaderDynamic &dispatch = VULKAN_HPP_DEFAULT_DISPATCHER);
+
+template<typename Handle>
+void setDebugName(
+    vk::Device device, Handle object, const std::string &name,
+    const vk::DispatchLoaderDynamic &dispatch = VULKAN_HPP_DEFAULT_DISPATCHER);
+
+/**
+ * @brief RAII wrapper of beginDebugLabel/endDebugLabel on a command buffer
+ */
+class DebugLabelScope : public misc::uncopyable_t
+{
+public:
+
+    DebugLabelScope(
+        vk::CommandBuffer cmd, const char *name,
+        const DebugLabelColor &color = {},
+        const vk::DispatchLoaderDynamic &dispatch =
+            VULKAN_HPP_DEFAULT_DISPATCHER);
+
+    ~DebugLabelScope();
+
+private:
+
+    vk::CommandBuffer                cmd_;
+    const vk::DispatchLoaderDynamic *dispatch_;
+};
+
+template<typename Handle>
+void setDebugName(
+    vk::Device device, Handle object, const char *name,
+    const vk::DispatchLoaderDynamic &dispatch)
+{
+#ifndef AGZ_VLAB_DISABLE_DEBUG_UTILS
+    if(!dispatch.vkSetDebugUtilsObjectNameEXT || !object)
+        return;
+
+    using CType = typename Handle::CType;
+    const CType raw = static_cast<CType>(object);
+
+    // dispatchable handles (and all handles on 64-bit) are pointers
+    uint64_t value;
+    if constexpr(std::is_pointer_v<CType>)
+        value = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(raw));
+    else
+        value = static_cast<uint64_t>(raw);
+
+    setDebugObjectName(device, Handle::objectType, value, name, dispatch);
+#endif
+}
+
+template<typename Handle>
+void setDebugName(
+    vk::Device device, Handle object, const std::string &name,
+    const vk::DispatchLoaderDynamic &dispatch)
+{
+    setDebugName(device, object, name.c_str(), dispatch);
+}
+
+inline DebugLabelScope::DebugLabelScope(
+    vk::CommandBuffer cmd, const char *name, const DebugLabelColor &color,
+    const vk::DispatchLoaderDynamic &dispatch)
+    : cmd_(cmd), dispatch_(&dispatch)
+{
+    beginDebugLabel(cmd_, name, color, *dispatch_);
+}
+
+inline DebugLabelScope::~DebugLabelScope()
+{
+    endDebugLabel(cmd_, *dispatch_);
+}
+
+AGZ_VULKAN_LAB_END
+
+#define AGZ_VLAB_DEBUG_CAT_IMPL(A, B) A##B
+#define AGZ_VLAB_DEBUG_CAT(A, B) AGZ_VLAB_DEBUG_CAT_IMPL(A, B)
+
+#ifdef AGZ_VLAB_DISABLE_DEBUG_UTILS
+
+#define AGZ_VLAB_DEBUG_LABEL(CMD, ...) ((void)0)
+
+#else
+
+// AGZ_VLAB_DEBUG_LABEL(cmd, name [, color])
+#define AGZ_VLAB_DEBUG_LABEL(CMD, ...) \
+    ::agz::vlab::DebugLabelScope AGZ_VLAB_DEBUG_CAT(agzVLabDebugLabel, __LINE__)(CMD, __VA_ARGS__)
+
+#endif
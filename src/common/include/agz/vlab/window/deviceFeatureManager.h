@@ -0,0 +1,193 @@
+#pragma once
+
+#include <set>
+#include <vector>
+
+#include <agz/vlab/common.h>
+
+AGZ_VULKAN_LAB_BEGIN
+
+// api version the instance is created with
+constexpr uint32_t INSTANCE_API_VERSION = VK_API_VERSION_1_2;
+
+// device functionality usable through the instance: the lower of
+// INSTANCE_API_VERSION and the device api version
+uint32_t getEffectiveApiVersion(vk::PhysicalDevice physicalDevice);
+
+/**
+ * @brief device features that can be requested
+ *
+ * each one maps to a member of a vulkan feature struct. features promoted
+ * to core are also available through their extension on older devices.
+ */
+enum class DeviceFeature
+{
+    // vulkan 1.0
+    SamplerAnisotropy,
+    FillModeNonSolid,
+    WideLines,
+    MultiDrawIndirect,
+    DrawIndirectFirstInstance,
+    PipelineStatisticsQuery,
+    OcclusionQueryPrecise,
+    ShaderInt64,
+
+    // vulkan 1.1
+    ShaderDrawParameters,
+
+    // vulkan 1.2 or VK_KHR_timeline_semaphore
+    TimelineSemaphore,
+
+    // vulkan 1.2 or VK_EXT_descriptor_indexing
+    RuntimeDescriptorArray,
+    ShaderSampledImageArrayNonUniformIndexing,
+    DescriptorBindingPartiallyBound,
+    DescriptorBindingVariableDescriptorCount,
+    DescriptorBindingSampledImageUpdateAfterBind,
+
+    // vulkan 1.2 or VK_KHR_buffer_device_address
+    BufferDeviceAddress,
+
+    // vulkan 1.2 or VK_EXT_host_query_reset
+    HostQueryReset,
+
+    // vulkan 1.3 or VK_KHR_synchronization2
+    Synchronization2,
+
+    // vulkan 1.3 or VK_KHR_dynamic_rendering
+    DynamicRendering,
+
+    Count
+};
+
+const char *getDeviceFeatureName(DeviceFeature feature) noexcept;
+
+/**
+ * @brief required and optional device features
+ *
+ * a physical device missing any required feature is rejected. optional
+ * features are enabled only when supported; query the result with
+ * GraphicsDevice::isFeatureEnabled.
+ *
+ * features unavailable in the vulkan headers being used are never
+ * supported.
+ */
+class DeviceFeatureManager
+{
+public:
+
+    void require(DeviceFeature feature);
+
+    void request(DeviceFeature feature);
+
+    const std::set<DeviceFeature> &getRequiredFeatures() const noexcept;
+
+    const std::set<DeviceFeature> &getOptionalFeatures() const noexcept;
+
+    // all supported features among the required and optional ones
+    std::set<DeviceFeature> querySupported(
+        vk::PhysicalDevice physicalDevice) const;
+
+    bool isAllSupported(vk::PhysicalDevice physicalDevice) const;
+
+private:
+
+    std::set<DeviceFeature> required_;
+    std::set<DeviceFeature> optional_;
+};
+
+/**
+ * @brief pNext chain of feature structs rooted at vk::PhysicalDeviceFeatures2
+ *
+ * only structs known to the device (by api version or extension) are
+ * linked. the chain points into itself and thus cannot be copied.
+ */
+class DeviceFeatureChain : public misc::uncopyable_t
+{
+public:
+
+    // empty chain. features are linked by enable()
+    DeviceFeatureChain();
+
+    // supported features of physicalDevice. structs promoted after
+    // getEffectiveApiVersion are linked only through their extensions
+    explicit DeviceFeatureChain(vk::PhysicalDevice physicalDevice);
+
+    // nullptr if the struct containing given feature is not linked
+    const vk::Bool32 *get(DeviceFeature feature) const noexcept;
+
+    bool isSupported(DeviceFeature feature) const noexcept;
+
+    // link the containing struct and set the feature to VK_TRUE
+    void enable(DeviceFeature feature);
+
+    // extensions needed by linked structs on a device of given api version
+    std::vector<const char *> getRequiredExtensions(
+        uint32_t apiVersion) const;
+
+    // set as vk::DeviceCreateInfo::pNext, with pEnabledFeatures = nullptr
+    const vk::PhysicalDeviceFeatures2 &getHead() const noexcept;
+
+private:
+
+    enum Struct
+    {
+        Core10,
+        ShaderDrawParameters,
+        TimelineSemaphore,
+        DescriptorIndexing,
+        BufferDeviceAddress,
+        HostQueryReset,
+        Synchronization2,
+        DynamicRendering,
+        StructCount
+    };
+
+    static Struct getStruct(DeviceFeature feature) noexcept;
+
+    vk::Bool32 *getMutable(DeviceFeature feature) noexcept;
+
+    void link() noexcept;
+
+    bool linked_[StructCount] = {};
+
+    vk::PhysicalDeviceFeatures2                     features2_;
+    vk::PhysicalDeviceShaderDrawParametersFeatures  shaderDrawParameters_;
+    vk::PhysicalDeviceTimelineSemaphoreFeatures     timelineSemaphore_;
+    vk::PhysicalDeviceDescriptorIndexingFeatures    descriptorIndexing_;
+    vk::PhysicalDeviceBufferDeviceAddressFeatures   bufferDeviceAddress_;
+    vk::PhysicalDeviceHostQueryResetFeatures        hostQueryReset_;
+#ifdef VK_KHR_synchronization2
+    vk::PhysicalDeviceSynchronization2FeaturesKHR   synchronization2_;
+#endif
+#ifdef VK_KHR_dynamic_rendering
+    vk::PhysicalDeviceDynamicRenderingFeaturesKHR   dynamicRendering_;
+#endif
+};
+
+inline const std::set<DeviceFeature> &
+    DeviceFeatureManager::getRequiredFeatures() const noexcept
+{
+    return required_;
+}
+
+inline const std::set<DeviceFeature> &
+    DeviceFeatureManager::getOptionalFeatures() const noexcept
+{
+    return optional_;
+}
+
+inline bool DeviceFeatureChain::isSupported(
+    DeviceFeature feature) const noexcept
+{
+    const vk::Bool32 *value = get(feature);
+    return value && *value == VK_TRUE;
+}
+
+inline const vk::PhysicalDeviceFeatures2 &
+    DeviceFeatureChain::getHead() const noexcept
+{
+    return features2_;
+}
+
+AGZ_VULKAN_LAB_END
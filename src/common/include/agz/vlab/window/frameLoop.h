@@ -0,0 +1,173 @@
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <functional>
+
+#include <agz/vlab/common.h>
+
+AGZ_VULKAN_LAB_BEGIN
+
+class Window;
+
+/**
+ * @brief limits the frame rate with a hybrid sleep/spin wait
+ *
+ * sleeps until spinThreshold before the deadline, then spins (yielding) to
+ * compensate for the coarse granularity of os sleeping. deadlines advance
+ * by the frame period instead of being measured from 'now', so the average
+ * rate does not drift; if a frame falls behind by more than one period the
+ * schedule is reset.
+ */
+class FrameLimiter
+{
+public:
+
+    using Clock = std::chrono::steady_clock;
+
+    // targetFrameRate <= 0 means unlimited
+    explicit FrameLimiter(double targetFrameRate = 0);
+
+    void setTargetFrameRate(double targetFrameRate);
+
+    double getTargetFrameRate() const noexcept;
+
+    void setSpinThreshold(Clock::duration threshold) noexcept;
+
+    // wait until next frame should start
+    void wait();
+
+    // forget the schedule, e.g. after a pause
+    void reset() noexcept;
+
+private:
+
+    double          targetFrameRate_ = 0;
+    Clock::duration period_          = {};
+    Clock::duration spinThreshold_   = std::chrono::microseconds(1500);
+
+    bool              hasDeadline_ = false;
+    Clock::time_point deadline_;
+};
+
+// frame times in milliseconds
+struct FrameTimeStatistics
+{
+    uint32_t sampleCount = 0;
+
+    float avgFrameTime = 0;
+    float minFrameTime = 0;
+    float maxFrameTime = 0;
+    float p99FrameTime = 0;
+
+    float fps = 0;
+};
+
+struct FrameLoopDesc
+{
+    // <= 0: unlimited
+    double targetFrameRate = 0;
+
+    // seconds per simulation step
+    double fixedTimestep = 1.0 / 60;
+
+    // upper bound of steps per frame. excess time is dropped to avoid the
+    // spiral of death when simulation is slower than real time
+    uint32_t maxStepsPerFrame = 8;
+
+    // number of frames used by getStatistics
+    uint32_t statisticsFrameCount = 120;
+};
+
+/**
+ * @brief fixed-timestep simulation with render interpolation
+ *
+ * each frame advances an accumulator by the elapsed real time, calls the
+ * update function with the fixed timestep as many times as fit, then calls
+ * the render function with the interpolation factor in [0, 1) between the
+ * previous and the current simulation states, and finally waits for the
+ * frame limiter.
+ */
+class FrameLoop
+{
+public:
+
+    using UpdateFunc = std::function<void(double dt)>;
+    using RenderFunc = std::function<void(float interpolation)>;
+
+    explicit FrameLoop(const FrameLoopDesc &desc = {});
+
+    // run one frame
+    void frame(const UpdateFunc &update, const RenderFunc &render);
+
+    // call window.doEvents() and frame() until the window is closed.
+    // frames are skipped when the window has no redraw request
+    void run(Window &window, const UpdateFunc &update, const RenderFunc &render);
+
+    FrameLimiter &getLimiter() noexcept;
+
+    double getSimulationTime() const noexcept;
+
+    uint64_t getStepCount() const noexcept;
+
+    uint64_t getFrameCount() const noexcept;
+
+    FrameTimeStatistics getStatistics() const;
+
+    // restart timing without a catch-up burst of updates
+    void resetTiming() noexcept;
+
+private:
+
+    using Clock = FrameLimiter::Clock;
+
+    FrameLoopDesc desc_;
+    FrameLimiter  limiter_;
+
+    bool              hasLastTime_ = false;
+    Clock::time_point lastTime_;
+
+    double   accumulator_    = 0;
+    double   simulationTime_ = 0;
+    uint64_t stepCount_      = 0;
+    uint64_t frameCount_     = 0;
+
+    std::deque<float> frameTimes_;
+};
+
+inline double FrameLimiter::getTargetFrameRate() const noexcept
+{
+    return targetFrameRate_;
+}
+
+inline void FrameLimiter::setSpinThreshold(Clock::duration threshold) noexcept
+{
+    spinThreshold_ = threshold;
+}
+
+inline void FrameLimiter::reset() noexcept
+{
+    hasDeadline_ = false;
+}
+
+inline FrameLimiter &FrameLoop::getLimiter() noexcept
+{
+    return limiter_;
+}
+
+inline double FrameLoop::getSimulationTime() const noexcept
+{
+    return simulationTime_;
+}
+
+inline uint64_t FrameLoop::getStepCount() const noexcept
+{
+    return stepCount_;
+}
+
+inline uint64_t FrameLoop::getFrameCount() const noexcept
+{
+    return frameCount_;
+}
+
+AGZ_VULKAN_LAB_END
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <agz/vlab/common.h>
+
+AGZ_VULKAN_LAB_BEGIN
+
+struct FramePacingDesc
+{
+    uint32_t minFramesInFlight = 1;
+    uint32_t maxFramesInFlight = 3;
+
+    // upper bound (ms) of the estimated time from the start of recording
+    // a frame to the end of its gpu work
+    float latencyBudget = 50;
+
+    // number of samples averaged for each decision
+    uint32_t sampleCount = 60;
+
+    // fewer frames in flight are preferred if they cost at most this
+    // fraction of the best achievable throughput
+    float throughputTolerance = 0.05f;
+};
+
+/**
+ * @brief chooses frames in flight and swapchain image count from measured
+ *        cpu/gpu frame times
+ *
+ * with n frames in flight and per-frame cpu/gpu times c/g, the frame period
+ * is estimated as max(c, g, (c + g) / n) and the latency as
+ * max(c + g, n * period). the smallest n whose throughput is within the
+ * tolerance of the best one and whose latency fits the budget is selected.
+ * if no n meets both, the one with the highest throughput among those
+ * fitting the latency budget is used, or the minimum if none fits it.
+ */
+class FramePacingTuner
+{
+public:
+
+    explicit FramePacingTuner(const FramePacingDesc &desc = {});
+
+    // gpuTime: gpu time per frame, or the measured frame period if gpu
+    // timing is unavailable
+    void addSample(float cpuTime, float gpuTime);
+
+    // make a decision once enough samples are collected.
+    // returns true if the recommendation changes
+    bool update();
+
+    uint32_t getFramesInFlight() const noexcept;
+
+    // one more image than frames in flight so that acquiring never waits
+    // for the presentation engine to release the image being displayed
+    uint32_t getImageCount() const noexcept;
+
+    float getAvgCpuTime() const noexcept;
+
+    float getAvgGpuTime() const noexcept;
+
+    float getEstimatedFramePeriod() const noexcept;
+
+    float getEstimatedLatency() const noexcept;
+
+private:
+
+    float estimatePeriod(uint32_t framesInFlight) const noexcept;
+
+    float estimateLatency(uint32_t framesInFlight) const noexcept;
+
+    FramePacingDesc desc_;
+
+    float    cpuSum_ = 0;
+    float    gpuSum_ = 0;
+    uint32_t sampleCount_ = 0;
+
+    float avgCpuTime_ = 0;
+    float avgGpuTime_ = 0;
+
+    uint32_t framesInFlight_;
+};
+
+inline uint32_t FramePacingTuner::getFramesInFlight() const noexcept
+{
+    return framesInFlight_;
+}
+
+inline uint32_t FramePacingTuner::getImageCount() const noexcept
+{
+    return framesInFlight_ + 1;
+}
+
+inline float FramePacingTuner::getAvgCpuTime() const noexcept
+{
+    return avgCpuTime_;
+}
+
+inline float FramePacingTuner::getAvgGpuTime() const noexcept
+{
+    return avgGpuTime_;
+}
+
+inline float FramePacingTuner::getEstimatedFramePeriod() const noexcept
+{
+    return estimatePeriod(framesInFlight_);
+}
+
+inline float FramePacingTuner::getEstimatedLatency() const noexcept
+{
+    return estimateLatency(framesInFlight_);
+}
+
+AGZ_VULKAN_LAB_END
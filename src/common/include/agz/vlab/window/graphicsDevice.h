@@ -1,26 +1,51 @@
 #pragma once
 
+#include <map>
+#include <set>
+
+#include <agz/vlab/window/deviceFeatureManager.h>
 #include <agz/vlab/window/extensionManager.h>
 
 AGZ_VULKAN_LAB_BEGIN
 
+// any device type is accepted. see rankPhysicalDevices for selection.
+// surface can be null, in which case presentation is not checked
 bool IsGraphicsPhysicalDevice(
     vk::PhysicalDevice physicalDevice, vk::SurfaceKHR surface,
-    const DeviceExtensionManager *extensions);
+    const DeviceExtensionManager *extensions,
+    const DeviceFeatureManager   *features = nullptr);
 
 std::vector<vk::PhysicalDevice> getAllPhysicalDevices(
     vk::Instance instance,
     const std::function<bool(vk::PhysicalDevice)> &filter = {});
 
+/**
+ * @brief logical device and its queues
+ *
+ * compute and transfer prefer dedicated families (async compute, dma)
+ * so that they can overlap with graphics work. each used family gets
+ * several queues when available; roles sharing a family are given
+ * different queues while there are enough of them.
+ *
+ * timeline semaphores are always requested as an optional feature, and
+ * VK_EXT_calibrated_timestamps as an optional extension. extensions needed
+ * by enabled features are added automatically on devices predating their
+ * promotion to core.
+ */
 class GraphicsDevice : public misc::uncopyable_t
 {
 public:
 
     ~GraphicsDevice();
 
+    // throws if a required feature is unsupported. dispatch must hold the
+    // instance functions and outlive the device; device functions are
+    // loaded into it, and the device is created and destroyed through it
     void Initialize(
         vk::PhysicalDevice physicalDevice, vk::SurfaceKHR surface,
-        const DeviceExtensionManager *extensions);
+        vk::DispatchLoaderDynamic    &dispatch,
+        const DeviceExtensionManager *extensions,
+        const DeviceFeatureManager   *features = nullptr);
 
     void Destroy();
 
@@ -28,27 +53,58 @@ public:
 
     uint32_t graphicsQueueFamilyIndex() const noexcept;
 
+    uint32_t computeQueueFamilyIndex() const noexcept;
+
     uint32_t transferQueueFamilyIndex() const noexcept;
 
     uint32_t presentQueueFamilyIndex() const noexcept;
 
     vk::Queue graphicsQueue() const noexcept;
 
+    vk::Queue computeQueue() const noexcept;
+
     vk::Queue transferQueue() const noexcept;
 
     vk::Queue presentQueue() const noexcept;
 
+    // all created queues of given family
+    const std::vector<vk::Queue> &queues(uint32_t familyIndex) const;
+
+    // compute queue belongs to a family without graphics
+    bool hasAsyncCompute() const noexcept;
+
+    // transfer queue belongs to a family without graphics
+    bool hasDedicatedTransfer() const noexcept;
+
+    bool isTimelineSemaphoreEnabled() const noexcept;
+
+    bool isFeatureEnabled(DeviceFeature feature) const noexcept;
+
+    // required features and supported optional ones
+    const std::set<DeviceFeature> &getEnabledFeatures() const noexcept;
+
+    // VK_EXT_calibrated_timestamps is enabled
+    bool isCalibratedTimestampsEnabled() const noexcept;
+
 private:
 
     vk::UniqueDevice device_;
 
     uint32_t graphicsIndex_ = 0;
+    uint32_t computeIndex_  = 0;
     uint32_t transferIndex_ = 0;
     uint32_t presentIndex_  = 0;
 
+    std::set<DeviceFeature> enabledFeatures_;
+
+    bool calibratedTimestamps_ = false;
+
     vk::Queue graphicsQueue_;
+    vk::Queue computeQueue_;
     vk::Queue transferQueue_;
     vk::Queue presentationQueue_;
+
+    std::map<uint32_t, std::vector<vk::Queue>> queues_;
 };
 
 inline vk::Device GraphicsDevice::device() const noexcept
@@ -61,6 +117,11 @@ inline uint32_t GraphicsDevice::graphicsQueueFamilyIndex() const noexcept
     return graphicsIndex_;
 }
 
+inline uint32_t GraphicsDevice::computeQueueFamilyIndex() const noexcept
+{
+    return computeIndex_;
+}
+
 inline ::uint32_t GraphicsDevice::transferQueueFamilyIndex() const noexcept
 {
     return transferIndex_;
@@ -76,6 +137,11 @@ inline vk::Queue GraphicsDevice::graphicsQueue() const noexcept
     return graphicsQueue_;
 }
 
+inline vk::Queue GraphicsDevice::computeQueue() const noexcept
+{
+    return computeQueue_;
+}
+
 inline vk::Queue GraphicsDevice::transferQueue() const noexcept
 {
     return transferQueue_;
@@ -86,4 +152,36 @@ inline vk::Queue GraphicsDevice::presentQueue() const noexcept
     return presentationQueue_;
 }
 
+inline bool GraphicsDevice::hasAsyncCompute() const noexcept
+{
+    return computeIndex_ != graphicsIndex_;
+}
+
+inline bool GraphicsDevice::hasDedicatedTransfer() const noexcept
+{
+    return transferIndex_ != graphicsIndex_;
+}
+
+inline bool GraphicsDevice::isTimelineSemaphoreEnabled() const noexcept
+{
+    return isFeatureEnabled(DeviceFeature::TimelineSemaphore);
+}
+
+inline bool GraphicsDevice::isFeatureEnabled(
+    DeviceFeature feature) const noexcept
+{
+    return enabledFeatures_.count(feature) != 0;
+}
+
+inline const std::set<DeviceFeature> &
+    GraphicsDevice::getEnabledFeatures() const noexcept
+{
+    return enabledFeatures_;
+}
+
+inline bool GraphicsDevice::isCalibratedTimestampsEnabled() const noexcept
+{
+    return calibratedTimestamps_;
+}
+
 AGZ_VULKAN_LAB_END
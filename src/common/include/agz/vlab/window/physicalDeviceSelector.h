@@ -0,0 +1,54 @@
+#pragma once
+
+#include <functional>
+#include <ostream>
+
+#include <agz/vlab/window/extensionManager.h>
+
+AGZ_VULKAN_LAB_BEGIN
+
+struct PhysicalDeviceSelectionDesc
+{
+    // name substring (case insensitive) or index in enumeration order.
+    // empty: read preferenceEnvVar instead
+    std::string preferred;
+
+    const char *preferenceEnvVar = "VLAB_PHYSICAL_DEVICE";
+
+    // software implementations such as lavapipe/swiftshader
+    bool allowCpu = true;
+
+    // each supported one adds to the score
+    std::vector<const char *> optionalExtensions;
+};
+
+struct PhysicalDeviceRank
+{
+    vk::PhysicalDevice     device;
+    uint32_t               index = 0;
+    std::string            name;
+    vk::PhysicalDeviceType type = vk::PhysicalDeviceType::eOther;
+    vk::DeviceSize         deviceLocalMemory = 0;
+    int64_t                score = 0;
+    bool                   preferred = false;
+};
+
+/**
+ * @brief score devices passing 'filter'
+ *
+ * score: preference >> device type (discrete > integrated > virtual > cpu)
+ *        > device local memory > api version/features/optional extensions.
+ * returned devices are sorted by score, ties by enumeration order.
+ */
+std::vector<PhysicalDeviceRank> rankPhysicalDevices(
+    vk::Instance                                   instance,
+    const PhysicalDeviceSelectionDesc             &desc,
+    const std::function<bool(vk::PhysicalDevice)> &filter = {});
+
+const char *getPhysicalDeviceTypeName(vk::PhysicalDeviceType type) noexcept;
+
+// one line per device. the first one is marked as selected
+void printPhysicalDeviceRanking(
+    std::ostream &out, const std::vector<PhysicalDeviceRank> &ranking);
+
+AGZ_VULKAN_LAB_END
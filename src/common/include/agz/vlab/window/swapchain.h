@@ -4,6 +4,28 @@
 
 AGZ_VULKAN_LAB_BEGIN
 
+enum class PresentPolicy
+{
+    // VSync if WindowDesc::vsync is set, otherwise NoVSync
+    Default,
+    // fifo. never tears, lowest power
+    VSync,
+    // fifo relaxed, then fifo. tears only when a frame misses the vblank
+    AdaptiveVSync,
+    // mailbox, then immediate, then fifo. acquire never waits for vblank
+    NoVSync,
+    // mailbox, then fifo. no tearing, latest image is displayed
+    Mailbox,
+    // immediate, then fifo. lowest latency, may tear
+    Immediate
+};
+
+// present modes in order of preference. fifo is always the last fallback
+std::vector<vk::PresentModeKHR> getPreferredPresentModes(
+    PresentPolicy policy);
+
+const char *getPresentModeName(vk::PresentModeKHR mode) noexcept;
+
 struct SwapchainProperty
 {
     vk::SurfaceCapabilitiesKHR capabilities = {};
@@ -19,6 +41,9 @@ struct SwapchainProperty
         const std::vector<vk::PresentModeKHR> &preferred) const noexcept;
 
     vk::Extent2D chooseExtent(const vk::Extent2D &preferred) const noexcept;
+
+    // clamp to [minImageCount, maxImageCount]
+    uint32_t chooseImageCount(uint32_t preferred) const noexcept;
 };
 
 SwapchainProperty querySwapchainProperty(
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <memory>
+
+#include <agz/vlab/vma/vmaAlloc.h>
+#include <agz/vlab/window/debugMessageManager.h>
+#include <agz/vlab/window/deviceFeatureManager.h>
+#include <agz/vlab/window/extensionManager.h>
+#include <agz/vlab/window/graphicsDevice.h>
+#include <agz/vlab/window/layerManager.h>
+
+AGZ_VULKAN_LAB_BEGIN
+
+// reference counted glfwInit/glfwTerminate shared by contexts and windows
+void acquireGlfw();
+
+void releaseGlfw();
+
+struct VulkanContextDesc
+{
+    std::string appName;
+
+    bool enableDebugMessage = true;
+    DebugMessageManager::Level debugMsgLevel = DebugMessageManager::Level::Warning;
+
+    // id filters and rate limit of printed messages. defaults if null
+    const DebugMessageLoggerDesc *debugMsgLogger = nullptr;
+
+    const ValidationLayerManager *layers = nullptr;
+
+    const InstanceExtensionManager *instanceExtensions = nullptr;
+    const DeviceExtensionManager   *deviceExtensions   = nullptr;
+    const DeviceFeatureManager     *deviceFeatures     = nullptr;
+
+    // enable surface extensions required by glfw windows
+    bool windowSurfaces = true;
+
+    // enable VK_EXT_headless_surface
+    bool headlessSurfaces = false;
+
+    // see WindowDesc::preferredPhysicalDevice
+    std::string preferredPhysicalDevice;
+
+    bool logPhysicalDevices = true;
+};
+
+/**
+ * @brief instance, device and device-wide objects shared by windows
+ *
+ * initialized in two steps: the instance first, so that a surface can be
+ * created to select a physical device able to present to it. windows
+ * sharing a context only own their surface and swapchain; their surfaces
+ * must be supported by the present queue family (see canPresent).
+ *
+ * the vma allocator and pipeline cache are created with the device.
+ *
+ * device functions are loaded with vkGetDeviceProcAddr into a dispatch
+ * table owned by the context, bypassing the loader trampolines; the device
+ * itself is created and destroyed through it.
+ *
+ * the process-wide default dispatcher can serve only one device. it is
+ * bound to the first context initialized while no other context is bound
+ * to it, and is never rebound while that context is alive. other contexts
+ * may be created; calls for their devices must pass getDispatch(). the
+ * recording functions of the library (ResourceStateTracker::flush,
+ * RenderGraph::execute, the profilers and debug labels) and VMAAlloc take
+ * it for this purpose, while windows and other library objects use the
+ * default dispatcher and thus require the bound context.
+ */
+class VulkanContext : public misc::uncopyable_t
+{
+public:
+
+    ~VulkanContext();
+
+    void InitializeInstance(const VulkanContextDesc &desc);
+
+    // surface may be null, in which case the graphics family presents
+    void InitializeDevice(vk::SurfaceKHR surface);
+
+    // both instance and device are created
+    bool IsAvailable() const noexcept;
+
+    void Destroy();
+
+    bool canPresent(vk::SurfaceKHR surface) const;
+
+    bool isWindowSurfaceEnabled() const noexcept;
+
+    bool isHeadlessSurfaceEnabled() const noexcept;
+
+    vk::Instance getInstance() const noexcept;
+
+    DebugMessageManager *getDebugMsgMgr() const noexcept;
+
+    vk::PhysicalDevice getPhysicalDevice() const noexcept;
+
+    GraphicsDevice &getGraphicsDevice() noexcept;
+
+    const GraphicsDevice &getGraphicsDevice() const noexcept;
+
+    vk::Device getDevice() const noexcept;
+
+    VMAAlloc &getAllocator() const noexcept;
+
+    vk::PipelineCache getPipelineCache() const noexcept;
+
+    // device-level functions of this device
+    const vk::DispatchLoaderDynamic &getDispatch() const noexcept;
+
+    // VULKAN_HPP_DEFAULT_DISPATCHER serves this context
+    bool isDefaultDispatcherBound() const noexcept;
+
+private:
+
+    VulkanContextDesc desc_;
+
+    bool glfwAcquired_ = false;
+
+    // prints messages of instance creation/destruction and of debugMsgMgr_
+    std::shared_ptr<DebugMessageLogger> debugMsgLogger_;
+
+    vk::UniqueInstance instance_;
+
+    std::unique_ptr<DebugMessageManager> debugMsgMgr_;
+
+    vk::PhysicalDevice physicalDevice_;
+
+    GraphicsDevice graphicsDevice_;
+
+    vk::DispatchLoaderDynamic deviceDispatch_;
+
+    std::unique_ptr<VMAAlloc> allocator_;
+
+    vk::UniquePipelineCache pipelineCache_;
+};
+
+inline bool VulkanContext::IsAvailable() const noexcept
+{
+    return instance_ && graphicsDevice_.device();
+}
+
+inline bool VulkanContext::isWindowSurfaceEnabled() const noexcept
+{
+    return desc_.windowSurfaces;
+}
+
+inline bool VulkanContext::isHeadlessSurfaceEnabled() const noexcept
+{
+    return desc_.headlessSurfaces;
+}
+
+inline vk::Instance VulkanContext::getInstance() const noexcept
+{
+    return instance_.get();
+}
+
+inline DebugMessageManager *VulkanContext::getDebugMsgMgr() const noexcept
+{
+    return debugMsgMgr_.get();
+}
+
+inline vk::PhysicalDevice VulkanContext::getPhysicalDevice() const noexcept
+{
+    return physicalDevice_;
+}
+
+inline GraphicsDevice &VulkanContext::getGraphicsDevice() noexcept
+{
+    return graphicsDevice_;
+}
+
+inline const GraphicsDevice &VulkanContext::getGraphicsDevice() const noexcept
+{
+    return graphicsDevice_;
+}
+
+inline vk::Device VulkanContext::getDevice() const noexcept
+{
+    return graphicsDevice_.device();
+}
+
+inline VMAAlloc &VulkanContext::getAllocator() const noexcept
+{
+    return *allocator_;
+}
+
+inline vk::PipelineCache VulkanContext::getPipelineCache() const noexcept
+{
+    return pipelineCache_.get();
+}
+
+inline const vk::DispatchLoaderDynamic &
+    VulkanContext::getDispatch() const noexcept
+{
+    return deviceDispatch_;
+}
+
+AGZ_VULKAN_LAB_END
@@ -1,9 +1,16 @@
 #pragma once
 
+#include <functional>
+
 #include <agz/vlab/window/debugMessageManager.h>
 #include <agz/vlab/window/extensionManager.h>
+#include <agz/vlab/window/frameLoop.h>
+#include <agz/vlab/window/framePacing.h>
 #include <agz/vlab/window/graphicsDevice.h>
 #include <agz/vlab/window/layerManager.h>
+#include <agz/vlab/window/physicalDeviceSelector.h>
+#include <agz/vlab/window/swapchain.h>
+#include <agz/vlab/window/vulkanContext.h>
 #include <agz/vlab/window/windowEvent.h>
 
 AGZ_VULKAN_LAB_BEGIN
@@ -23,15 +30,48 @@ struct WindowDesc
     bool enableDebugMessage = true;
     DebugMessageManager::Level debugMsgLevel = DebugMessageManager::Level::Warning;
 
+    // see VulkanContextDesc::debugMsgLogger
+    const DebugMessageLoggerDesc *debugMsgLogger = nullptr;
+
     const ValidationLayerManager *layers = nullptr;
 
     const InstanceExtensionManager *instanceExtensions = nullptr;
     const DeviceExtensionManager   *deviceExtensions   = nullptr;
 
+    // physical devices missing required features are skipped
+    const DeviceFeatureManager *deviceFeatures = nullptr;
+
+    // clamped to surface capabilities
     uint32_t swapchainImageCount = 2;
 
+    // reported by getFramesInFlight. see setFramePacing
+    uint32_t framesInFlight = 2;
+
     bool clipObscuredPixels = true;
 
+    // overrides vsync when not Default
+    PresentPolicy presentPolicy = PresentPolicy::Default;
+
+    // see Window::setRenderOnDemand
+    bool renderOnDemand = false;
+
+    // name substring or index of the preferred physical device.
+    // if empty, the VLAB_PHYSICAL_DEVICE environment variable is used
+    std::string preferredPhysicalDevice;
+
+    // print physical device ranking to stderr
+    bool logPhysicalDevices = true;
+
+    // instance and device shared with other windows. if null, the window
+    // creates its own context from the instance/device settings above.
+    // it must be the context bound to the default dispatcher (see
+    // VulkanContext)
+    std::shared_ptr<VulkanContext> context;
+
+    // no os window. presents to a VK_EXT_headless_surface of size
+    // width x height, so that the same frame code runs on ci machines
+    bool headless = false;
+
     WindowDesc &setSize              (int width, int height)            noexcept;
     WindowDesc &setWidth             (int width)                        noexcept;
     WindowDesc &setHeight            (int height)                       noexcept;
@@ -42,11 +82,61 @@ struct WindowDesc
     WindowDesc &setMaximized         (bool maximized)                   noexcept;
     WindowDesc &setDebugMessage      (bool enabled)                     noexcept;
     WindowDesc &setDebugMessageLevel (DebugMessageManager::Level level) noexcept;
+    WindowDesc &setDebugMessageLogger(const DebugMessageLoggerDesc *desc) noexcept;
     WindowDesc &setLayers            (ValidationLayerManager *layers)   noexcept;
     WindowDesc &setInstanceExtensions(InstanceExtensionManager *exts)   noexcept;
     WindowDesc &setDeviceExtensions  (DeviceExtensionManager *exts)     noexcept;
+    WindowDesc &setDeviceFeatures    (DeviceFeatureManager *features)   noexcept;
     WindowDesc &setImageCount        (uint32_t swapchainImageCount)     noexcept;
+    WindowDesc &setFramesInFlight    (uint32_t framesInFlight)          noexcept;
     WindowDesc &setObscuredPixels    (bool enableClipping)              noexcept;
+    WindowDesc &setPresentPolicy     (PresentPolicy policy)             noexcept;
+    WindowDesc &setRenderOnDemand    (bool enabled)                     noexcept;
+    WindowDesc &setPhysicalDevice    (std::string preferred)            noexcept;
+    WindowDesc &setLogPhysicalDevices(bool log)                         noexcept;
+    WindowDesc &setHeadless          (bool headless)                    noexcept;
+    WindowDesc &setContext           (std::shared_ptr<VulkanContext> context) noexcept;
+};
+
+/**
+ * @brief presentation timing measured on the cpu
+ *
+ * all times are in milliseconds and computed over the last sampleCount
+ * frames presented via Window::present.
+ *
+ * presentLatency is the time from acquireNextImage returning an image to
+ * presenting it. time spent waiting for a free image is reported separately
+ * as acquireWait, which dominates with fifo when the gpu is ahead.
+ */
+struct PresentStatistics
+{
+    uint32_t sampleCount = 0;
+
+    float avgFrameTime = 0;
+    float minFrameTime = 0;
+    float maxFrameTime = 0;
+
+    float avgAcquireWait = 0;
+
+    float avgPresentLatency = 0;
+    float maxPresentLatency = 0;
+
+    float fps = 0;
+};
+
+/**
+ * @brief counters of swapchain recreation requests
+ *
+ * requests made while the swapchain is already marked dirty are coalesced
+ * into the pending recreation and counted as avoided.
+ */
+struct SwapchainStatistics
+{
+    uint64_t resizeEventCount   = 0;
+    uint64_t suboptimalCount    = 0;
+    uint64_t outOfDateCount     = 0;
+    uint64_t recreateCount      = 0;
+    uint64_t avoidedRecreations = 0;
 };
 
 struct WindowImplData;
@@ -55,6 +145,10 @@ class Window : public WindowEventManager
 {
 public:
 
+    // receives a function destroying resources that may still be used by
+    // submitted frames, and calls it once those frames have completed
+    using DeferredDestroyer = std::function<void(std::function<void()>)>;
+
     ~Window();
 
     void Initialize(const WindowDesc &desc);
@@ -63,10 +157,63 @@ public:
 
     void Destroy();
 
+    /**
+     * @brief whether the window is created with WindowDesc::headless
+     *
+     * a headless window has no glfw window and receives no input events.
+     * it is closed only by setCloseFlag. fullscreen is not supported.
+     */
+    bool isHeadless() const noexcept;
+
+    // poll events, then recreate the swapchain if it has been marked dirty
+    // (by resizing, suboptimal/out of date results, present policy changes).
+    // blocks while the window is iconified, and in render on demand mode
+    // until a redraw is requested
     void doEvents();
 
+    /**
+     * @brief only produce frames when something changes
+     *
+     * when enabled, doEvents (or the render thread) blocks until input,
+     * resizing, window refresh, a timer set by requestRedrawAfter or
+     * requestRedraw occurs. consumeRedrawRequest tells whether a frame
+     * should be rendered.
+     */
+    void setRenderOnDemand(bool enabled);
+
+    bool isRenderOnDemand() const noexcept;
+
+    // can be called from any thread
+    void requestRedraw();
+
+    // request a redraw after given seconds. the earliest deadline is kept
+    void requestRedrawAfter(double seconds);
+
+    // returns true and clears the request if a frame should be rendered.
+    // always true when render on demand is disabled
+    bool consumeRedrawRequest();
+
+    /**
+     * @brief call frameFunc repeatedly on a dedicated render thread
+     *
+     * the calling thread must be the main thread and keeps processing os
+     * events until the window is closed. resize and close are passed to the
+     * render thread through a lock-free queue; swapchain recreation and
+     * window events happen on the render thread. frameFunc must not call
+     * doEvents or setFullscreen. in render on demand mode, frameFunc is
+     * only called when consumeRedrawRequest returns true.
+     *
+     * returns after the render thread exits. exceptions thrown by frameFunc
+     * are rethrown on the calling thread.
+     */
+    void runRenderThread(const std::function<void()> &frameFunc);
+
+    bool isRenderThreadMode() const noexcept;
+
+    // can be called from the render thread in render thread mode
     bool getCloseFlag() const;
 
+    // can be called from the render thread in render thread mode
     void setCloseFlag(bool close);
 
     vk::Instance getInstance() const noexcept;
@@ -77,10 +224,20 @@ public:
 
     GraphicsDevice &getGraphicsDevice() const noexcept;
 
+    // also provides the shared vma allocator and pipeline cache
+    VulkanContext &getContext() const noexcept;
+
+    // pass to WindowDesc::context to create another window on this device
+    const std::shared_ptr<VulkanContext> &getSharedContext() const noexcept;
+
     vk::Queue getGraphicsQueue() const noexcept;
 
     vk::Queue getPresentQueue() const noexcept;
 
+    vk::Queue getComputeQueue() const noexcept;
+
+    vk::Queue getTransferQueue() const noexcept;
+
     vk::Device getDevice() const noexcept;
 
     vk::SwapchainKHR getSwapchain() const noexcept;
@@ -96,11 +253,80 @@ public:
 
     uint32_t getSwapchainImageCount() const noexcept;
 
+    // request a swapchain image count. the swapchain is marked dirty
+    // if the clamped count differs from the current one
+    void setSwapchainImageCount(uint32_t imageCount);
+
+    /**
+     * @brief update frames in flight and swapchain image count
+     *
+     * the window only records the number of frames in flight; renderers
+     * listening to WindowFramePacingEvent apply it to their frame resources.
+     * typically driven by FramePacingTuner
+     */
+    void setFramePacing(uint32_t framesInFlight, uint32_t imageCount);
+
+    uint32_t getFramesInFlight() const noexcept;
+
+    // errors are returned instead of thrown. eSuboptimalKHR and
+    // eErrorOutOfDateKHR mark the swapchain dirty
     vk::ResultValue<uint32_t> acquireNextImage(
         uint64_t timeout, vk::Semaphore semaphore, vk::Fence fence) const;
 
+    // present an image acquired by acquireNextImage and record its timing.
+    // errors are returned instead of thrown. eSuboptimalKHR and
+    // eErrorOutOfDateKHR mark the swapchain dirty
+    vk::Result present(
+        uint32_t imageIndex, vk::ArrayProxy<const vk::Semaphore> waitSemaphores);
+
+    // the old swapchain is passed as oldSwapchain and released through the
+    // deferred destroyer. if there is no destroyer, waits for the graphics
+    // and present queues to become idle before releasing it
     void recreateSwapchain();
 
+    // request a recreation at next doEvents
+    void markSwapchainDirty() const;
+
+    bool isSwapchainDirty() const noexcept;
+
+    const SwapchainStatistics &getSwapchainStatistics() const noexcept;
+
+    // e.g. [&](auto f) { frameScheduler.defer(std::move(f)); }
+    void setDeferredDestroyer(DeferredDestroyer destroyer);
+
+    // switch between windowed mode and fullscreen on the primary monitor.
+    // the swapchain is recreated by the resulting resize event
+    void setFullscreen(bool fullscreen);
+
+    bool isFullscreen() const noexcept;
+
+    // marks the swapchain dirty if the resulting present mode changes.
+    // Default is resolved with WindowDesc::vsync
+    void setPresentPolicy(PresentPolicy policy);
+
+    // resolved policy. never returns PresentPolicy::Default
+    PresentPolicy getPresentPolicy() const noexcept;
+
+    vk::PresentModeKHR getPresentMode() const noexcept;
+
+    PresentStatistics getPresentStatistics() const;
+
+    void resetPresentStatistics();
+
+    /**
+     * @brief copy content of a swapchain image to host memory
+     *
+     * waits for the graphics queue to become idle, then copies the image
+     * with tightly packed texels in swapchain format. the image must be in
+     * currentLayout and is transitioned back to it. intended for tests and
+     * headless rendering, not for per-frame use.
+     *
+     * throws if the swapchain does not support eTransferSrc usage.
+     */
+    std::vector<uint8_t> readbackSwapchainImage(
+        uint32_t      imageIndex,
+        vk::ImageLayout currentLayout = vk::ImageLayout::ePresentSrcKHR) const;
+
 private:
 
     WindowImplData *data_ = nullptr;
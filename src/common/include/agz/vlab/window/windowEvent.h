@@ -19,11 +19,20 @@ struct WindowPostRecreateSwapchainEvent
 
 struct WindowCloseEvent { };
 
+// sent by Window::setFramePacing. imageCount is clamped to surface limits
+// and takes effect at next swapchain recreation
+struct WindowFramePacingEvent
+{
+    uint32_t framesInFlight;
+    uint32_t imageCount;
+};
+
 class WindowEventManager :
     public event::sender_t<
                 WindowPreRecreateSwapchainEvent,
                 WindowPostRecreateSwapchainEvent,
-                WindowCloseEvent>
+                WindowCloseEvent,
+                WindowFramePacingEvent>
 {
 public:
 
@@ -41,6 +50,11 @@ public:
     {
         sender_t::send<WindowCloseEvent>(e);
     }
+
+    void send(const WindowFramePacingEvent &e) const
+    {
+        sender_t::send<WindowFramePacingEvent>(e);
+    }
 };
 
 AGZ_VULKAN_LAB_END
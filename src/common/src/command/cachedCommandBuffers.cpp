@@ -0,0 +1,90 @@
+#include <agz/vlab/command/cachedCommandBuffers.h>
+#include <agz/vlab/window/debugUtils.h>
+
+AGZ_VULKAN_LAB_BEGIN
+
+CachedCommandBuffers::CachedCommandBuffers(
+    vk::Device device, uint32_t queueFamilyIndex, uint32_t slotCount)
+    : device_(device)
+{
+    vk::CommandPoolCreateInfo poolInfo;
+    poolInfo.setQueueFamilyIndex(queueFamilyIndex);
+    pool_ = device_.createCommandPoolUnique(poolInfo);
+    setDebugName(device_, pool_.get(), "cached command pool");
+
+    resize(slotCount);
+}
+
+CachedCommandBuffers::~CachedCommandBuffers()
+{
+    cmdBufs_.clear();
+    pool_.reset();
+}
+
+void CachedCommandBuffers::resize(uint32_t slotCount)
+{
+    if(slotCount == getSlotCount())
+        return invalidate();
+
+    if(!cmdBufs_.empty())
+    {
+        device_.freeCommandBuffers(
+            pool_.get(), static_cast<uint32_t>(cmdBufs_.size()),
+            cmdBufs_.data());
+        cmdBufs_.clear();
+    }
+
+    if(slotCount)
+    {
+        vk::CommandBufferAllocateInfo info;
+        info
+            .setCommandPool(pool_.get())
+            .setLevel(vk::CommandBufferLevel::ePrimary)
+            .setCommandBufferCount(slotCount);
+        cmdBufs_ = device_.allocateCommandBuffers(info);
+
+        if(isDebugUtilsEnabled())
+        {
+            for(size_t i = 0; i < cmdBufs_.size(); ++i)
+            {
+                setDebugName(
+                    device_, cmdBufs_[i], "cached cmd " + std::to_string(i));
+            }
+        }
+    }
+
+    recorded_.assign(slotCount, false);
+}
+
+void CachedCommandBuffers::invalidate()
+{
+    if(std::find(recorded_.begin(), recorded_.end(), true) == recorded_.end())
+        return;
+
+    device_.resetCommandPool(pool_.get(), {});
+    std::fill(recorded_.begin(), recorded_.end(), false);
+}
+
+vk::CommandBuffer CachedCommandBuffers::get(
+    uint32_t slot, const RecordFunc &func)
+{
+    assert(slot < getSlotCount());
+    auto cmdBuf = cmdBufs_[slot];
+
+    if(recorded_[slot])
+    {
+        ++replayCount_;
+        return cmdBuf;
+    }
+
+    cmdBuf.begin(vk::CommandBufferBeginInfo{});
+    func(cmdBuf);
+    cmdBuf.end();
+
+    recorded_[slot] = true;
+    ++recordCount_;
+
+    return cmdBuf;
+}
+
+AGZ_VULKAN_LAB_END
@@ -0,0 +1,170 @@
+#include <agz/vlab/command/frameContext.h>
+#include <agz/vlab/profile/cpuTracer.h>
+#include <agz/vlab/window/debugUtils.h>
+
+AGZ_VULKAN_LAB_BEGIN
+
+FrameContext::FrameContext(
+    vk::Device device,
+    uint32_t   queueFamilyIndex,
+    uint32_t   frameCount,
+    ResetMode  resetMode)
+    : device_(device), resetMode_(resetMode)
+{
+    initFrames(queueFamilyIndex, frameCount);
+}
+
+FrameContext::FrameContext(
+    vk::Device      device,
+    uint32_t        queueFamilyIndex,
+    FrameScheduler &scheduler,
+    ResetMode       resetMode)
+    : device_(device), scheduler_(&scheduler), resetMode_(resetMode)
+{
+    initFrames(queueFamilyIndex, scheduler.getFramesInFlight());
+    frameIndex_ = scheduler.getFrameIndex();
+}
+
+FrameContext::~FrameContext()
+{
+    waitIdle();
+}
+
+void FrameContext::initFrames(uint32_t queueFamilyIndex, uint32_t frameCount)
+{
+    assert(frameCount > 0);
+
+    vk::CommandPoolCreateFlags poolFlags =
+        vk::CommandPoolCreateFlagBits::eTransient;
+    if(resetMode_ == ResetMode::Buffer)
+        poolFlags |= vk::CommandPoolCreateFlagBits::eResetCommandBuffer;
+
+    vk::CommandPoolCreateInfo poolInfo;
+    poolInfo
+        .setQueueFamilyIndex(queueFamilyIndex)
+        .setFlags(poolFlags);
+
+    frames_.resize(frameCount);
+    for(size_t i = 0; i < frames_.size(); ++i)
+    {
+        auto &f = frames_[i];
+
+        f.pool = device_.createCommandPoolUnique(poolInfo);
+        if(!scheduler_)
+            f.fence = device_.createFenceUnique({});
+
+        if(isDebugUtilsEnabled())
+        {
+            const std::string index = std::to_string(i);
+            setDebugName(device_, f.pool.get(), "frame pool " + index);
+            setDebugName(device_, f.fence.get(), "frame fence " + index);
+        }
+    }
+}
+
+void FrameContext::beginFrame()
+{
+    // the scheduler has waited for the frame using the same index
+    if(scheduler_)
+    {
+        frameIndex_ = scheduler_->getFrameIndex();
+        assert(frameIndex_ < getFrameCount());
+    }
+
+    auto &frame = frames_[frameIndex_];
+
+    if(frame.pending)
+    {
+        AGZ_VLAB_TRACE_SCOPE("wait frame fence");
+        (void)device_.waitForFences(1, &frame.fence.get(), true, UINT64_MAX);
+        frame.pending = false;
+    }
+
+    if(resetMode_ == ResetMode::Pool)
+    {
+        if(frame.usedCount[0] || frame.usedCount[1])
+            device_.resetCommandPool(frame.pool.get(), {});
+    }
+    else
+    {
+        for(size_t l = 0; l < 2; ++l)
+        {
+            for(size_t i = 0; i < frame.usedCount[l]; ++i)
+                frame.cmdBufs[l][i].reset({});
+        }
+    }
+
+    frame.usedCount[0] = frame.usedCount[1] = 0;
+}
+
+vk::CommandBuffer FrameContext::allocateCommandBuffer(
+    vk::CommandBufferLevel level)
+{
+    auto &frame = frames_[frameIndex_];
+
+    const size_t l = levelIndex(level);
+    auto &cmdBufs   = frame.cmdBufs[l];
+    auto &usedCount = frame.usedCount[l];
+
+    if(usedCount >= cmdBufs.size())
+    {
+        vk::CommandBufferAllocateInfo info;
+        info
+            .setCommandPool(frame.pool.get())
+            .setLevel(level)
+            .setCommandBufferCount(1);
+
+        cmdBufs.push_back(device_.allocateCommandBuffers(info).front());
+
+        if(isDebugUtilsEnabled())
+        {
+            setDebugName(
+                device_, cmdBufs.back(),
+                "frame " + std::to_string(frameIndex_) +
+                (l ? " secondary cmd " : " cmd ") +
+                std::to_string(cmdBufs.size() - 1));
+        }
+    }
+
+    return cmdBufs[usedCount++];
+}
+
+vk::Fence FrameContext::getSubmitFence()
+{
+    if(scheduler_)
+        return nullptr;
+
+    auto &frame = frames_[frameIndex_];
+    assert(!frame.pending);
+
+    (void)device_.resetFences(1, &frame.fence.get());
+    frame.pending = true;
+
+    return frame.fence.get();
+}
+
+void FrameContext::endFrame()
+{
+    if(!scheduler_)
+        frameIndex_ = (frameIndex_ + 1) % getFrameCount();
+}
+
+void FrameContext::waitIdle()
+{
+    if(scheduler_)
+    {
+        scheduler_->waitIdle();
+        return;
+    }
+
+    for(auto &f : frames_)
+    {
+        if(f.pending)
+        {
+            (void)device_.waitForFences(1, &f.fence.get(), true, UINT64_MAX);
+            f.pending = false;
+        }
+    }
+}
+
+AGZ_VULKAN_LAB_END
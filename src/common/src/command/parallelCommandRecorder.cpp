@@ -0,0 +1,232 @@
+#include <agz/vlab/command/parallelCommandRecorder.h>
+#include <agz/vlab/window/debugUtils.h>
+
+AGZ_VULKAN_LAB_BEGIN
+
+ParallelCommandRecorder::ParallelCommandRecorder(
+    vk::Device device,
+    uint32_t   queueFamilyIndex,
+    uint32_t   frameCount,
+    uint32_t   threadCount)
+{
+    assert(frameCount > 0);
+
+    if(!threadCount)
+        threadCount = (std::max)(1u, std::thread::hardware_concurrency());
+
+    device_      = device;
+    frameCount_  = frameCount;
+    threadCount_ = threadCount;
+
+    // command pools
+
+    vk::CommandPoolCreateInfo poolInfo;
+    poolInfo
+        .setQueueFamilyIndex(queueFamilyIndex)
+        .setFlags(vk::CommandPoolCreateFlagBits::eTransient);
+
+    contexts_.resize(frameCount_ * threadCount_);
+    for(size_t i = 0; i < contexts_.size(); ++i)
+    {
+        contexts_[i].pool = device_.createCommandPoolUnique(poolInfo);
+        if(isDebugUtilsEnabled())
+        {
+            setDebugName(
+                device_, contexts_[i].pool.get(),
+                "recorder pool (frame " + std::to_string(i / threadCount_) +
+                ", thread " + std::to_string(i % threadCount_) + ")");
+        }
+    }
+
+    // worker threads. thread 0 is the calling thread
+
+    misc::scope_guard_t workerGuard([&]
+    {
+        {
+            std::lock_guard lk(mutex_);
+            exit_ = true;
+        }
+        jobCond_.notify_all();
+        for(auto &w : workers_)
+            w.join();
+    });
+
+    for(uint32_t i = 1; i < threadCount_; ++i)
+        workers_.emplace_back(&ParallelCommandRecorder::workerMain, this, i);
+
+    workerGuard.dismiss();
+}
+
+ParallelCommandRecorder::~ParallelCommandRecorder()
+{
+    {
+        std::lock_guard lk(mutex_);
+        exit_ = true;
+    }
+    jobCond_.notify_all();
+
+    for(auto &w : workers_)
+        w.join();
+
+    contexts_.clear();
+}
+
+void ParallelCommandRecorder::beginFrame(uint32_t frameIndex)
+{
+    assert(frameIndex < frameCount_);
+    currentFrame_ = frameIndex;
+
+    for(uint32_t i = 0; i < threadCount_; ++i)
+    {
+        auto &context = getContext(frameIndex, i);
+        if(!context.usedCount)
+            continue;
+
+        device_.resetCommandPool(context.pool.get(), {});
+        context.usedCount = 0;
+    }
+}
+
+const std::vector<vk::CommandBuffer> &ParallelCommandRecorder::record(
+    const vk::CommandBufferInheritanceInfo &inheritance,
+    uint32_t                                taskCount,
+    const RecordFunc                       &func)
+{
+    results_.assign(taskCount, nullptr);
+    if(!taskCount)
+        return results_;
+
+    func_        = &func;
+    inheritance_ = inheritance;
+    taskCount_   = taskCount;
+    nextTask_    = 0;
+    exception_   = nullptr;
+
+    // wake up workers. small jobs are recorded on this thread only
+
+    const bool parallel = !workers_.empty() && taskCount > 1;
+
+    if(parallel)
+    {
+        {
+            std::lock_guard lk(mutex_);
+            ++jobID_;
+            activeWorkers_ = static_cast<uint32_t>(workers_.size());
+        }
+        jobCond_.notify_all();
+    }
+
+    runTasks(0);
+
+    if(parallel)
+    {
+        std::unique_lock lk(mutex_);
+        doneCond_.wait(lk, [&] { return activeWorkers_ == 0; });
+    }
+
+    func_ = nullptr;
+
+    if(exception_)
+        std::rethrow_exception(exception_);
+
+    return results_;
+}
+
+void ParallelCommandRecorder::recordInto(
+    vk::CommandBuffer                       primary,
+    const vk::CommandBufferInheritanceInfo &inheritance,
+    uint32_t                                taskCount,
+    const RecordFunc                       &func)
+{
+    auto &cmdBufs = record(inheritance, taskCount, func);
+    if(!cmdBufs.empty())
+    {
+        primary.executeCommands(
+            static_cast<uint32_t>(cmdBufs.size()), cmdBufs.data());
+    }
+}
+
+ParallelCommandRecorder::ThreadContext &ParallelCommandRecorder::getContext(
+    uint32_t frame, uint32_t thread) noexcept
+{
+    return contexts_[frame * threadCount_ + thread];
+}
+
+vk::CommandBuffer ParallelCommandRecorder::allocate(ThreadContext &context)
+{
+    if(context.usedCount >= context.cmdBufs.size())
+    {
+        vk::CommandBufferAllocateInfo info;
+        info
+            .setCommandPool(context.pool.get())
+            .setLevel(vk::CommandBufferLevel::eSecondary)
+            .setCommandBufferCount(1);
+
+        context.cmdBufs.push_back(device_.allocateCommandBuffers(info).front());
+    }
+
+    return context.cmdBufs[context.usedCount++];
+}
+
+void ParallelCommandRecorder::workerMain(uint32_t threadIndex)
+{
+    uint64_t lastJobID = 0;
+
+    for(;;)
+    {
+        {
+            std::unique_lock lk(mutex_);
+            jobCond_.wait(lk, [&] { return exit_ || jobID_ != lastJobID; });
+            if(exit_)
+                return;
+            lastJobID = jobID_;
+        }
+
+        runTasks(threadIndex);
+
+        {
+            std::lock_guard lk(mutex_);
+            if(!--activeWorkers_)
+                doneCond_.notify_one();
+        }
+    }
+}
+
+void ParallelCommandRecorder::runTasks(uint32_t threadIndex)
+{
+    auto &context = getContext(currentFrame_, threadIndex);
+
+    vk::CommandBufferBeginInfo beginInfo;
+    beginInfo
+        .setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit |
+                  vk::CommandBufferUsageFlagBits::eRenderPassContinue)
+        .setPInheritanceInfo(&inheritance_);
+
+    for(;;)
+    {
+        const uint32_t taskIndex = nextTask_.fetch_add(1);
+        if(taskIndex >= taskCount_)
+            return;
+
+        try
+        {
+            auto cmdBuf = allocate(context);
+
+            cmdBuf.begin(beginInfo);
+            (*func_)(cmdBuf, taskIndex);
+            cmdBuf.end();
+
+            results_[taskIndex] = cmdBuf;
+        }
+        catch(...)
+        {
+            std::lock_guard lk(exceptionMutex_);
+            if(!exception_)
+                exception_ = std::current_exception();
+            nextTask_ = taskCount_;
+            return;
+        }
+    }
+}
+
+AGZ_VULKAN_LAB_END
@@ -0,0 +1,849 @@
+#include <agz/vlab/graph/renderGraph.h>
+#include <agz/vlab/window/debugUtils.h>
+
+AGZ_VULKAN_LAB_BEGIN
+
+vk::Image RGPassContext::getImage(RGImage image) const
+{
+    return graph_->images_.at(image.index).image;
+}
+
+vk::ImageView RGPassContext::getImageView(RGImage image) const
+{
+    return graph_->images_.at(image.index).view;
+}
+
+RGPassBuilder &RGPassBuilder::colorAttachment(
+    RGImage image, std::optional<vk::ClearColorValue> clear)
+{
+    RenderGraph::Usage usage;
+    usage.image        = image.index;
+    usage.state.layout = vk::ImageLayout::eColorAttachmentOptimal;
+    usage.state.stages = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+    usage.state.access = vk::AccessFlagBits::eColorAttachmentWrite;
+    usage.imageUsage   = vk::ImageUsageFlagBits::eColorAttachment;
+    usage.read         = !clear;
+    usage.write        = true;
+    usage.discard      = clear.has_value();
+    usage.attachment   = 1;
+
+    if(clear)
+        usage.clear = vk::ClearValue(*clear);
+    else
+        usage.state.access |= vk::AccessFlagBits::eColorAttachmentRead;
+
+    graph_->addUsage(pass_, usage);
+    return *this;
+}
+
+RGPassBuilder &RGPassBuilder::depthAttachment(
+    RGImage image, std::optional<vk::ClearDepthStencilValue> clear)
+{
+    RenderGraph::Usage usage;
+    usage.image        = image.index;
+    usage.state.layout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+    usage.state.stages = vk::PipelineStageFlagBits::eEarlyFragmentTests |
+                         vk::PipelineStageFlagBits::eLateFragmentTests;
+    usage.state.access = vk::AccessFlagBits::eDepthStencilAttachmentRead |
+                         vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+    usage.imageUsage   = vk::ImageUsageFlagBits::eDepthStencilAttachment;
+    usage.read         = !clear;
+    usage.write        = true;
+    usage.discard      = clear.has_value();
+    usage.attachment   = 2;
+
+    if(clear)
+        usage.clear = vk::ClearValue(*clear);
+
+    graph_->addUsage(pass_, usage);
+    return *this;
+}
+
+RGPassBuilder &RGPassBuilder::depthAttachmentReadOnly(RGImage image)
+{
+    RenderGraph::Usage usage;
+    usage.image        = image.index;
+    usage.state.layout = vk::ImageLayout::eDepthStencilReadOnlyOptimal;
+    usage.state.stages = vk::PipelineStageFlagBits::eEarlyFragmentTests |
+                         vk::PipelineStageFlagBits::eLateFragmentTests;
+    usage.state.access = vk::AccessFlagBits::eDepthStencilAttachmentRead;
+    usage.imageUsage   = vk::ImageUsageFlagBits::eDepthStencilAttachment;
+    usage.read         = true;
+    usage.attachment   = 2;
+
+    graph_->addUsage(pass_, usage);
+    return *this;
+}
+
+RGPassBuilder &RGPassBuilder::sampled(
+    RGImage image, vk::PipelineStageFlags stages)
+{
+    RenderGraph::Usage usage;
+    usage.image        = image.index;
+    usage.state.layout = vk::ImageLayout::eShaderReadOnlyOptimal;
+    usage.state.stages = stages;
+    usage.state.access = vk::AccessFlagBits::eShaderRead;
+    usage.imageUsage   = vk::ImageUsageFlagBits::eSampled;
+    usage.read         = true;
+
+    graph_->addUsage(pass_, usage);
+    return *this;
+}
+
+RGPassBuilder &RGPassBuilder::storage(
+    RGImage image, bool write, vk::PipelineStageFlags stages)
+{
+    RenderGraph::Usage usage;
+    usage.image        = image.index;
+    usage.state.layout = vk::ImageLayout::eGeneral;
+    usage.state.stages = stages;
+    usage.state.access = vk::AccessFlagBits::eShaderRead;
+    usage.imageUsage   = vk::ImageUsageFlagBits::eStorage;
+    usage.read         = true;
+    usage.write        = write;
+
+    if(write)
+        usage.state.access |= vk::AccessFlagBits::eShaderWrite;
+
+    graph_->addUsage(pass_, usage);
+    return *this;
+}
+
+RGPassBuilder &RGPassBuilder::transferSrc(RGImage image)
+{
+    RenderGraph::Usage usage;
+    usage.image        = image.index;
+    usage.state.layout = vk::ImageLayout::eTransferSrcOptimal;
+    usage.state.stages = vk::PipelineStageFlagBits::eTransfer;
+    usage.state.access = vk::AccessFlagBits::eTransferRead;
+    usage.imageUsage   = vk::ImageUsageFlagBits::eTransferSrc;
+    usage.read         = true;
+
+    graph_->addUsage(pass_, usage);
+    return *this;
+}
+
+RGPassBuilder &RGPassBuilder::transferDst(RGImage image, bool discard)
+{
+    RenderGraph::Usage usage;
+    usage.image        = image.index;
+    usage.state.layout = vk::ImageLayout::eTransferDstOptimal;
+    usage.state.stages = vk::PipelineStageFlagBits::eTransfer;
+    usage.state.access = vk::AccessFlagBits::eTransferWrite;
+    usage.imageUsage   = vk::ImageUsageFlagBits::eTransferDst;
+    usage.read         = !discard;
+    usage.write        = true;
+    usage.discard      = discard;
+
+    graph_->addUsage(pass_, usage);
+    return *this;
+}
+
+RGPassBuilder &RGPassBuilder::sideEffect()
+{
+    graph_->passes_[pass_].sideEffect = true;
+    return *this;
+}
+
+RenderGraph::RenderGraph(vk::Device device, VMAAlloc &alloc)
+    : device_(device), alloc_(alloc)
+{
+
+}
+
+RenderGraph::~RenderGraph()
+{
+    destroyCompiled();
+}
+
+RGImage RenderGraph::importImage(
+    std::string         name,
+    const RGImageDesc  &desc,
+    const RGImageState &initial,
+    const RGImageState &final)
+{
+    assert(!compiled_);
+
+    Image image;
+    image.name     = std::move(name);
+    image.desc     = desc;
+    image.imported = true;
+    image.initial  = initial;
+    image.final    = final;
+
+    images_.push_back(std::move(image));
+    return { static_cast<uint32_t>(images_.size() - 1) };
+}
+
+RGImage RenderGraph::createImage(std::string name, const RGImageDesc &desc)
+{
+    assert(!compiled_);
+
+    Image image;
+    image.name = std::move(name);
+    image.desc = desc;
+
+    images_.push_back(std::move(image));
+    return { static_cast<uint32_t>(images_.size() - 1) };
+}
+
+RGPassBuilder RenderGraph::addPass(std::string name, ExecuteFunc func)
+{
+    assert(!compiled_);
+
+    Pass pass;
+    pass.name = std::move(name);
+    pass.func = std::move(func);
+
+    passes_.push_back(std::move(pass));
+    return RGPassBuilder(this, static_cast<uint32_t>(passes_.size() - 1));
+}
+
+void RenderGraph::compile()
+{
+    destroyCompiled();
+
+    misc::scope_guard_t compileGuard([&] { destroyCompiled(); });
+
+    cullPasses();
+    collectLifetimes();
+    allocateTransientImages();
+    computeBarriersAndRenderPasses();
+
+    compileGuard.dismiss();
+    compiled_ = true;
+}
+
+void RenderGraph::reset()
+{
+    destroyCompiled();
+    passes_.clear();
+    images_.clear();
+}
+
+void RenderGraph::setImportedImage(
+    RGImage image, vk::Image handle, vk::ImageView view)
+{
+    auto &img = images_.at(image.index);
+    assert(img.imported);
+    img.image = handle;
+    img.view  = view;
+}
+
+void RenderGraph::invalidateImportedViews()
+{
+    for(auto &p : passes_)
+        p.framebuffers.clear();
+}
+
+void RenderGraph::execute(
+    vk::CommandBuffer cmdBuf, const vk::DispatchLoaderDynamic &dispatch)
+{
+    assert(compiled_);
+
+    RGPassContext context;
+    context.dispatch = &dispatch;
+    context.graph_   = this;
+
+    for(auto &pass : passes_)
+    {
+        if(pass.culled)
+            continue;
+
+        DebugLabelScope label(cmdBuf, pass.name.c_str(), {}, dispatch);
+
+        recordBarriers(cmdBuf, pass.barriers, dispatch);
+
+        if(!pass.renderPass)
+        {
+            context.renderPass  = nullptr;
+            context.framebuffer = nullptr;
+            context.extent      = vk::Extent2D{};
+
+            if(pass.func)
+                pass.func(cmdBuf, context);
+            continue;
+        }
+
+        context.renderPass  = pass.renderPass.get();
+        context.framebuffer = getFramebuffer(pass);
+        context.extent      = pass.extent;
+
+        vk::RenderPassBeginInfo beginInfo;
+        beginInfo
+            .setRenderPass(context.renderPass)
+            .setFramebuffer(context.framebuffer)
+            .setRenderArea({ { 0, 0 }, pass.extent })
+            .setClearValueCount(static_cast<uint32_t>(pass.clearValues.size()))
+            .setPClearValues(pass.clearValues.data());
+
+        cmdBuf.beginRenderPass(
+            beginInfo, vk::SubpassContents::eInline, dispatch);
+        if(pass.func)
+            pass.func(cmdBuf, context);
+        cmdBuf.endRenderPass(dispatch);
+    }
+
+    recordBarriers(cmdBuf, finalBarriers_, dispatch);
+}
+
+bool RenderGraph::isCulled(RGPass pass) const
+{
+    assert(compiled_);
+    return passes_.at(pass.index).culled;
+}
+
+vk::RenderPass RenderGraph::getRenderPass(RGPass pass) const
+{
+    assert(compiled_);
+    return passes_.at(pass.index).renderPass.get();
+}
+
+void RenderGraph::addUsage(uint32_t pass, const Usage &usage)
+{
+    // one usage gives one barrier. two in the same batch would transition
+    // the image twice in one vkCmdPipelineBarrier
+
+    auto &p = passes_[pass];
+    for(auto &u : p.usages)
+    {
+        if(u.image == usage.image)
+        {
+            throw std::runtime_error(
+                "render graph pass '" + p.name + "' uses image '" +
+                images_[usage.image].name + "' more than once");
+        }
+    }
+
+    p.usages.push_back(usage);
+}
+
+void RenderGraph::cullPasses()
+{
+    // walk backwards from imported images and side-effect passes
+
+    std::vector<bool> live(images_.size(), false);
+    for(size_t i = 0; i < images_.size(); ++i)
+        live[i] = images_[i].imported;
+
+    for(auto it = passes_.rbegin(); it != passes_.rend(); ++it)
+    {
+        auto &pass = *it;
+
+        bool needed = pass.sideEffect;
+        for(auto &u : pass.usages)
+        {
+            if(u.write && live[u.image])
+                needed = true;
+        }
+
+        pass.culled = !needed;
+        if(!needed)
+            continue;
+
+        // earlier content of discarded images is not needed
+
+        for(auto &u : pass.usages)
+        {
+            if(u.write && u.discard && !u.read)
+                live[u.image] = false;
+        }
+
+        for(auto &u : pass.usages)
+        {
+            if(u.read)
+                live[u.image] = true;
+        }
+    }
+
+    statistics_.passCount = static_cast<uint32_t>(passes_.size());
+    for(auto &p : passes_)
+    {
+        if(p.culled)
+            ++statistics_.culledPassCount;
+    }
+}
+
+void RenderGraph::collectLifetimes()
+{
+    for(uint32_t p = 0; p < passes_.size(); ++p)
+    {
+        if(passes_[p].culled)
+            continue;
+
+        for(auto &u : passes_[p].usages)
+        {
+            auto &img = images_[u.image];
+            img.usage    |= u.imageUsage;
+            img.firstPass = (std::min)(img.firstPass, p);
+            img.lastPass  = (std::max)(img.lastPass, p);
+        }
+    }
+}
+
+void RenderGraph::allocateTransientImages()
+{
+    // create images without memory
+
+    std::vector<uint32_t>               transients;
+    std::vector<vk::MemoryRequirements> requirements(images_.size());
+
+    for(uint32_t i = 0; i < images_.size(); ++i)
+    {
+        auto &img = images_[i];
+        if(img.imported || img.firstPass == UINT32_MAX)
+            continue;
+
+        vk::ImageCreateInfo info;
+        info
+            .setImageType(vk::ImageType::e2D)
+            .setFormat(img.desc.format)
+            .setExtent({ img.desc.extent.width, img.desc.extent.height, 1 })
+            .setMipLevels(1)
+            .setArrayLayers(1)
+            .setSamples(img.desc.samples)
+            .setTiling(vk::ImageTiling::eOptimal)
+            .setUsage(img.usage)
+            .setSharingMode(vk::SharingMode::eExclusive)
+            .setInitialLayout(vk::ImageLayout::eUndefined);
+
+        img.ownedImage  = device_.createImageUnique(info);
+        img.image       = img.ownedImage.get();
+        setDebugName(device_, img.image, img.name);
+        requirements[i] = device_.getImageMemoryRequirements(img.image);
+
+        statistics_.unaliasedMemory += requirements[i].size;
+        transients.push_back(i);
+    }
+
+    // assign memory slots. larger images first
+
+    std::sort(transients.begin(), transients.end(),
+        [&](uint32_t a, uint32_t b)
+    {
+        return requirements[a].size > requirements[b].size;
+    });
+
+    auto overlaps = [&](const MemorySlot &slot, const Image &img)
+    {
+        for(auto i : slot.images)
+        {
+            auto &other = images_[i];
+            if(other.firstPass <= img.lastPass &&
+               img.firstPass <= other.lastPass)
+                return true;
+        }
+        return false;
+    };
+
+    for(auto i : transients)
+    {
+        auto &img = images_[i];
+        auto &req = requirements[i];
+
+        uint32_t slotIndex = 0;
+        for(; slotIndex < memorySlots_.size(); ++slotIndex)
+        {
+            auto &slot = memorySlots_[slotIndex];
+            if((slot.memoryTypeBits & req.memoryTypeBits) &&
+               !overlaps(slot, img))
+                break;
+        }
+
+        if(slotIndex == memorySlots_.size())
+            memorySlots_.emplace_back();
+
+        auto &slot = memorySlots_[slotIndex];
+        slot.size           = (std::max)(slot.size, req.size);
+        slot.alignment      = (std::max)(slot.alignment, req.alignment);
+        slot.memoryTypeBits = slot.memoryTypeBits & req.memoryTypeBits;
+        slot.images.push_back(i);
+
+        if(slot.lastImage == UINT32_MAX ||
+           images_[slot.lastImage].lastPass < img.lastPass)
+            slot.lastImage = i;
+
+        img.memorySlot = slotIndex;
+    }
+
+    // allocate & bind memory
+
+    const VmaAllocator allocator = alloc_.getAllocator();
+
+    for(auto &slot : memorySlots_)
+    {
+        VkMemoryRequirements req;
+        req.size           = slot.size;
+        req.alignment      = slot.alignment;
+        req.memoryTypeBits = slot.memoryTypeBits;
+
+        VmaAllocationCreateInfo allocInfo = {};
+        allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+        if(auto rt = vmaAllocateMemory(
+            allocator, &req, &allocInfo, &slot.alloc, nullptr);
+            rt != VK_SUCCESS)
+        {
+            throw std::runtime_error(
+                "failed to allocate render graph memory. err code = " +
+                std::to_string(rt));
+        }
+
+        statistics_.transientMemory += slot.size;
+
+        for(auto i : slot.images)
+        {
+            if(auto rt = vmaBindImageMemory(
+                allocator, slot.alloc, images_[i].image); rt != VK_SUCCESS)
+            {
+                throw std::runtime_error(
+                    "failed to bind render graph image memory. err code = " +
+                    std::to_string(rt));
+            }
+        }
+
+        // the image that used this memory right before each image
+
+        for(auto i : slot.images)
+        {
+            auto &img = images_[i];
+            for(auto j : slot.images)
+            {
+                auto &other = images_[j];
+                if(other.lastPass >= img.firstPass)
+                    continue;
+                if(img.aliasPrecursor == UINT32_MAX ||
+                   images_[img.aliasPrecursor].lastPass < other.lastPass)
+                    img.aliasPrecursor = j;
+            }
+        }
+    }
+
+    // image views
+
+    for(auto i : transients)
+    {
+        auto &img = images_[i];
+
+        vk::ImageViewCreateInfo info;
+        info
+            .setImage(img.image)
+            .setViewType(vk::ImageViewType::e2D)
+            .setFormat(img.desc.format)
+            .setSubresourceRange({ img.desc.aspect, 0, 1, 0, 1 });
+
+        img.ownedView = device_.createImageViewUnique(info);
+        img.view      = img.ownedView.get();
+        setDebugName(device_, img.view, img.name);
+    }
+}
+
+void RenderGraph::computeBarriersAndRenderPasses()
+{
+    std::vector<ResourceAccessState> states(images_.size());
+    std::vector<bool>         initialized(images_.size(), false);
+    std::vector<bool>         hasContent(images_.size(), false);
+
+    for(size_t i = 0; i < images_.size(); ++i)
+    {
+        auto &img = images_[i];
+        if(!img.imported)
+            continue;
+
+        states[i] = ResourceAccessState::fromState(img.initial);
+
+        initialized[i] = true;
+        hasContent[i]  = img.initial.layout != vk::ImageLayout::eUndefined;
+    }
+
+    // states of transient images at the end of an execution. the first
+    // use of transient images starts from undefined layout, so these don't
+    // depend on the previous execution
+
+    std::vector<ResourceAccessState> endStates(images_.size());
+    for(auto &pass : passes_)
+    {
+        if(pass.culled)
+            continue;
+
+        for(auto &u : pass.usages)
+        {
+            ResourceTransition t;
+            if(!images_[u.image].imported)
+                endStates[u.image].transition(u.state, u.discard, t);
+        }
+    }
+
+    auto addBarrier = [&](
+        BarrierBatch &batch, uint32_t image, const RGImageState &next,
+        bool discard)
+    {
+        if(!initialized[image])
+        {
+            // inherit the last accesses of the aliased precursor so that
+            // its work completes before the memory is reused. the first
+            // user of a memory slot waits for the last user of the
+            // previous execution instead
+
+            const ResourceAccessState *p = nullptr;
+
+            auto &img = images_[image];
+            if(img.aliasPrecursor != UINT32_MAX)
+                p = &states[img.aliasPrecursor];
+            else if(img.memorySlot != UINT32_MAX)
+                p = &endStates[memorySlots_[img.memorySlot].lastImage];
+
+            if(p)
+            {
+                states[image].writeStages = p->writeStages | p->readStages;
+                states[image].writeAccess = p->writeAccess;
+            }
+            initialized[image] = true;
+        }
+
+        ResourceTransition t;
+        if(!states[image].transition(next, discard, t))
+            return;
+
+        batch.srcStages |= t.srcStages;
+        batch.dstStages |= t.dstStages;
+
+        if(t.memoryBarrier)
+        {
+            batch.barriers.push_back(
+                { image, t.srcAccess, t.dstAccess, t.oldLayout, t.newLayout });
+        }
+    };
+
+    for(uint32_t p = 0; p < passes_.size(); ++p)
+    {
+        auto &pass = passes_[p];
+        if(pass.culled)
+            continue;
+
+        createRenderPass(pass, hasContent);
+
+        for(auto &u : pass.usages)
+            addBarrier(pass.barriers, u.image, u.state, u.discard);
+
+        for(auto &u : pass.usages)
+        {
+            if(u.write)
+                hasContent[u.image] = true;
+        }
+
+        if(!pass.barriers.empty())
+        {
+            ++statistics_.barrierBatchCount;
+            statistics_.imageBarrierCount +=
+                static_cast<uint32_t>(pass.barriers.barriers.size());
+        }
+    }
+
+    for(uint32_t i = 0; i < images_.size(); ++i)
+    {
+        auto &img = images_[i];
+        if(img.imported)
+            addBarrier(finalBarriers_, i, img.final, false);
+    }
+
+    if(!finalBarriers_.empty())
+    {
+        ++statistics_.barrierBatchCount;
+        statistics_.imageBarrierCount +=
+            static_cast<uint32_t>(finalBarriers_.barriers.size());
+    }
+}
+
+void RenderGraph::createRenderPass(
+    Pass &pass, const std::vector<bool> &hasContent)
+{
+    const uint32_t passIndex = static_cast<uint32_t>(&pass - passes_.data());
+
+    std::vector<vk::AttachmentDescription> descs;
+    std::vector<vk::AttachmentReference>   colorRefs;
+    std::optional<vk::AttachmentReference> depthRef;
+
+    for(auto &u : pass.usages)
+    {
+        if(!u.attachment)
+            continue;
+
+        auto &img = images_[u.image];
+
+        vk::AttachmentLoadOp loadOp;
+        if(u.clear)
+            loadOp = vk::AttachmentLoadOp::eClear;
+        else if(u.discard || !hasContent[u.image])
+            loadOp = vk::AttachmentLoadOp::eDontCare;
+        else
+            loadOp = vk::AttachmentLoadOp::eLoad;
+
+        const bool usedLater = img.imported || img.lastPass > passIndex;
+        const vk::AttachmentStoreOp storeOp = usedLater ?
+            vk::AttachmentStoreOp::eStore : vk::AttachmentStoreOp::eDontCare;
+
+        const bool hasStencil =
+            static_cast<bool>(img.desc.aspect & vk::ImageAspectFlagBits::eStencil);
+
+        vk::AttachmentDescription desc;
+        desc
+            .setFormat(img.desc.format)
+            .setSamples(img.desc.samples)
+            .setLoadOp(loadOp)
+            .setStoreOp(storeOp)
+            .setStencilLoadOp(
+                hasStencil ? loadOp : vk::AttachmentLoadOp::eDontCare)
+            .setStencilStoreOp(
+                hasStencil ? storeOp : vk::AttachmentStoreOp::eDontCare)
+            .setInitialLayout(u.state.layout)
+            .setFinalLayout(u.state.layout);
+
+        const vk::AttachmentReference ref(
+            static_cast<uint32_t>(descs.size()), u.state.layout);
+
+        if(u.attachment == 1)
+            colorRefs.push_back(ref);
+        else
+            depthRef = ref;
+
+        descs.push_back(desc);
+        pass.attachments.push_back(u.image);
+        pass.clearValues.push_back(u.clear.value_or(vk::ClearValue{}));
+    }
+
+    if(descs.empty())
+        return;
+
+    pass.extent = images_[pass.attachments[0]].desc.extent;
+
+    vk::SubpassDescription subpass;
+    subpass
+        .setPipelineBindPoint(vk::PipelineBindPoint::eGraphics)
+        .setColorAttachmentCount(static_cast<uint32_t>(colorRefs.size()))
+        .setPColorAttachments(colorRefs.data())
+        .setPDepthStencilAttachment(depthRef ? &*depthRef : nullptr);
+
+    // layout transitions and external dependencies are done by graph barriers
+
+    vk::RenderPassCreateInfo info;
+    info
+        .setAttachmentCount(static_cast<uint32_t>(descs.size()))
+        .setPAttachments(descs.data())
+        .setSubpassCount(1)
+        .setPSubpasses(&subpass);
+
+    pass.renderPass = device_.createRenderPassUnique(info);
+    setDebugName(device_, pass.renderPass.get(), pass.name);
+}
+
+vk::Framebuffer RenderGraph::getFramebuffer(Pass &pass)
+{
+    std::vector<VkImageView>   key;
+    std::vector<vk::ImageView> views;
+    for(auto i : pass.attachments)
+    {
+        assert(images_[i].view);
+        key.push_back(static_cast<VkImageView>(images_[i].view));
+        views.push_back(images_[i].view);
+    }
+
+    if(auto it = pass.framebuffers.find(key); it != pass.framebuffers.end())
+        return it->second.get();
+
+    // handles of destroyed views may be reused, so the cache must be
+    // invalidated rather than grow
+    if(pass.framebuffers.size() >= MAX_CACHED_FRAMEBUFFERS)
+    {
+        throw std::runtime_error(
+            "too many framebuffers cached by render graph pass " + pass.name +
+            ". call invalidateImportedViews when imported views change");
+    }
+
+    vk::FramebufferCreateInfo info;
+    info
+        .setRenderPass(pass.renderPass.get())
+        .setAttachmentCount(static_cast<uint32_t>(views.size()))
+        .setPAttachments(views.data())
+        .setWidth(pass.extent.width)
+        .setHeight(pass.extent.height)
+        .setLayers(1);
+
+    auto framebuffer = device_.createFramebufferUnique(info);
+    setDebugName(device_, framebuffer.get(), pass.name);
+    const auto ret = framebuffer.get();
+    pass.framebuffers[key] = std::move(framebuffer);
+
+    return ret;
+}
+
+void RenderGraph::recordBarriers(
+    vk::CommandBuffer                cmdBuf,
+    const BarrierBatch              &batch,
+    const vk::DispatchLoaderDynamic &dispatch) const
+{
+    if(batch.empty())
+        return;
+
+    std::vector<vk::ImageMemoryBarrier> barriers;
+    barriers.reserve(batch.barriers.size());
+
+    for(auto &b : batch.barriers)
+    {
+        auto &img = images_[b.image];
+        assert(img.image);
+
+        barriers.emplace_back(
+            b.srcAccess, b.dstAccess, b.oldLayout, b.newLayout,
+            VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, img.image,
+            vk::ImageSubresourceRange(img.desc.aspect, 0, 1, 0, 1));
+    }
+
+    cmdBuf.pipelineBarrier(
+        batch.srcStages, batch.dstStages, {}, 0, nullptr, 0, nullptr,
+        static_cast<uint32_t>(barriers.size()), barriers.data(), dispatch);
+}
+
+void RenderGraph::destroyCompiled()
+{
+    for(auto &p : passes_)
+    {
+        p.culled = false;
+        p.barriers = {};
+        p.framebuffers.clear();
+        p.renderPass.reset();
+        p.attachments.clear();
+        p.clearValues.clear();
+        p.extent = vk::Extent2D{};
+    }
+
+    for(auto &img : images_)
+    {
+        img.usage          = {};
+        img.firstPass      = UINT32_MAX;
+        img.lastPass       = 0;
+        img.memorySlot     = UINT32_MAX;
+        img.aliasPrecursor = UINT32_MAX;
+
+        if(!img.imported)
+        {
+            img.ownedView.reset();
+            img.ownedImage.reset();
+            img.image = nullptr;
+            img.view  = nullptr;
+        }
+    }
+
+    for(auto &slot : memorySlots_)
+    {
+        if(slot.alloc)
+            vmaFreeMemory(alloc_.getAllocator(), slot.alloc);
+    }
+    memorySlots_.clear();
+
+    finalBarriers_ = {};
+    statistics_    = {};
+    compiled_      = false;
+}
+
+AGZ_VULKAN_LAB_END
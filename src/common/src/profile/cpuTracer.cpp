@@ -0,0 +1,281 @@
+#include <chrono>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include <agz/vlab/profile/cpuTracer.h>
+
+AGZ_VULKAN_LAB_BEGIN
+
+namespace
+{
+    // tid of the gpu track. threads start from 1
+    constexpr uint32_t GPU_TRACK = 0;
+
+    constexpr size_t CHUNK_SIZE = 4096;
+
+    struct Event
+    {
+        const char *name;
+        uint64_t    begin;
+        uint64_t    end;
+        bool        gpu;
+    };
+
+    struct Chunk
+    {
+        Event events[CHUNK_SIZE];
+
+        std::atomic<Chunk *> next = nullptr;
+    };
+
+    // written by its thread only. readers see the first 'count' events.
+    // the thread only touches the tail chunk, so chunks it has moved past
+    // can be freed by clear
+    struct ThreadBuffer
+    {
+        explicit ThreadBuffer(uint32_t tid)
+            : tid(tid), head(new Chunk), tail(head)
+        {
+
+        }
+
+        ~ThreadBuffer()
+        {
+            Chunk *c = head;
+            while(c)
+            {
+                Chunk *next = c->next.load();
+                delete c;
+                c = next;
+            }
+        }
+
+        uint32_t tid;
+
+        // guarded by Registry::mutex
+        std::string name;
+
+        // guarded by Registry::mutex. headIndex is the index of the first
+        // event in head
+        Chunk *head;
+        size_t headIndex = 0;
+
+        Chunk *tail;
+
+        std::atomic<size_t> count   = 0;
+        std::atomic<size_t> cleared = 0;
+    };
+
+    // buffers outlive their threads so that events of exited threads
+    // are still exported
+    struct Registry
+    {
+        std::mutex mutex;
+
+        std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+        std::set<std::string> names;
+
+        uint64_t startTime = 0;
+    };
+
+    Registry &getRegistry()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    ThreadBuffer &getThreadBuffer()
+    {
+        thread_local ThreadBuffer *buffer = []
+        {
+            auto &reg = getRegistry();
+            std::lock_guard lk(reg.mutex);
+
+            const auto tid = static_cast<uint32_t>(reg.buffers.size() + 1);
+            reg.buffers.push_back(std::make_unique<ThreadBuffer>(tid));
+            return reg.buffers.back().get();
+        }();
+        return *buffer;
+    }
+
+    void pushEvent(const Event &event)
+    {
+        auto &buf = getThreadBuffer();
+
+        const size_t n = buf.count.load(std::memory_order_relaxed);
+        const size_t i = n % CHUNK_SIZE;
+
+        if(n && !i)
+        {
+            Chunk *chunk = new Chunk;
+            buf.tail->next.store(chunk, std::memory_order_release);
+            buf.tail = chunk;
+        }
+
+        buf.tail->events[i] = event;
+        buf.count.store(n + 1, std::memory_order_release);
+    }
+
+    void writeJSONString(std::ostream &out, const char *str)
+    {
+        out << '"';
+        for(; *str; ++str)
+        {
+            if(*str == '"' || *str == '\\')
+                out << '\\' << *str;
+            else if(static_cast<unsigned char>(*str) < 0x20)
+                out << ' ';
+            else
+                out << *str;
+        }
+        out << '"';
+    }
+
+    void writeThreadName(
+        std::ostream &out, uint32_t tid, const std::string &name)
+    {
+        out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+               "\"tid\":" << tid << ",\"args\":{\"name\":";
+        writeJSONString(out, name.c_str());
+        out << "}}";
+    }
+}
+
+void CpuTracer::start()
+{
+    {
+        auto &reg = getRegistry();
+        std::lock_guard lk(reg.mutex);
+        if(!reg.startTime)
+            reg.startTime = now();
+    }
+    enabled_ = true;
+}
+
+void CpuTracer::stop()
+{
+    enabled_ = false;
+}
+
+uint64_t CpuTracer::now() noexcept
+{
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void CpuTracer::setThreadName(const std::string &name)
+{
+    auto &buf = getThreadBuffer();
+    auto &reg = getRegistry();
+    std::lock_guard lk(reg.mutex);
+    buf.name = name;
+}
+
+const char *CpuTracer::internName(const std::string &name)
+{
+    auto &reg = getRegistry();
+    std::lock_guard lk(reg.mutex);
+    return reg.names.insert(name).first->c_str();
+}
+
+void CpuTracer::addEvent(const char *name, uint64_t beginNs, uint64_t endNs)
+{
+    if(isEnabled())
+        pushEvent({ name, beginNs, endNs, false });
+}
+
+void CpuTracer::addGpuEvent(
+    const char *name, uint64_t beginNs, uint64_t endNs)
+{
+    if(isEnabled())
+        pushEvent({ name, beginNs, endNs, true });
+}
+
+void CpuTracer::clear()
+{
+    auto &reg = getRegistry();
+    std::lock_guard lk(reg.mutex);
+    for(auto &buf : reg.buffers)
+    {
+        const size_t count = buf->count.load(std::memory_order_acquire);
+        buf->cleared.store(count);
+
+        // event headIndex + CHUNK_SIZE has been pushed, so the thread has
+        // linked and moved to the next chunk
+
+        while(buf->headIndex + CHUNK_SIZE < count)
+        {
+            Chunk *next = buf->head->next.load(std::memory_order_acquire);
+            delete buf->head;
+            buf->head       = next;
+            buf->headIndex += CHUNK_SIZE;
+        }
+    }
+}
+
+void CpuTracer::writeChromeTrace(std::ostream &out)
+{
+    auto &reg = getRegistry();
+    std::lock_guard lk(reg.mutex);
+
+    const auto oldFlags     = out.flags();
+    const auto oldPrecision = out.precision();
+
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+           "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+           "\"args\":{\"name\":\"AGZ VLab\"}}";
+
+    writeThreadName(out, GPU_TRACK, "GPU");
+    for(auto &buf : reg.buffers)
+    {
+        writeThreadName(out, buf->tid, buf->name.empty() ?
+            "thread " + std::to_string(buf->tid) : buf->name);
+    }
+
+    // microseconds since the first start(). gpu events may slightly
+    // precede it due to calibration error
+
+    auto toUs = [&](uint64_t ns)
+    {
+        return (static_cast<double>(ns) -
+                static_cast<double>(reg.startTime)) * 1e-3;
+    };
+
+    for(auto &buf : reg.buffers)
+    {
+        const size_t count   = buf->count.load(std::memory_order_acquire);
+        const size_t cleared = buf->cleared.load();
+
+        const Chunk *chunk = buf->head;
+        for(size_t i = buf->headIndex; i < count; ++i)
+        {
+            if(i != buf->headIndex && !(i % CHUNK_SIZE))
+                chunk = chunk->next.load(std::memory_order_acquire);
+
+            if(i < cleared)
+                continue;
+
+            const Event &e = chunk->events[i % CHUNK_SIZE];
+
+            out << ",\n{\"name\":";
+            writeJSONString(out, e.name);
+            out << ",\"ph\":\"X\",\"pid\":1,\"tid\":"
+                << (e.gpu ? GPU_TRACK : buf->tid)
+                << ",\"ts\":"  << toUs(e.begin)
+                << ",\"dur\":" << (e.end - e.begin) * 1e-3 << "}";
+        }
+    }
+
+    out << "\n]}" << std::endl;
+
+    out.flags(oldFlags);
+    out.precision(oldPrecision);
+}
+
+AGZ_VULKAN_LAB_END
@@ -0,0 +1,386 @@
+#include <algorithm>
+#include <iomanip>
+
+#include <agz/vlab/profile/cpuTracer.h>
+#include <agz/vlab/profile/gpuProfiler.h>
+#include <agz/vlab/window/debugUtils.h>
+
+AGZ_VULKAN_LAB_BEGIN
+
+namespace
+{
+    void writeJSONString(std::ostream &out, const std::string &str)
+    {
+        out << '"';
+        for(char c : str)
+        {
+            if(c == '"' || c == '\\')
+                out << '\\' << c;
+            else if(static_cast<unsigned char>(c) < 0x20)
+                out << ' ';
+            else
+                out << c;
+        }
+        out << '"';
+    }
+}
+
+GpuProfiler::GpuProfiler(
+    vk::PhysicalDevice     physicalDevice,
+    vk::Device             device,
+    uint32_t               queueFamilyIndex,
+    const GpuProfilerDesc &desc)
+    : desc_(desc), device_(device)
+{
+    assert(desc_.frameCount > 0 && desc_.maxScopesPerFrame > 0);
+
+    const auto families = physicalDevice.getQueueFamilyProperties();
+    assert(queueFamilyIndex < families.size());
+
+    const uint32_t validBits = families[queueFamilyIndex].timestampValidBits;
+    if(!validBits)
+        return;
+
+    available_       = true;
+    timestampPeriod_ = physicalDevice.getProperties().limits.timestampPeriod;
+    timestampMask_   = validBits >= 64 ? UINT64_MAX
+                                       : (uint64_t(1) << validBits) - 1;
+
+    // the functions are loaded only if VK_EXT_calibrated_timestamps is
+    // enabled. tracing is turned off otherwise
+
+    const auto &d = VULKAN_HPP_DEFAULT_DISPATCHER;
+    const bool calibratable =
+        d.vkGetPhysicalDeviceCalibrateableTimeDomainsEXT &&
+        d.vkGetCalibratedTimestampsEXT;
+
+    if(desc_.traceEvents && calibratable)
+    {
+        bool deviceDomain = false;
+        for(auto domain : physicalDevice.getCalibrateableTimeDomainsEXT())
+        {
+            if(domain == vk::TimeDomainEXT::eDevice)
+                deviceDomain = true;
+#ifndef _WIN32
+            // steady_clock is CLOCK_MONOTONIC in libstdc++ and libc++
+            else if(domain == vk::TimeDomainEXT::eClockMonotonic)
+                hostClockMonotonic_ = true;
+#endif
+        }
+        traceEvents_ = deviceDomain;
+    }
+
+    vk::QueryPoolCreateInfo poolInfo;
+    poolInfo
+        .setQueryType(vk::QueryType::eTimestamp)
+        .setQueryCount(2 * desc_.maxScopesPerFrame);
+
+    frames_.resize(desc_.frameCount);
+    for(size_t i = 0; i < frames_.size(); ++i)
+    {
+        auto &f = frames_[i];
+        f.pool = device_.createQueryPoolUnique(poolInfo);
+        f.scopes.reserve(desc_.maxScopesPerFrame);
+
+        setDebugName(
+            device_, f.pool.get(), "timestamp queries " + std::to_string(i));
+    }
+
+    // (value, availability) for each query
+    queryResults_.resize(4 * desc_.maxScopesPerFrame);
+}
+
+GpuProfiler::~GpuProfiler()
+{
+    frames_.clear();
+}
+
+void GpuProfiler::beginFrame(uint32_t frameIndex)
+{
+    if(!available_)
+        return;
+
+    assert(frameIndex < frames_.size());
+    auto &frame = frames_[frameIndex];
+
+    collect(frame);
+
+    frame.frame   = ++frameNumber_;
+    frame.reset   = false;
+    frame.pending = false;
+    frame.scopes.clear();
+
+    currentFrame_ = &frame;
+}
+
+void GpuProfiler::resetQueries(
+    vk::CommandBuffer cmd, const vk::DispatchLoaderDynamic &dispatch)
+{
+    if(!available_)
+        return;
+
+    assert(currentFrame_);
+
+    cmd.resetQueryPool(
+        currentFrame_->pool.get(), 0, 2 * desc_.maxScopesPerFrame, dispatch);
+    currentFrame_->reset = true;
+}
+
+GpuProfiler::ScopeID GpuProfiler::beginScope(
+    vk::CommandBuffer                cmd,
+    const char                      *name,
+    const vk::DispatchLoaderDynamic &dispatch)
+{
+    if(!available_)
+        return INVALID_SCOPE;
+
+    assert(currentFrame_ && currentFrame_->reset);
+
+    auto &scopes = currentFrame_->scopes;
+    if(scopes.size() >= desc_.maxScopesPerFrame)
+        return INVALID_SCOPE;
+
+    const auto id = static_cast<ScopeID>(scopes.size());
+    scopes.push_back({ name, false });
+
+    cmd.writeTimestamp(
+        vk::PipelineStageFlagBits::eTopOfPipe,
+        currentFrame_->pool.get(), 2 * id, dispatch);
+
+    currentFrame_->pending = true;
+    return id;
+}
+
+void GpuProfiler::endScope(
+    vk::CommandBuffer                cmd,
+    ScopeID                          scope,
+    const vk::DispatchLoaderDynamic &dispatch)
+{
+    if(scope == INVALID_SCOPE)
+        return;
+
+    assert(currentFrame_ && scope < currentFrame_->scopes.size());
+
+    cmd.writeTimestamp(
+        vk::PipelineStageFlagBits::eBottomOfPipe,
+        currentFrame_->pool.get(), 2 * scope + 1, dispatch);
+
+    currentFrame_->scopes[scope].ended = true;
+}
+
+std::vector<std::string> GpuProfiler::getScopeNames() const
+{
+    std::vector<std::string> ret;
+    for(auto &p : history_)
+        ret.push_back(p.first);
+    return ret;
+}
+
+const std::deque<GpuProfiler::Sample> *GpuProfiler::getHistory(
+    const std::string &name) const
+{
+    const auto it = history_.find(name);
+    return it != history_.end() ? &it->second : nullptr;
+}
+
+GpuProfiler::ScopeStats GpuProfiler::getStats(const std::string &name) const
+{
+    ScopeStats ret;
+    ret.name = name;
+
+    const auto history = getHistory(name);
+    if(!history || history->empty())
+        return ret;
+
+    ret.last        = history->back().ms;
+    ret.min         = history->front().ms;
+    ret.max         = history->front().ms;
+    ret.sampleCount = static_cast<uint32_t>(history->size());
+
+    double sum = 0;
+    for(auto &s : *history)
+    {
+        ret.min = (std::min)(ret.min, s.ms);
+        ret.max = (std::max)(ret.max, s.ms);
+        sum += s.ms;
+    }
+    ret.avg = static_cast<float>(sum / history->size());
+
+    return ret;
+}
+
+std::vector<GpuProfiler::ScopeStats> GpuProfiler::getAllStats() const
+{
+    std::vector<ScopeStats> ret;
+    for(auto &p : history_)
+        ret.push_back(getStats(p.first));
+    return ret;
+}
+
+float GpuProfiler::getLastTime(const std::string &name) const
+{
+    const auto history = getHistory(name);
+    return history && !history->empty() ? history->back().ms : 0.0f;
+}
+
+void GpuProfiler::exportCSV(std::ostream &out) const
+{
+    const auto oldFlags     = out.flags();
+    const auto oldPrecision = out.precision();
+
+    out << "frame,scope,ms" << std::endl;
+    out << std::fixed << std::setprecision(4);
+
+    for(auto &p : history_)
+    {
+        // quote names since they may contain commas
+        std::string name = p.first;
+        for(size_t i = 0; (i = name.find('"', i)) != std::string::npos; i += 2)
+            name.insert(i, 1, '"');
+
+        for(auto &s : p.second)
+            out << s.frame << ",\"" << name << "\"," << s.ms << "\n";
+    }
+
+    out.flush();
+    out.flags(oldFlags);
+    out.precision(oldPrecision);
+}
+
+void GpuProfiler::exportJSON(std::ostream &out) const
+{
+    const auto oldFlags     = out.flags();
+    const auto oldPrecision = out.precision();
+
+    out << std::fixed << std::setprecision(4);
+    out << "{\n  \"scopes\": [";
+
+    bool firstScope = true;
+    for(auto &p : history_)
+    {
+        out << (firstScope ? "\n" : ",\n") << "    { \"name\": ";
+        writeJSONString(out, p.first);
+        firstScope = false;
+
+        out << ", \"frames\": [";
+        for(size_t i = 0; i < p.second.size(); ++i)
+            out << (i ? ", " : "") << p.second[i].frame;
+
+        out << "], \"ms\": [";
+        for(size_t i = 0; i < p.second.size(); ++i)
+            out << (i ? ", " : "") << p.second[i].ms;
+
+        out << "] }";
+    }
+
+    out << "\n  ]\n}" << std::endl;
+
+    out.flags(oldFlags);
+    out.precision(oldPrecision);
+}
+
+void GpuProfiler::clearHistory()
+{
+    history_.clear();
+}
+
+void GpuProfiler::collect(Frame &frame)
+{
+    if(!frame.pending)
+        return;
+
+    const auto queryCount = static_cast<uint32_t>(2 * frame.scopes.size());
+
+    // the submission is complete, so this doesn't wait. queries of a
+    // submission that never happened are reported as unavailable
+    const vk::Result result = device_.getQueryPoolResults(
+        frame.pool.get(), 0, queryCount,
+        queryCount * 2 * sizeof(uint64_t), queryResults_.data(),
+        2 * sizeof(uint64_t),
+        vk::QueryResultFlagBits::e64 |
+        vk::QueryResultFlagBits::eWithAvailability);
+
+    if(result != vk::Result::eSuccess && result != vk::Result::eNotReady)
+        return;
+
+    // convert to the cpu clock for tracing
+
+    uint64_t gpuBase = 0, hostBase = 0;
+    const bool trace = traceEvents_ && CpuTracer::isEnabled() &&
+                       calibrate(gpuBase, hostBase);
+
+    auto toHostNs = [&](uint64_t ticks)
+    {
+        // signed distance from gpuBase within the valid bits
+        const uint64_t diff = (ticks - gpuBase) & timestampMask_;
+        const double signedDiff = diff > timestampMask_ / 2 ?
+            -static_cast<double>((gpuBase - ticks) & timestampMask_) :
+             static_cast<double>(diff);
+        return static_cast<uint64_t>(
+            static_cast<double>(hostBase) + signedDiff * timestampPeriod_);
+    };
+
+    // sum scopes with the same name
+
+    std::map<std::string, float> frameTimes;
+    for(size_t i = 0; i < frame.scopes.size(); ++i)
+    {
+        if(!frame.scopes[i].ended)
+            continue;
+
+        const uint64_t *begin = &queryResults_[4 * i];
+        const uint64_t *end   = &queryResults_[4 * i + 2];
+        if(!begin[1] || !end[1])
+            continue;
+
+        const uint64_t ticks = (end[0] - begin[0]) & timestampMask_;
+        frameTimes[frame.scopes[i].name] +=
+            static_cast<float>(ticks * timestampPeriod_ * 1e-6);
+
+        if(trace)
+        {
+            CpuTracer::addGpuEvent(
+                CpuTracer::internName(frame.scopes[i].name),
+                toHostNs(begin[0]), toHostNs(end[0]));
+        }
+    }
+
+    for(auto &p : frameTimes)
+    {
+        auto &history = history_[p.first];
+        history.push_back({ frame.frame, p.second });
+        while(history.size() > desc_.historySize)
+            history.pop_front();
+    }
+}
+
+bool GpuProfiler::calibrate(uint64_t &gpuTicks, uint64_t &hostNs) const
+{
+    const vk::CalibratedTimestampInfoEXT infos[] = {
+        { vk::TimeDomainEXT::eDevice },
+        { vk::TimeDomainEXT::eClockMonotonic }
+    };
+
+    const uint32_t count = hostClockMonotonic_ ? 2 : 1;
+
+    uint64_t timestamps[2] = { 0, 0 };
+    uint64_t maxDeviation  = 0;
+
+    // without a host domain matching steady_clock, the device timestamp is
+    // assumed to be taken halfway through the call
+
+    const uint64_t before = CpuTracer::now();
+    const vk::Result result = device_.getCalibratedTimestampsEXT(
+        count, infos, timestamps, &maxDeviation);
+    const uint64_t after = CpuTracer::now();
+
+    if(result != vk::Result::eSuccess)
+        return false;
+
+    gpuTicks = timestamps[0];
+    hostNs   = hostClockMonotonic_ ? timestamps[1]
+                                   : before + (after - before) / 2;
+    return true;
+}
+
+AGZ_VULKAN_LAB_END
@@ -0,0 +1,268 @@
+#include <iomanip>
+
+#include <agz/vlab/profile/pipelineStatistics.h>
+#include <agz/vlab/window/debugUtils.h>
+
+AGZ_VULKAN_LAB_BEGIN
+
+namespace
+{
+    // results are written in the order of these bits
+    const vk::QueryPipelineStatisticFlags STATISTIC_FLAGS =
+        vk::QueryPipelineStatisticFlagBits::eVertexShaderInvocations |
+        vk::QueryPipelineStatisticFlagBits::eClippingInvocations     |
+        vk::QueryPipelineStatisticFlagBits::eClippingPrimitives      |
+        vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations;
+
+    constexpr uint32_t STATISTIC_COUNT = 4;
+
+    // with the availability value
+    constexpr uint32_t STATS_STRIDE     = STATISTIC_COUNT + 1;
+    constexpr uint32_t OCCLUSION_STRIDE = 2;
+}
+
+PipelineStatsProfiler::PipelineStatsProfiler(
+    vk::Device device, const PipelineStatsDesc &desc)
+    : desc_(desc), device_(device)
+{
+    assert(desc_.frameCount > 0 && desc_.maxScopesPerFrame > 0);
+
+    vk::QueryPoolCreateInfo statsInfo;
+    statsInfo
+        .setQueryType(vk::QueryType::ePipelineStatistics)
+        .setQueryCount(desc_.maxScopesPerFrame)
+        .setPipelineStatistics(STATISTIC_FLAGS);
+
+    vk::QueryPoolCreateInfo occlusionInfo;
+    occlusionInfo
+        .setQueryType(vk::QueryType::eOcclusion)
+        .setQueryCount(desc_.maxScopesPerFrame);
+
+    frames_.resize(desc_.frameCount);
+    for(size_t i = 0; i < frames_.size(); ++i)
+    {
+        auto &f = frames_[i];
+        f.statsPool = device_.createQueryPoolUnique(statsInfo);
+        if(desc_.occlusion)
+            f.occlusionPool = device_.createQueryPoolUnique(occlusionInfo);
+        f.scopes.reserve(desc_.maxScopesPerFrame);
+
+        if(isDebugUtilsEnabled())
+        {
+            const std::string index = std::to_string(i);
+            setDebugName(
+                device_, f.statsPool.get(), "pipeline stats queries " + index);
+            setDebugName(
+                device_, f.occlusionPool.get(), "occlusion queries " + index);
+        }
+    }
+
+    queryResults_.resize(STATS_STRIDE * desc_.maxScopesPerFrame);
+}
+
+PipelineStatsProfiler::~PipelineStatsProfiler()
+{
+    frames_.clear();
+}
+
+void PipelineStatsProfiler::beginFrame(uint32_t frameIndex)
+{
+    assert(frameIndex < frames_.size());
+    auto &frame = frames_[frameIndex];
+
+    collect(frame);
+
+    frame.reset   = false;
+    frame.pending = false;
+    frame.scopes.clear();
+
+    currentFrame_ = &frame;
+}
+
+void PipelineStatsProfiler::resetQueries(
+    vk::CommandBuffer cmd, const vk::DispatchLoaderDynamic &dispatch)
+{
+    assert(currentFrame_);
+
+    cmd.resetQueryPool(
+        currentFrame_->statsPool.get(), 0, desc_.maxScopesPerFrame, dispatch);
+    if(desc_.occlusion)
+    {
+        cmd.resetQueryPool(
+            currentFrame_->occlusionPool.get(), 0, desc_.maxScopesPerFrame,
+            dispatch);
+    }
+
+    currentFrame_->reset = true;
+}
+
+PipelineStatsProfiler::ScopeID PipelineStatsProfiler::beginScope(
+    vk::CommandBuffer                cmd,
+    const char                      *name,
+    const vk::DispatchLoaderDynamic &dispatch)
+{
+    assert(currentFrame_ && currentFrame_->reset);
+
+    auto &scopes = currentFrame_->scopes;
+    if(scopes.size() >= desc_.maxScopesPerFrame)
+        return INVALID_SCOPE;
+
+    const auto id = static_cast<ScopeID>(scopes.size());
+    scopes.push_back({ name, false });
+
+    cmd.beginQuery(currentFrame_->statsPool.get(), id, {}, dispatch);
+    if(desc_.occlusion)
+    {
+        vk::QueryControlFlags flags;
+        if(desc_.preciseOcclusion)
+            flags |= vk::QueryControlFlagBits::ePrecise;
+        cmd.beginQuery(
+            currentFrame_->occlusionPool.get(), id, flags, dispatch);
+    }
+
+    currentFrame_->pending = true;
+    return id;
+}
+
+void PipelineStatsProfiler::endScope(
+    vk::CommandBuffer                cmd,
+    ScopeID                          scope,
+    const vk::DispatchLoaderDynamic &dispatch)
+{
+    if(scope == INVALID_SCOPE)
+        return;
+
+    assert(currentFrame_ && scope < currentFrame_->scopes.size());
+
+    if(desc_.occlusion)
+        cmd.endQuery(currentFrame_->occlusionPool.get(), scope, dispatch);
+    cmd.endQuery(currentFrame_->statsPool.get(), scope, dispatch);
+
+    currentFrame_->scopes[scope].ended = true;
+}
+
+PipelineStats PipelineStatsProfiler::getLastFrame(
+    const std::string &name) const
+{
+    const auto it = lastFrame_.find(name);
+    return it != lastFrame_.end() ? it->second : PipelineStats{};
+}
+
+void PipelineStatsProfiler::resetAccumulated()
+{
+    accumulated_.clear();
+}
+
+void PipelineStatsProfiler::printAverages(std::ostream &out) const
+{
+    const auto oldFlags     = out.flags();
+    const auto oldPrecision = out.precision();
+
+    out << std::fixed << std::setprecision(0);
+
+    for(auto &[name, acc] : accumulated_)
+    {
+        if(!acc.frameCount)
+            continue;
+
+        const double n = static_cast<double>(acc.frameCount);
+
+        out << name
+            << ": vs = "        << acc.sum.vertexInvocations   / n
+            << ", clip in = "   << acc.sum.clippingInvocations / n
+            << ", clip out = "  << acc.sum.clippingPrimitives  / n
+            << ", fs = "        << acc.sum.fragmentInvocations / n;
+
+        if(desc_.occlusion)
+        {
+            out << ", samples = " << acc.sum.samplesPassed / n;
+
+            // fragment shader invocations per visible sample
+            if(desc_.preciseOcclusion && acc.sum.samplesPassed)
+            {
+                out << std::setprecision(2) << ", overdraw = "
+                    << static_cast<double>(acc.sum.fragmentInvocations)
+                     / acc.sum.samplesPassed
+                    << std::setprecision(0);
+            }
+        }
+
+        out << " (" << acc.frameCount << " frames)" << std::endl;
+    }
+
+    out.flags(oldFlags);
+    out.precision(oldPrecision);
+}
+
+void PipelineStatsProfiler::collect(Frame &frame)
+{
+    if(!frame.pending)
+        return;
+
+    const auto queryCount = static_cast<uint32_t>(frame.scopes.size());
+    const auto flags = vk::QueryResultFlagBits::e64 |
+                       vk::QueryResultFlagBits::eWithAvailability;
+
+    std::vector<PipelineStats> stats(queryCount);
+    std::vector<bool>          available(queryCount, false);
+
+    // the submission is complete, so these don't wait
+
+    vk::Result result = device_.getQueryPoolResults(
+        frame.statsPool.get(), 0, queryCount,
+        queryCount * STATS_STRIDE * sizeof(uint64_t), queryResults_.data(),
+        STATS_STRIDE * sizeof(uint64_t), flags);
+    if(result != vk::Result::eSuccess && result != vk::Result::eNotReady)
+        return;
+
+    for(uint32_t i = 0; i < queryCount; ++i)
+    {
+        const uint64_t *r = &queryResults_[STATS_STRIDE * i];
+        if(!frame.scopes[i].ended || !r[STATISTIC_COUNT])
+            continue;
+
+        stats[i].vertexInvocations   = r[0];
+        stats[i].clippingInvocations = r[1];
+        stats[i].clippingPrimitives  = r[2];
+        stats[i].fragmentInvocations = r[3];
+        available[i] = true;
+    }
+
+    if(desc_.occlusion)
+    {
+        result = device_.getQueryPoolResults(
+            frame.occlusionPool.get(), 0, queryCount,
+            queryCount * OCCLUSION_STRIDE * sizeof(uint64_t),
+            queryResults_.data(), OCCLUSION_STRIDE * sizeof(uint64_t), flags);
+
+        if(result == vk::Result::eSuccess || result == vk::Result::eNotReady)
+        {
+            for(uint32_t i = 0; i < queryCount; ++i)
+            {
+                const uint64_t *r = &queryResults_[OCCLUSION_STRIDE * i];
+                if(r[1])
+                    stats[i].samplesPassed = r[0];
+            }
+        }
+    }
+
+    // aggregate by name
+
+    std::map<std::string, PipelineStats> frameStats;
+    for(uint32_t i = 0; i < queryCount; ++i)
+    {
+        if(available[i])
+            frameStats[frame.scopes[i].name] += stats[i];
+    }
+
+    for(auto &[name, s] : frameStats)
+    {
+        lastFrame_[name] = s;
+
+        auto &acc = accumulated_[name];
+        acc.sum += s;
+        ++acc.frameCount;
+    }
+}
+
+AGZ_VULKAN_LAB_END
@@ -0,0 +1,318 @@
+#include <agz/vlab/profile/cpuTracer.h>
+#include <agz/vlab/sync/frameScheduler.h>
+#include <agz/vlab/window/debugUtils.h>
+
+AGZ_VULKAN_LAB_BEGIN
+
+FrameScheduler::FrameScheduler(vk::Device device, uint32_t framesInFlight)
+    : device_(device), framesInFlight_(framesInFlight)
+{
+    assert(framesInFlight > 0);
+}
+
+FrameScheduler::~FrameScheduler()
+{
+    waitIdle();
+}
+
+void FrameScheduler::setFramesInFlight(uint32_t framesInFlight)
+{
+    assert(framesInFlight > 0);
+    if(framesInFlight == framesInFlight_)
+        return;
+
+    waitFrame(currentFrame_);
+    collect();
+
+    framesInFlight_ = framesInFlight;
+}
+
+void FrameScheduler::beginFrame()
+{
+    if(currentFrame_ > framesInFlight_)
+        waitFrame(currentFrame_ - framesInFlight_);
+
+    collect();
+}
+
+void FrameScheduler::endFrame()
+{
+    ++currentFrame_;
+}
+
+TimelinePoint FrameScheduler::submit(
+    vk::Queue                           queue,
+    const vk::SubmitInfo               &info,
+    const std::vector<QueueDependency> &deps,
+    vk::Fence                           fence)
+{
+    auto &timeline = getQueueTimeline(queue);
+
+    // wait operations
+
+    std::vector<vk::Semaphore> waitSemaphores(
+        info.pWaitSemaphores, info.pWaitSemaphores + info.waitSemaphoreCount);
+    std::vector<vk::PipelineStageFlags> waitStages(
+        info.pWaitDstStageMask,
+        info.pWaitDstStageMask + info.waitSemaphoreCount);
+    std::vector<uint64_t> waitValues(info.waitSemaphoreCount, 0);
+
+    for(auto &d : deps)
+    {
+        if(d.queue == queue)
+            continue;
+
+        auto &depTimeline = getQueueTimeline(d.queue);
+        if(!depTimeline.lastValue)
+            continue;
+
+        waitSemaphores.push_back(depTimeline.semaphore.get());
+        waitStages.push_back(d.stages);
+        waitValues.push_back(depTimeline.lastValue);
+    }
+
+    // signal operations
+
+    std::vector<vk::Semaphore> signalSemaphores(
+        info.pSignalSemaphores,
+        info.pSignalSemaphores + info.signalSemaphoreCount);
+    std::vector<uint64_t> signalValues(info.signalSemaphoreCount, 0);
+
+    const uint64_t value = timeline.lastValue + 1;
+    signalSemaphores.push_back(timeline.semaphore.get());
+    signalValues.push_back(value);
+
+    // submit
+
+    vk::TimelineSemaphoreSubmitInfo timelineInfo;
+    timelineInfo
+        .setWaitSemaphoreValueCount(static_cast<uint32_t>(waitValues.size()))
+        .setPWaitSemaphoreValues(waitValues.data())
+        .setSignalSemaphoreValueCount(
+            static_cast<uint32_t>(signalValues.size()))
+        .setPSignalSemaphoreValues(signalValues.data());
+    timelineInfo.pNext = info.pNext;
+
+    vk::SubmitInfo submitInfo = info;
+    submitInfo
+        .setPNext(&timelineInfo)
+        .setWaitSemaphoreCount(static_cast<uint32_t>(waitSemaphores.size()))
+        .setPWaitSemaphores(waitSemaphores.data())
+        .setPWaitDstStageMask(waitStages.data())
+        .setSignalSemaphoreCount(
+            static_cast<uint32_t>(signalSemaphores.size()))
+        .setPSignalSemaphores(signalSemaphores.data());
+
+    (void)queue.submit(1, &submitInfo, fence);
+
+    timeline.lastValue = value;
+    if(!timeline.pending.empty() &&
+        timeline.pending.back().first == currentFrame_)
+        timeline.pending.back().second = value;
+    else
+        timeline.pending.push_back({ currentFrame_, value });
+
+    return { queue, value };
+}
+
+bool FrameScheduler::isFrameComplete(uint64_t frame) const
+{
+    for(auto &t : timelines_)
+    {
+        if(t->pending.empty() || t->pending.front().first > frame)
+            continue;
+
+        const uint64_t counter =
+            device_.getSemaphoreCounterValue(t->semaphore.get());
+
+        while(!t->pending.empty() && t->pending.front().second <= counter)
+            t->pending.pop_front();
+
+        if(!t->pending.empty() && t->pending.front().first <= frame)
+            return false;
+    }
+
+    return true;
+}
+
+bool FrameScheduler::isComplete(const TimelinePoint &point) const
+{
+    auto timeline = findQueueTimeline(point.queue);
+    if(!timeline)
+        return true;
+
+    return device_.getSemaphoreCounterValue(timeline->semaphore.get())
+        >= point.value;
+}
+
+void FrameScheduler::waitFrame(uint64_t frame)
+{
+    std::vector<vk::Semaphore> semaphores;
+    std::vector<uint64_t>      values;
+
+    for(auto &t : timelines_)
+    {
+        uint64_t value = 0;
+        for(auto &p : t->pending)
+        {
+            if(p.first > frame)
+                break;
+            value = p.second;
+        }
+
+        if(value)
+        {
+            semaphores.push_back(t->semaphore.get());
+            values.push_back(value);
+        }
+    }
+
+    if(semaphores.empty())
+        return;
+
+    vk::SemaphoreWaitInfo waitInfo;
+    waitInfo
+        .setSemaphoreCount(static_cast<uint32_t>(semaphores.size()))
+        .setPSemaphores(semaphores.data())
+        .setPValues(values.data());
+
+    {
+        AGZ_VLAB_TRACE_SCOPE("wait frame");
+        (void)device_.waitSemaphores(waitInfo, UINT64_MAX);
+    }
+
+    for(auto &t : timelines_)
+    {
+        while(!t->pending.empty() && t->pending.front().first <= frame)
+            t->pending.pop_front();
+    }
+}
+
+void FrameScheduler::wait(const TimelinePoint &point)
+{
+    auto timeline = findQueueTimeline(point.queue);
+    if(!timeline || !point.value)
+        return;
+
+    vk::Semaphore semaphore = timeline->semaphore.get();
+
+    vk::SemaphoreWaitInfo waitInfo;
+    waitInfo
+        .setSemaphoreCount(1)
+        .setPSemaphores(&semaphore)
+        .setPValues(&point.value);
+
+    (void)device_.waitSemaphores(waitInfo, UINT64_MAX);
+}
+
+void FrameScheduler::waitIdle()
+{
+    waitFrame(currentFrame_);
+
+    auto tasks = std::move(deferredTasks_);
+    deferredTasks_.clear();
+
+    for(auto &t : tasks)
+        t.func();
+}
+
+void FrameScheduler::defer(std::function<void()> func)
+{
+    DeferredTask task;
+    task.frame = currentFrame_;
+    task.func  = std::move(func);
+    deferredTasks_.push_back(std::move(task));
+}
+
+void FrameScheduler::deferUntil(
+    const TimelinePoint &point, std::function<void()> func)
+{
+    DeferredTask task;
+    task.point = point;
+    task.func  = std::move(func);
+    deferredTasks_.push_back(std::move(task));
+}
+
+void FrameScheduler::collect()
+{
+    if(deferredTasks_.empty())
+        return;
+
+    // tasks may defer new tasks
+
+    std::vector<DeferredTask> tasks = std::move(deferredTasks_);
+    deferredTasks_.clear();
+
+    std::vector<DeferredTask> remaining;
+    for(auto &t : tasks)
+    {
+        if(isTaskReady(t))
+            t.func();
+        else
+            remaining.push_back(std::move(t));
+    }
+
+    for(auto &t : deferredTasks_)
+        remaining.push_back(std::move(t));
+    deferredTasks_ = std::move(remaining);
+}
+
+vk::Semaphore FrameScheduler::getTimeline(vk::Queue queue)
+{
+    return getQueueTimeline(queue).semaphore.get();
+}
+
+uint64_t FrameScheduler::getLastSubmittedValue(vk::Queue queue)
+{
+    return getQueueTimeline(queue).lastValue;
+}
+
+FrameScheduler::QueueTimeline &FrameScheduler::getQueueTimeline(
+    vk::Queue queue)
+{
+    for(auto &t : timelines_)
+    {
+        if(t->queue == queue)
+            return *t;
+    }
+
+    vk::SemaphoreTypeCreateInfo typeInfo;
+    typeInfo
+        .setSemaphoreType(vk::SemaphoreType::eTimeline)
+        .setInitialValue(0);
+
+    vk::SemaphoreCreateInfo createInfo;
+    createInfo.setPNext(&typeInfo);
+
+    auto timeline = std::make_unique<QueueTimeline>();
+    timeline->queue     = queue;
+    timeline->semaphore = device_.createSemaphoreUnique(createInfo);
+
+    setDebugName(
+        device_, timeline->semaphore.get(),
+        "timeline " + std::to_string(timelines_.size()));
+
+    timelines_.push_back(std::move(timeline));
+    return *timelines_.back();
+}
+
+const FrameScheduler::QueueTimeline *FrameScheduler::findQueueTimeline(
+    vk::Queue queue) const noexcept
+{
+    for(auto &t : timelines_)
+    {
+        if(t->queue == queue)
+            return t.get();
+    }
+    return nullptr;
+}
+
+bool FrameScheduler::isTaskReady(const DeferredTask &task) const
+{
+    // tasks deferred in current frame wait for its submissions
+    if(task.frame)
+        return task.frame < currentFrame_ && isFrameComplete(task.frame);
+    return isComplete(task.point);
+}
+
+AGZ_VULKAN_LAB_END
@@ -0,0 +1,494 @@
+#include <agz/vlab/sync/resourceStateTracker.h>
+#include <agz/vlab/window/graphicsDevice.h>
+
+AGZ_VULKAN_LAB_BEGIN
+
+namespace
+{
+    bool operator==(
+        const ResourceTransition &a, const ResourceTransition &b) noexcept
+    {
+        return a.srcStages     == b.srcStages &&
+               a.dstStages     == b.dstStages &&
+               a.srcAccess     == b.srcAccess &&
+               a.dstAccess     == b.dstAccess &&
+               a.oldLayout     == b.oldLayout &&
+               a.newLayout     == b.newLayout &&
+               a.memoryBarrier == b.memoryBarrier;
+    }
+
+#ifdef VK_KHR_synchronization2
+
+    vk::PipelineStageFlags2KHR toStage2(vk::PipelineStageFlags stages) noexcept
+    {
+        return vk::PipelineStageFlags2KHR(static_cast<VkPipelineStageFlags2KHR>(
+            static_cast<VkPipelineStageFlags>(stages)));
+    }
+
+    vk::AccessFlags2KHR toAccess2(vk::AccessFlags access) noexcept
+    {
+        return vk::AccessFlags2KHR(static_cast<VkAccessFlags2KHR>(
+            static_cast<VkAccessFlags>(access)));
+    }
+
+#endif
+}
+
+bool isWriteAccess(vk::AccessFlags access) noexcept
+{
+    const vk::AccessFlags writeMask =
+        vk::AccessFlagBits::eShaderWrite                 |
+        vk::AccessFlagBits::eColorAttachmentWrite        |
+        vk::AccessFlagBits::eDepthStencilAttachmentWrite |
+        vk::AccessFlagBits::eTransferWrite               |
+        vk::AccessFlagBits::eHostWrite                   |
+        vk::AccessFlagBits::eMemoryWrite;
+    return static_cast<bool>(access & writeMask);
+}
+
+ResourceAccessState ResourceAccessState::fromState(
+    const ResourceState &state) noexcept
+{
+    ResourceAccessState ret;
+    ret.layout      = state.layout;
+    ret.writeStages = state.stages;
+    ret.writeAccess = isWriteAccess(state.access) ?
+                      state.access : vk::AccessFlags();
+    return ret;
+}
+
+bool ResourceAccessState::transition(
+    const ResourceState &next, bool discard, ResourceTransition &out)
+{
+    const bool layoutChange = next.layout != layout;
+    const bool write        = isWriteAccess(next.access);
+
+    out           = {};
+    out.dstStages = next.stages;
+    out.dstAccess = next.access;
+    out.newLayout = next.layout;
+
+    if(layoutChange || write)
+    {
+        const auto src = writeStages | readStages;
+        const bool needed = src || layoutChange;
+
+        if(needed)
+        {
+            out.srcStages = src ? src : vk::PipelineStageFlagBits::eTopOfPipe;
+            out.srcAccess = writeAccess;
+            out.oldLayout = (discard && layoutChange) ?
+                            vk::ImageLayout::eUndefined : layout;
+
+            // write-after-read only needs an execution dependency
+            out.memoryBarrier = layoutChange || writeAccess;
+        }
+
+        // a layout transition acts as a write completed before next.stages.
+        // later readers chain through these stages. the content written by
+        // 'next' itself is visible to no one until a later barrier
+
+        layout        = next.layout;
+        writeStages   = next.stages;
+        writeAccess   = write ? next.access : vk::AccessFlags();
+        readStages    = write ? vk::PipelineStageFlags() : next.stages;
+        visibleStages = write ? vk::PipelineStageFlags() : next.stages;
+        visibleAccess = write ? vk::AccessFlags()        : next.access;
+
+        return needed;
+    }
+
+    // read after read/write with unchanged layout
+
+    readStages |= next.stages;
+
+    const bool visible =
+        !(next.stages & ~visibleStages) && !(next.access & ~visibleAccess);
+    if(!writeStages || visible)
+        return false;
+
+    out.srcStages     = writeStages;
+    out.srcAccess     = writeAccess;
+    out.oldLayout     = layout;
+    out.memoryBarrier = true;
+
+    visibleStages |= next.stages;
+    visibleAccess |= next.access;
+
+    return true;
+}
+
+ResourceStateTracker::ResourceStateTracker(bool useSynchronization2)
+{
+#ifdef VK_KHR_synchronization2
+    useSync2_ = useSynchronization2;
+#else
+    useSync2_ = false;
+#endif
+}
+
+ResourceStateTracker::ResourceStateTracker(const GraphicsDevice &device)
+    : ResourceStateTracker(
+        device.isFeatureEnabled(DeviceFeature::Synchronization2))
+{
+
+}
+
+void ResourceStateTracker::trackImage(
+    vk::Image            image,
+    vk::ImageAspectFlags aspect,
+    uint32_t             mipLevels,
+    uint32_t             arrayLayers,
+    const ResourceState &initial)
+{
+    assert(mipLevels > 0 && arrayLayers > 0);
+
+    auto &rec = images_[static_cast<VkImage>(image)];
+    rec.aspect      = aspect;
+    rec.mipLevels   = mipLevels;
+    rec.arrayLayers = arrayLayers;
+    rec.states.assign(
+        mipLevels * arrayLayers, ResourceAccessState::fromState(initial));
+    rec.pending.assign(mipLevels * arrayLayers, -1);
+}
+
+void ResourceStateTracker::trackBuffer(
+    vk::Buffer buffer, const ResourceState &initial)
+{
+    auto &rec = buffers_[static_cast<VkBuffer>(buffer)];
+    rec.state   = ResourceAccessState::fromState(initial);
+    rec.pending = -1;
+}
+
+void ResourceStateTracker::untrackImage(vk::Image image)
+{
+    for(auto &b : imageBarriers_)
+    {
+        if(b.image == image)
+            b.image = nullptr;
+    }
+    images_.erase(static_cast<VkImage>(image));
+}
+
+void ResourceStateTracker::untrackBuffer(vk::Buffer buffer)
+{
+    for(auto &b : bufferBarriers_)
+    {
+        if(b.buffer == buffer)
+            b.buffer = nullptr;
+    }
+    buffers_.erase(static_cast<VkBuffer>(buffer));
+}
+
+void ResourceStateTracker::clear()
+{
+    images_.clear();
+    buffers_.clear();
+
+    execSrcStages_ = {};
+    execDstStages_ = {};
+
+    imageBarriers_.clear();
+    bufferBarriers_.clear();
+    pendingSubrscs_.clear();
+}
+
+void ResourceStateTracker::useImage(
+    vk::Image                        image,
+    const ResourceState             &next,
+    const vk::ImageSubresourceRange &range,
+    bool                             discard)
+{
+    const auto it = images_.find(static_cast<VkImage>(image));
+    if(it == images_.end())
+        throw std::runtime_error("resource state tracker: untracked image");
+    auto &rec = it->second;
+
+    uint32_t baseMip = 0, mipCount = rec.mipLevels;
+    uint32_t baseLayer = 0, layerCount = rec.arrayLayers;
+    if(range.levelCount)
+    {
+        baseMip   = range.baseMipLevel;
+        baseLayer = range.baseArrayLayer;
+        mipCount  = range.levelCount == VK_REMAINING_MIP_LEVELS ?
+                    rec.mipLevels - baseMip : range.levelCount;
+        layerCount = range.layerCount == VK_REMAINING_ARRAY_LAYERS ?
+                     rec.arrayLayers - baseLayer : range.layerCount;
+    }
+
+    assert(baseMip + mipCount <= rec.mipLevels);
+    assert(baseLayer + layerCount <= rec.arrayLayers);
+
+    const auto aspect = range.aspectMask ? range.aspectMask : rec.aspect;
+
+    for(uint32_t mip = baseMip; mip < baseMip + mipCount; ++mip)
+    {
+        for(uint32_t layer = baseLayer; layer < baseLayer + layerCount; ++layer)
+        {
+            const size_t idx = mip * rec.arrayLayers + layer;
+            ++statistics_.requestCount;
+
+            ResourceTransition t;
+            if(!rec.states[idx].transition(next, discard, t))
+            {
+                ++statistics_.droppedCount;
+                continue;
+            }
+
+            // no command can be recorded between barriers of the same batch,
+            // so repeated usages collapse into the pending barrier
+
+            if(rec.pending[idx] >= 0)
+            {
+                merge(imageBarriers_[rec.pending[idx]].transition, t);
+                ++statistics_.mergedCount;
+                continue;
+            }
+
+            if(!t.memoryBarrier)
+            {
+                execSrcStages_ |= t.srcStages;
+                execDstStages_ |= t.dstStages;
+                continue;
+            }
+
+            rec.pending[idx] = static_cast<int>(imageBarriers_.size());
+            imageBarriers_.push_back(
+                { image, { aspect, mip, 1, layer, 1 }, t });
+            pendingSubrscs_.push_back({ static_cast<VkImage>(image), idx });
+        }
+    }
+}
+
+void ResourceStateTracker::useBuffer(
+    vk::Buffer buffer, const ResourceState &next)
+{
+    const auto it = buffers_.find(static_cast<VkBuffer>(buffer));
+    if(it == buffers_.end())
+        throw std::runtime_error("resource state tracker: untracked buffer");
+    auto &rec = it->second;
+
+    ++statistics_.requestCount;
+
+    ResourceState bufferNext = next;
+    bufferNext.layout = vk::ImageLayout::eUndefined;
+
+    ResourceTransition t;
+    if(!rec.state.transition(bufferNext, false, t))
+    {
+        ++statistics_.droppedCount;
+        return;
+    }
+
+    if(rec.pending >= 0)
+    {
+        merge(bufferBarriers_[rec.pending].transition, t);
+        ++statistics_.mergedCount;
+        return;
+    }
+
+    if(!t.memoryBarrier)
+    {
+        execSrcStages_ |= t.srcStages;
+        execDstStages_ |= t.dstStages;
+        return;
+    }
+
+    rec.pending = static_cast<int>(bufferBarriers_.size());
+    bufferBarriers_.push_back({ buffer, t });
+}
+
+void ResourceStateTracker::flush(
+    vk::CommandBuffer cmdBuf, const vk::DispatchLoaderDynamic &dispatch)
+{
+    if(!hasPendingBarriers())
+        return;
+
+    // coalesce adjacent layers/mips with identical transitions
+
+    std::vector<PendingImageBarrier> imageBarriers;
+    for(auto &b : imageBarriers_)
+    {
+        if(!b.image)
+            continue;
+
+        if(!imageBarriers.empty())
+        {
+            auto &last = imageBarriers.back();
+            auto &lr = last.range;
+            auto &br = b.range;
+
+            if(last.image == b.image && last.transition == b.transition &&
+               lr.aspectMask == br.aspectMask)
+            {
+                if(lr.baseMipLevel == br.baseMipLevel && lr.levelCount == 1 &&
+                   lr.baseArrayLayer + lr.layerCount == br.baseArrayLayer)
+                {
+                    ++lr.layerCount;
+                    continue;
+                }
+
+                if(lr.baseArrayLayer == br.baseArrayLayer &&
+                   lr.layerCount == br.layerCount &&
+                   lr.baseMipLevel + lr.levelCount == br.baseMipLevel)
+                {
+                    ++lr.levelCount;
+                    continue;
+                }
+            }
+        }
+
+        imageBarriers.push_back(b);
+    }
+
+    std::vector<const PendingBufferBarrier *> bufferBarriers;
+    for(auto &b : bufferBarriers_)
+    {
+        if(b.buffer)
+            bufferBarriers.push_back(&b);
+    }
+
+#ifdef VK_KHR_synchronization2
+    if(useSync2_)
+    {
+        std::vector<vk::ImageMemoryBarrier2KHR>  image2;
+        std::vector<vk::BufferMemoryBarrier2KHR> buffer2;
+        vk::MemoryBarrier2KHR                    exec2;
+
+        for(auto &b : imageBarriers)
+        {
+            auto &t = b.transition;
+            image2.emplace_back();
+            image2.back()
+                .setSrcStageMask(toStage2(t.srcStages))
+                .setSrcAccessMask(toAccess2(t.srcAccess))
+                .setDstStageMask(toStage2(t.dstStages))
+                .setDstAccessMask(toAccess2(t.dstAccess))
+                .setOldLayout(t.oldLayout)
+                .setNewLayout(t.newLayout)
+                .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+                .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+                .setImage(b.image)
+                .setSubresourceRange(b.range);
+        }
+
+        for(auto b : bufferBarriers)
+        {
+            auto &t = b->transition;
+            buffer2.emplace_back();
+            buffer2.back()
+                .setSrcStageMask(toStage2(t.srcStages))
+                .setSrcAccessMask(toAccess2(t.srcAccess))
+                .setDstStageMask(toStage2(t.dstStages))
+                .setDstAccessMask(toAccess2(t.dstAccess))
+                .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+                .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+                .setBuffer(b->buffer)
+                .setOffset(0)
+                .setSize(VK_WHOLE_SIZE);
+        }
+
+        exec2
+            .setSrcStageMask(toStage2(execSrcStages_))
+            .setDstStageMask(toStage2(execDstStages_));
+
+        vk::DependencyInfoKHR dep;
+        dep
+            .setMemoryBarrierCount(execSrcStages_ ? 1 : 0)
+            .setPMemoryBarriers(&exec2)
+            .setBufferMemoryBarrierCount(static_cast<uint32_t>(buffer2.size()))
+            .setPBufferMemoryBarriers(buffer2.data())
+            .setImageMemoryBarrierCount(static_cast<uint32_t>(image2.size()))
+            .setPImageMemoryBarriers(image2.data());
+
+        cmdBuf.pipelineBarrier2KHR(dep, dispatch);
+    }
+    else
+#endif
+    {
+        vk::PipelineStageFlags srcStages = execSrcStages_;
+        vk::PipelineStageFlags dstStages = execDstStages_;
+
+        std::vector<vk::ImageMemoryBarrier>  image1;
+        std::vector<vk::BufferMemoryBarrier> buffer1;
+
+        for(auto &b : imageBarriers)
+        {
+            auto &t = b.transition;
+            srcStages |= t.srcStages;
+            dstStages |= t.dstStages;
+            image1.emplace_back(
+                t.srcAccess, t.dstAccess, t.oldLayout, t.newLayout,
+                VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+                b.image, b.range);
+        }
+
+        for(auto b : bufferBarriers)
+        {
+            auto &t = b->transition;
+            srcStages |= t.srcStages;
+            dstStages |= t.dstStages;
+            buffer1.emplace_back(
+                t.srcAccess, t.dstAccess,
+                VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+                b->buffer, 0, VK_WHOLE_SIZE);
+        }
+
+        cmdBuf.pipelineBarrier(
+            srcStages, dstStages, {}, 0, nullptr,
+            static_cast<uint32_t>(buffer1.size()), buffer1.data(),
+            static_cast<uint32_t>(image1.size()), image1.data(), dispatch);
+    }
+
+    statistics_.barrierCount += imageBarriers.size() + bufferBarriers.size();
+    ++statistics_.flushCount;
+
+    // reset pending records
+
+    for(auto &[image, idx] : pendingSubrscs_)
+    {
+        if(auto it = images_.find(image); it != images_.end())
+            it->second.pending[idx] = -1;
+    }
+
+    for(auto &b : bufferBarriers_)
+    {
+        if(auto it = buffers_.find(static_cast<VkBuffer>(b.buffer)); it != buffers_.end())
+            it->second.pending = -1;
+    }
+
+    execSrcStages_ = {};
+    execDstStages_ = {};
+
+    imageBarriers_.clear();
+    bufferBarriers_.clear();
+    pendingSubrscs_.clear();
+}
+
+ResourceState ResourceStateTracker::getImageState(
+    vk::Image image, uint32_t mipLevel, uint32_t arrayLayer) const
+{
+    const auto it = images_.find(static_cast<VkImage>(image));
+    if(it == images_.end())
+        throw std::runtime_error("resource state tracker: untracked image");
+
+    auto &rec = it->second;
+    auto &state = rec.states.at(mipLevel * rec.arrayLayers + arrayLayer);
+
+    ResourceState ret;
+    ret.layout = state.layout;
+    ret.stages = state.writeStages | state.readStages;
+    ret.access = state.writeAccess | state.visibleAccess;
+    return ret;
+}
+
+void ResourceStateTracker::merge(
+    ResourceTransition &dst, const ResourceTransition &src)
+{
+    dst.dstStages    |= src.dstStages;
+    dst.dstAccess    |= src.dstAccess;
+    dst.newLayout     = src.newLayout;
+    dst.memoryBarrier = true;
+}
+
+AGZ_VULKAN_LAB_END
@@ -0,0 +1,212 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+
+#include <agz/vlab/thread/taskGraph.h>
+
+AGZ_VULKAN_LAB_BEGIN
+
+TaskGraph::TaskID TaskGraph::addTask(
+    std::string                  name,
+    std::function<void()>        func,
+    const std::vector<TaskID>   &dependencies,
+    bool                         mainThread)
+{
+    const TaskID id = tasks_.size();
+
+    Task task;
+    task.name            = std::move(name);
+    task.func            = std::move(func);
+    task.dependencyCount = dependencies.size();
+    task.mainThread      = mainThread;
+
+    for(TaskID dep : dependencies)
+    {
+        assert(dep < id);
+        tasks_[dep].dependents.push_back(id);
+    }
+
+    tasks_.push_back(std::move(task));
+    return id;
+}
+
+void TaskGraph::run(uint32_t threadCount)
+{
+    using Clock = std::chrono::steady_clock;
+
+    if(!threadCount)
+        threadCount = (std::max)(1u, std::thread::hardware_concurrency());
+
+    const auto startTime = Clock::now();
+    auto toMs = [&](Clock::time_point t)
+    {
+        return std::chrono::duration<double, std::milli>(
+            t - startTime).count();
+    };
+
+    timings_.assign(tasks_.size(), {});
+    for(size_t i = 0; i < tasks_.size(); ++i)
+        timings_[i].name = tasks_[i].name;
+
+    // scheduling state, guarded by mutex
+
+    std::mutex              mutex;
+    std::condition_variable cond;
+
+    std::vector<size_t> remainingDeps(tasks_.size());
+    std::deque<TaskID>  readyTasks;
+    std::deque<TaskID>  readyMainTasks;
+    size_t              unfinishedCount = tasks_.size();
+    size_t              runningCount    = 0;
+    std::exception_ptr  exception;
+
+    for(size_t i = 0; i < tasks_.size(); ++i)
+    {
+        remainingDeps[i] = tasks_[i].dependencyCount;
+        if(!remainingDeps[i])
+            (tasks_[i].mainThread ? readyMainTasks : readyTasks).push_back(i);
+    }
+
+    auto done = [&]
+    {
+        return !unfinishedCount || (exception && !runningCount);
+    };
+
+    auto worker = [&](uint32_t threadIndex)
+    {
+        const bool isMain = threadIndex == 0;
+
+        std::unique_lock lk(mutex);
+        for(;;)
+        {
+            cond.wait(lk, [&]
+            {
+                return done() || (!exception &&
+                    (!readyTasks.empty() ||
+                     (isMain && !readyMainTasks.empty())));
+            });
+
+            if(done())
+                return;
+
+            // main thread tasks first since only one thread can run them
+
+            TaskID id;
+            if(isMain && !readyMainTasks.empty())
+            {
+                id = readyMainTasks.front();
+                readyMainTasks.pop_front();
+            }
+            else
+            {
+                id = readyTasks.front();
+                readyTasks.pop_front();
+            }
+
+            ++runningCount;
+            lk.unlock();
+
+            const auto taskStart = Clock::now();
+
+            std::exception_ptr taskException;
+            try
+            {
+                tasks_[id].func();
+            }
+            catch(...)
+            {
+                taskException = std::current_exception();
+            }
+
+            const auto taskEnd = Clock::now();
+
+            lk.lock();
+            --runningCount;
+
+            auto &timing = timings_[id];
+            timing.start    = toMs(taskStart);
+            timing.duration = toMs(taskEnd) - timing.start;
+            timing.thread   = threadIndex;
+
+            if(taskException)
+            {
+                if(!exception)
+                    exception = taskException;
+            }
+            else
+            {
+                --unfinishedCount;
+                for(TaskID dep : tasks_[id].dependents)
+                {
+                    if(!--remainingDeps[dep])
+                    {
+                        (tasks_[dep].mainThread ?
+                            readyMainTasks : readyTasks).push_back(dep);
+                    }
+                }
+            }
+
+            cond.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for(uint32_t i = 1; i < threadCount; ++i)
+        threads.emplace_back(worker, i);
+
+    worker(0);
+
+    for(auto &t : threads)
+        t.join();
+
+    totalTime_ = toMs(Clock::now());
+
+    if(exception)
+        std::rethrow_exception(exception);
+}
+
+void TaskGraph::printTimings(std::ostream &out) const
+{
+    constexpr int BAR_WIDTH = 40;
+
+    size_t nameWidth = 0;
+    for(auto &t : timings_)
+        nameWidth = (std::max)(nameWidth, t.name.size());
+
+    const double scale = totalTime_ > 0 ? BAR_WIDTH / totalTime_ : 0;
+
+    const auto oldFlags     = out.flags();
+    const auto oldPrecision = out.precision();
+
+    for(auto &t : timings_)
+    {
+        const int barBeg = static_cast<int>(t.start * scale);
+        const int barEnd = (std::max)(
+            barBeg + 1, static_cast<int>((t.start + t.duration) * scale));
+
+        std::string bar(BAR_WIDTH + 1, ' ');
+        for(int i = barBeg; i < barEnd && i <= BAR_WIDTH; ++i)
+            bar[i] = '#';
+
+        out << std::left  << std::setw(static_cast<int>(nameWidth))
+            << t.name
+            << std::right << std::fixed << std::setprecision(1)
+            << " start "  << std::setw(8) << t.start
+            << "ms, took " << std::setw(8) << t.duration
+            << "ms, thread " << t.thread
+            << " |" << bar << "|" << std::endl;
+    }
+
+    out << "total: " << std::fixed << std::setprecision(1)
+        << totalTime_ << "ms" << std::endl;
+
+    out.flags(oldFlags);
+    out.precision(oldPrecision);
+}
+
+AGZ_VULKAN_LAB_END
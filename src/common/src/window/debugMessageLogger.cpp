@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <chrono>
+
+#include <agz/vlab/window/debugMessageLogger.h>
+
+AGZ_VULKAN_LAB_BEGIN
+
+namespace
+{
+    uint64_t currentSecond() noexcept
+    {
+        using namespace std::chrono;
+        return static_cast<uint64_t>(duration_cast<seconds>(
+            steady_clock::now().time_since_epoch()).count());
+    }
+}
+
+DebugMessageLogger::DebugMessageLogger(
+    const DebugMessageLoggerDesc &desc, std::ostream &out)
+    : desc_(desc), out_(out), queue_(desc.queueCapacity)
+{
+    thread_ = std::thread(&DebugMessageLogger::loggerMain, this);
+}
+
+DebugMessageLogger::~DebugMessageLogger()
+{
+    exit_.store(true, std::memory_order_release);
+    thread_.join();
+}
+
+void DebugMessageLogger::log(const VkDebugUtilsMessengerCallbackDataEXT *data)
+{
+    if(isFiltered(data->messageIdNumber))
+        return;
+
+    Message msg;
+    msg.id     = data->messageIdNumber;
+    msg.second = currentSecond();
+    msg.text   = data->pMessage ? data->pMessage : "";
+
+    if(!queue_.tryPush(std::move(msg)))
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void DebugMessageLogger::loggerMain()
+{
+    constexpr auto MIN_SLEEP = std::chrono::milliseconds(1);
+    constexpr auto MAX_SLEEP = std::chrono::milliseconds(16);
+
+    auto sleep = MIN_SLEEP;
+
+    Message msg;
+    for(;;)
+    {
+        // read before draining so that messages logged before the
+        // destructor are all printed
+        const bool exit = exit_.load(std::memory_order_acquire);
+
+        bool printed = false;
+        while(queue_.tryPop(msg))
+        {
+            print(msg);
+            printed = true;
+        }
+
+        printed |= printDropped();
+
+        if(!printed)
+            printed = printExpired(currentSecond());
+
+        if(exit)
+            break;
+
+        if(printed)
+        {
+            out_.flush();
+            sleep = MIN_SLEEP;
+            continue;
+        }
+
+        // back off while idle
+        std::this_thread::sleep_for(sleep);
+        sleep = (std::min)(2 * sleep, MAX_SLEEP);
+    }
+
+    for(auto &[id, state] : idStates_)
+        printSuppressed(id, state);
+    out_.flush();
+}
+
+void DebugMessageLogger::print(const Message &msg)
+{
+    if(msg.id && desc_.maxPerIDPerSecond)
+    {
+        auto &state = idStates_[msg.id];
+
+        if(state.window != msg.second)
+        {
+            printSuppressed(msg.id, state);
+            state.window  = msg.second;
+            state.printed = 0;
+        }
+
+        if(state.printed >= desc_.maxPerIDPerSecond)
+        {
+            ++state.suppressed;
+            hasSuppressed_ = true;
+            return;
+        }
+
+        ++state.printed;
+    }
+
+    out_ << "validation layer: " << msg.text << "\n";
+}
+
+void DebugMessageLogger::printSuppressed(int32_t id, IDState &state)
+{
+    if(!state.suppressed)
+        return;
+
+    const auto oldFlags = out_.flags();
+    out_ << "validation layer: " << state.suppressed
+         << " more message(s) with id 0x" << std::hex
+         << static_cast<uint32_t>(id) << " suppressed\n";
+    out_.flags(oldFlags);
+
+    state.suppressed = 0;
+}
+
+bool DebugMessageLogger::printExpired(uint64_t second)
+{
+    if(!hasSuppressed_)
+        return false;
+
+    bool printed = false;
+    hasSuppressed_ = false;
+
+    for(auto &[id, state] : idStates_)
+    {
+        if(!state.suppressed)
+            continue;
+
+        if(state.window != second)
+        {
+            printSuppressed(id, state);
+            printed = true;
+        }
+        else
+            hasSuppressed_ = true;
+    }
+
+    return printed;
+}
+
+bool DebugMessageLogger::printDropped()
+{
+    const uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+    if(dropped == reportedDropped_)
+        return false;
+
+    out_ << "validation layer: " << dropped - reportedDropped_
+         << " message(s) dropped, logger queue is full\n";
+    reportedDropped_ = dropped;
+    return true;
+}
+
+AGZ_VULKAN_LAB_END
@@ -1,5 +1,3 @@
-#include <iostream>
-
 #include <agz/vlab/window/debugMessageManager.h>
 
 AGZ_VULKAN_LAB_BEGIN
@@ -18,9 +16,16 @@ namespace
     }
 }
 
-DebugMessageManager::DebugMessageManager(vk::Instance instance, Level level)
+DebugMessageManager::DebugMessageManager(
+    vk::Instance                        instance,
+    Level                               level,
+    std::shared_ptr<DebugMessageLogger> logger)
 {
-    instance_  = instance;
+    instance_ = instance;
+
+    logger_ = std::move(logger);
+    if(!logger_)
+        logger_ = std::make_shared<DebugMessageLogger>();
 
     const auto &info = _createInfo(level);
 
@@ -84,8 +89,9 @@ void DebugMessageManager::_message(const DebugMessage &msg)
 
 void DebugMessageManager::printToStdErrImpl(const DebugMessage &msg)
 {
+    // runs in the messenger callback. formatting is left to the logger
     if(shouldPrintToStdErr(msg.severity))
-        std::cerr << "validation layer: " << msg.data->pMessage << std::endl;
+        logger_->log(msg.data);
 }
 
 bool DebugMessageManager::shouldPrintToStdErr(
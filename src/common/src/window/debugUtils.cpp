@@ -0,0 +1,90 @@
+#include <agz/vlab/window/debugUtils.h>
+
+#ifndef AGZ_VLAB_DISABLE_DEBUG_UTILS
+
+AGZ_VULKAN_LAB_BEGIN
+
+namespace
+{
+    vk::DebugUtilsLabelEXT makeLabel(
+        const char *name, const DebugLabelColor &color) noexcept
+    {
+        vk::DebugUtilsLabelEXT label;
+        label
+            .setPLabelName(name)
+            .setColor(color);
+        return label;
+    }
+}
+
+bool isDebugUtilsEnabled() noexcept
+{
+    // not loaded unless the extension is enabled on the instance
+    return VULKAN_HPP_DEFAULT_DISPATCHER.vkSetDebugUtilsObjectNameEXT &&
+           VULKAN_HPP_DEFAULT_DISPATCHER.vkCmdBeginDebugUtilsLabelEXT;
+}
+
+void setDebugObjectName(
+    vk::Device device, vk::ObjectType type, uint64_t handle, const char *name,
+    const vk::DispatchLoaderDynamic &dispatch)
+{
+    if(!dispatch.vkSetDebugUtilsObjectNameEXT)
+        return;
+
+    vk::DebugUtilsObjectNameInfoEXT info;
+    info
+        .setObjectType(type)
+        .setObjectHandle(handle)
+        .setPObjectName(name);
+
+    (void)device.setDebugUtilsObjectNameEXT(&info, dispatch);
+}
+
+void beginDebugLabel(
+    vk::CommandBuffer cmd, const char *name, const DebugLabelColor &color,
+    const vk::DispatchLoaderDynamic &dispatch)
+{
+    if(!dispatch.vkCmdBeginDebugUtilsLabelEXT)
+        return;
+
+    const auto label = makeLabel(name, color);
+    cmd.beginDebugUtilsLabelEXT(&label, dispatch);
+}
+
+void endDebugLabel(
+    vk::CommandBuffer cmd, const vk::DispatchLoaderDynamic &dispatch)
+{
+    if(dispatch.vkCmdEndDebugUtilsLabelEXT)
+        cmd.endDebugUtilsLabelEXT(dispatch);
+}
+
+void insertDebugLabel(
+    vk::CommandBuffer cmd, const char *name, const DebugLabelColor &color,
+    const vk::DispatchLoaderDynamic &dispatch)
+{
+    if(!dispatch.vkCmdInsertDebugUtilsLabelEXT)
+        return;
+
+    const auto label = makeLabel(name, color);
+    cmd.insertDebugUtilsLabelEXT(&label, dispatch);
+}
+
+void beginDebugLabel(
+    vk::Queue queue, const char *name, const DebugLabelColor &color)
+{
+    if(!isDebugUtilsEnabled())
+        return;
+
+    const auto label = makeLabel(name, color);
+    queue.beginDebugUtilsLabelEXT(&label);
+}
+
+void endDebugLabel(vk::Queue queue)
+{
+    if(isDebugUtilsEnabled())
+        queue.endDebugUtilsLabelEXT();
+}
+
+AGZ_VULKAN_LAB_END
+
+#endif // #ifndef AGZ_VLAB_DISABLE_DEBUG_UTILS
@@ -0,0 +1,369 @@
+#include <algorithm>
+#include <iterator>
+#include <string>
+
+#include <agz/vlab/window/deviceFeatureManager.h>
+
+AGZ_VULKAN_LAB_BEGIN
+
+namespace
+{
+#ifdef VK_API_VERSION_1_3
+    constexpr uint32_t API_VERSION_1_3 = VK_API_VERSION_1_3;
+#else
+    constexpr uint32_t API_VERSION_1_3 = VK_MAKE_VERSION(1, 3, 0);
+#endif
+
+    // never reached by any device
+    constexpr uint32_t API_VERSION_UNAVAILABLE = UINT32_MAX;
+
+    struct StructInfo
+    {
+        // version in which the struct is core
+        uint32_t promotedVersion;
+
+        // extension providing the struct before promotion
+        const char *extension;
+
+        // min api version to use the extension. dependencies of these
+        // extensions are core in this version
+        uint32_t extensionMinVersion;
+    };
+
+    // indexed by DeviceFeatureChain::Struct
+    const StructInfo STRUCT_INFO[] = {
+        { VK_API_VERSION_1_0, nullptr, 0 },
+        { VK_API_VERSION_1_1, nullptr, 0 },
+        {
+            VK_API_VERSION_1_2,
+            VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME,
+            VK_API_VERSION_1_1
+        },
+        {
+            VK_API_VERSION_1_2,
+            VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME,
+            VK_API_VERSION_1_1
+        },
+        {
+            VK_API_VERSION_1_2,
+            VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME,
+            VK_API_VERSION_1_1
+        },
+        {
+            VK_API_VERSION_1_2,
+            VK_EXT_HOST_QUERY_RESET_EXTENSION_NAME,
+            VK_API_VERSION_1_1
+        },
+#ifdef VK_KHR_synchronization2
+        {
+            API_VERSION_1_3,
+            VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME,
+            VK_API_VERSION_1_1
+        },
+#else
+        { API_VERSION_UNAVAILABLE, nullptr, 0 },
+#endif
+#ifdef VK_KHR_dynamic_rendering
+        {
+            API_VERSION_1_3,
+            VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME,
+            VK_API_VERSION_1_2
+        },
+#else
+        { API_VERSION_UNAVAILABLE, nullptr, 0 },
+#endif
+    };
+
+    // indexed by DeviceFeature
+    const char *const FEATURE_NAMES[] = {
+        "samplerAnisotropy",
+        "fillModeNonSolid",
+        "wideLines",
+        "multiDrawIndirect",
+        "drawIndirectFirstInstance",
+        "pipelineStatisticsQuery",
+        "occlusionQueryPrecise",
+        "shaderInt64",
+        "shaderDrawParameters",
+        "timelineSemaphore",
+        "runtimeDescriptorArray",
+        "shaderSampledImageArrayNonUniformIndexing",
+        "descriptorBindingPartiallyBound",
+        "descriptorBindingVariableDescriptorCount",
+        "descriptorBindingSampledImageUpdateAfterBind",
+        "bufferDeviceAddress",
+        "hostQueryReset",
+        "synchronization2",
+        "dynamicRendering"
+    };
+
+    static_assert(std::size(FEATURE_NAMES) ==
+                  static_cast<size_t>(DeviceFeature::Count));
+}
+
+uint32_t getEffectiveApiVersion(vk::PhysicalDevice physicalDevice)
+{
+    return (std::min)(
+        INSTANCE_API_VERSION, physicalDevice.getProperties().apiVersion);
+}
+
+const char *getDeviceFeatureName(DeviceFeature feature) noexcept
+{
+    assert(feature < DeviceFeature::Count);
+    return FEATURE_NAMES[static_cast<int>(feature)];
+}
+
+void DeviceFeatureManager::require(DeviceFeature feature)
+{
+    optional_.erase(feature);
+    required_.insert(feature);
+}
+
+void DeviceFeatureManager::request(DeviceFeature feature)
+{
+    if(!required_.count(feature))
+        optional_.insert(feature);
+}
+
+std::set<DeviceFeature> DeviceFeatureManager::querySupported(
+    vk::PhysicalDevice physicalDevice) const
+{
+    const DeviceFeatureChain chain(physicalDevice);
+
+    std::set<DeviceFeature> ret;
+    for(auto f : required_)
+    {
+        if(chain.isSupported(f))
+            ret.insert(f);
+    }
+    for(auto f : optional_)
+    {
+        if(chain.isSupported(f))
+            ret.insert(f);
+    }
+    return ret;
+}
+
+bool DeviceFeatureManager::isAllSupported(
+    vk::PhysicalDevice physicalDevice) const
+{
+    if(required_.empty())
+        return true;
+
+    const DeviceFeatureChain chain(physicalDevice);
+    for(auto f : required_)
+    {
+        if(!chain.isSupported(f))
+            return false;
+    }
+    return true;
+}
+
+DeviceFeatureChain::DeviceFeatureChain()
+{
+    linked_[Core10] = true;
+    link();
+}
+
+DeviceFeatureChain::DeviceFeatureChain(vk::PhysicalDevice physicalDevice)
+{
+    const uint32_t apiVersion = getEffectiveApiVersion(physicalDevice);
+
+    // vkGetPhysicalDeviceFeatures2 is core in 1.1
+
+    linked_[Core10] = true;
+    if(apiVersion < VK_API_VERSION_1_1)
+    {
+        features2_.features = physicalDevice.getFeatures();
+        link();
+        return;
+    }
+
+    std::set<std::string> exts;
+    for(auto &e : physicalDevice.enumerateDeviceExtensionProperties())
+        exts.insert(&e.extensionName[0]);
+
+    for(int s = Core10 + 1; s < StructCount; ++s)
+    {
+        const auto &info = STRUCT_INFO[s];
+        if(info.promotedVersion == API_VERSION_UNAVAILABLE)
+            continue;
+
+        linked_[s] = apiVersion >= info.promotedVersion ||
+                     (info.extension &&
+                      apiVersion >= info.extensionMinVersion &&
+                      exts.count(info.extension));
+    }
+
+    link();
+    physicalDevice.getFeatures2(&features2_);
+}
+
+const vk::Bool32 *DeviceFeatureChain::get(
+    DeviceFeature feature) const noexcept
+{
+    return const_cast<DeviceFeatureChain *>(this)->getMutable(feature);
+}
+
+void DeviceFeatureChain::enable(DeviceFeature feature)
+{
+    const Struct s = getStruct(feature);
+    if(STRUCT_INFO[s].promotedVersion == API_VERSION_UNAVAILABLE)
+    {
+        throw std::runtime_error(
+            std::string("device feature unavailable in vulkan headers: ")
+          + getDeviceFeatureName(feature));
+    }
+
+    if(!linked_[s])
+    {
+        linked_[s] = true;
+        link();
+    }
+
+    *getMutable(feature) = VK_TRUE;
+}
+
+std::vector<const char *> DeviceFeatureChain::getRequiredExtensions(
+    uint32_t apiVersion) const
+{
+    std::vector<const char *> ret;
+    for(int s = Core10 + 1; s < StructCount; ++s)
+    {
+        const auto &info = STRUCT_INFO[s];
+        if(linked_[s] && info.extension && apiVersion < info.promotedVersion)
+            ret.push_back(info.extension);
+    }
+    return ret;
+}
+
+DeviceFeatureChain::Struct DeviceFeatureChain::getStruct(
+    DeviceFeature feature) noexcept
+{
+    using F = DeviceFeature;
+
+    switch(feature)
+    {
+    case F::SamplerAnisotropy:
+    case F::FillModeNonSolid:
+    case F::WideLines:
+    case F::MultiDrawIndirect:
+    case F::DrawIndirectFirstInstance:
+    case F::PipelineStatisticsQuery:
+    case F::OcclusionQueryPrecise:
+    case F::ShaderInt64:
+        return Core10;
+    case F::ShaderDrawParameters:
+        return ShaderDrawParameters;
+    case F::TimelineSemaphore:
+        return TimelineSemaphore;
+    case F::RuntimeDescriptorArray:
+    case F::ShaderSampledImageArrayNonUniformIndexing:
+    case F::DescriptorBindingPartiallyBound:
+    case F::DescriptorBindingVariableDescriptorCount:
+    case F::DescriptorBindingSampledImageUpdateAfterBind:
+        return DescriptorIndexing;
+    case F::BufferDeviceAddress:
+        return BufferDeviceAddress;
+    case F::HostQueryReset:
+        return HostQueryReset;
+    case F::Synchronization2:
+        return Synchronization2;
+    case F::DynamicRendering:
+        return DynamicRendering;
+    default:
+        break;
+    }
+
+    assert(false);
+    return Core10;
+}
+
+vk::Bool32 *DeviceFeatureChain::getMutable(DeviceFeature feature) noexcept
+{
+    using F = DeviceFeature;
+
+    if(!linked_[getStruct(feature)])
+        return nullptr;
+
+    auto &core = features2_.features;
+    auto &di   = descriptorIndexing_;
+
+    switch(feature)
+    {
+    case F::SamplerAnisotropy:         return &core.samplerAnisotropy;
+    case F::FillModeNonSolid:          return &core.fillModeNonSolid;
+    case F::WideLines:                 return &core.wideLines;
+    case F::MultiDrawIndirect:         return &core.multiDrawIndirect;
+    case F::DrawIndirectFirstInstance: return &core.drawIndirectFirstInstance;
+    case F::PipelineStatisticsQuery:   return &core.pipelineStatisticsQuery;
+    case F::OcclusionQueryPrecise:     return &core.occlusionQueryPrecise;
+    case F::ShaderInt64:               return &core.shaderInt64;
+
+    case F::ShaderDrawParameters:
+        return &shaderDrawParameters_.shaderDrawParameters;
+
+    case F::TimelineSemaphore:
+        return &timelineSemaphore_.timelineSemaphore;
+
+    case F::RuntimeDescriptorArray:
+        return &di.runtimeDescriptorArray;
+    case F::ShaderSampledImageArrayNonUniformIndexing:
+        return &di.shaderSampledImageArrayNonUniformIndexing;
+    case F::DescriptorBindingPartiallyBound:
+        return &di.descriptorBindingPartiallyBound;
+    case F::DescriptorBindingVariableDescriptorCount:
+        return &di.descriptorBindingVariableDescriptorCount;
+    case F::DescriptorBindingSampledImageUpdateAfterBind:
+        return &di.descriptorBindingSampledImageUpdateAfterBind;
+
+    case F::BufferDeviceAddress:
+        return &bufferDeviceAddress_.bufferDeviceAddress;
+
+    case F::HostQueryReset:
+        return &hostQueryReset_.hostQueryReset;
+
+#ifdef VK_KHR_synchronization2
+    case F::Synchronization2:
+        return &synchronization2_.synchronization2;
+#endif
+
+#ifdef VK_KHR_dynamic_rendering
+    case F::DynamicRendering:
+        return &dynamicRendering_.dynamicRendering;
+#endif
+
+    default:
+        return nullptr;
+    }
+}
+
+void DeviceFeatureChain::link() noexcept
+{
+    void *next = nullptr;
+
+    auto push = [&](Struct s, auto &str)
+    {
+        if(linked_[s])
+        {
+            str.pNext = next;
+            next = &str;
+        }
+    };
+
+    push(ShaderDrawParameters, shaderDrawParameters_);
+    push(TimelineSemaphore,    timelineSemaphore_);
+    push(DescriptorIndexing,   descriptorIndexing_);
+    push(BufferDeviceAddress,  bufferDeviceAddress_);
+    push(HostQueryReset,       hostQueryReset_);
+#ifdef VK_KHR_synchronization2
+    push(Synchronization2,     synchronization2_);
+#endif
+#ifdef VK_KHR_dynamic_rendering
+    push(DynamicRendering,     dynamicRendering_);
+#endif
+
+    features2_.pNext = next;
+}
+
+AGZ_VULKAN_LAB_END
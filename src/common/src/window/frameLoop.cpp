@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <thread>
+
+#include <agz/vlab/window/frameLoop.h>
+#include <agz/vlab/window/window.h>
+
+AGZ_VULKAN_LAB_BEGIN
+
+FrameLimiter::FrameLimiter(double targetFrameRate)
+{
+    setTargetFrameRate(targetFrameRate);
+}
+
+void FrameLimiter::setTargetFrameRate(double targetFrameRate)
+{
+    targetFrameRate_ = targetFrameRate;
+
+    if(targetFrameRate > 0)
+    {
+        period_ = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(1 / targetFrameRate));
+    }
+    else
+        period_ = {};
+
+    hasDeadline_ = false;
+}
+
+void FrameLimiter::wait()
+{
+    if(period_ == Clock::duration{})
+        return;
+
+    const auto now = Clock::now();
+
+    if(!hasDeadline_)
+    {
+        hasDeadline_ = true;
+        deadline_    = now + period_;
+        return;
+    }
+
+    // too late. restart from now instead of rushing the following frames
+    if(now > deadline_ + period_)
+    {
+        deadline_ = now + period_;
+        return;
+    }
+
+    if(deadline_ - now > spinThreshold_)
+        std::this_thread::sleep_for(deadline_ - now - spinThreshold_);
+
+    while(Clock::now() < deadline_)
+        std::this_thread::yield();
+
+    deadline_ += period_;
+}
+
+FrameLoop::FrameLoop(const FrameLoopDesc &desc)
+    : desc_(desc), limiter_(desc.targetFrameRate)
+{
+    assert(desc_.fixedTimestep > 0);
+    assert(desc_.maxStepsPerFrame > 0);
+}
+
+void FrameLoop::frame(const UpdateFunc &update, const RenderFunc &render)
+{
+    const auto now = Clock::now();
+
+    if(hasLastTime_)
+    {
+        const auto elapsed = now - lastTime_;
+
+        accumulator_ += std::chrono::duration<double>(elapsed).count();
+
+        frameTimes_.push_back(
+            std::chrono::duration<float, std::milli>(elapsed).count());
+        while(frameTimes_.size() > desc_.statisticsFrameCount)
+            frameTimes_.pop_front();
+    }
+
+    hasLastTime_ = true;
+    lastTime_    = now;
+
+    // simulation
+
+    uint32_t steps = 0;
+    while(accumulator_ >= desc_.fixedTimestep)
+    {
+        if(steps >= desc_.maxStepsPerFrame)
+        {
+            accumulator_ = 0;
+            break;
+        }
+
+        if(update)
+            update(desc_.fixedTimestep);
+
+        accumulator_    -= desc_.fixedTimestep;
+        simulationTime_ += desc_.fixedTimestep;
+        ++stepCount_;
+        ++steps;
+    }
+
+    // rendering
+
+    if(render)
+        render(static_cast<float>(accumulator_ / desc_.fixedTimestep));
+    ++frameCount_;
+
+    limiter_.wait();
+}
+
+void FrameLoop::run(
+    Window &window, const UpdateFunc &update, const RenderFunc &render)
+{
+    while(!window.getCloseFlag())
+    {
+        window.doEvents();
+
+        // long idle periods are bounded by maxStepsPerFrame
+        if(window.consumeRedrawRequest())
+            frame(update, render);
+    }
+}
+
+FrameTimeStatistics FrameLoop::getStatistics() const
+{
+    FrameTimeStatistics ret;
+    if(frameTimes_.empty())
+        return ret;
+
+    std::vector<float> sorted(frameTimes_.begin(), frameTimes_.end());
+    std::sort(sorted.begin(), sorted.end());
+
+    ret.sampleCount  = static_cast<uint32_t>(sorted.size());
+    ret.minFrameTime = sorted.front();
+    ret.maxFrameTime = sorted.back();
+
+    for(float t : sorted)
+        ret.avgFrameTime += t;
+    ret.avgFrameTime /= ret.sampleCount;
+
+    const size_t p99Index = (sorted.size() * 99) / 100;
+    ret.p99FrameTime = sorted[(std::min)(p99Index, sorted.size() - 1)];
+
+    if(ret.avgFrameTime > 0)
+        ret.fps = 1000.0f / ret.avgFrameTime;
+
+    return ret;
+}
+
+void FrameLoop::resetTiming() noexcept
+{
+    hasLastTime_ = false;
+    limiter_.reset();
+}
+
+AGZ_VULKAN_LAB_END
@@ -0,0 +1,86 @@
+#include <algorithm>
+
+#include <agz/vlab/window/framePacing.h>
+
+AGZ_VULKAN_LAB_BEGIN
+
+FramePacingTuner::FramePacingTuner(const FramePacingDesc &desc)
+    : desc_(desc)
+{
+    assert(desc_.minFramesInFlight > 0);
+    assert(desc_.minFramesInFlight <= desc_.maxFramesInFlight);
+    assert(desc_.sampleCount > 0);
+
+    framesInFlight_ = desc_.maxFramesInFlight;
+}
+
+void FramePacingTuner::addSample(float cpuTime, float gpuTime)
+{
+    cpuSum_ += cpuTime;
+    gpuSum_ += gpuTime;
+    ++sampleCount_;
+}
+
+bool FramePacingTuner::update()
+{
+    if(sampleCount_ < desc_.sampleCount)
+        return false;
+
+    avgCpuTime_ = cpuSum_ / sampleCount_;
+    avgGpuTime_ = gpuSum_ / sampleCount_;
+    cpuSum_ = gpuSum_ = 0;
+    sampleCount_ = 0;
+
+    const float bestPeriod = estimatePeriod(desc_.maxFramesInFlight);
+    const float maxPeriod  = bestPeriod * (1 + desc_.throughputTolerance);
+
+    uint32_t newFramesInFlight = 0;
+
+    for(uint32_t n = desc_.minFramesInFlight;
+        n <= desc_.maxFramesInFlight; ++n)
+    {
+        if(estimatePeriod(n) <= maxPeriod &&
+           estimateLatency(n) <= desc_.latencyBudget)
+        {
+            newFramesInFlight = n;
+            break;
+        }
+    }
+
+    if(!newFramesInFlight)
+    {
+        newFramesInFlight = desc_.minFramesInFlight;
+        float newPeriod = estimatePeriod(newFramesInFlight);
+
+        for(uint32_t n = desc_.minFramesInFlight + 1;
+            n <= desc_.maxFramesInFlight; ++n)
+        {
+            const float period = estimatePeriod(n);
+            if(estimateLatency(n) <= desc_.latencyBudget && period < newPeriod)
+            {
+                newFramesInFlight = n;
+                newPeriod         = period;
+            }
+        }
+    }
+
+    if(newFramesInFlight == framesInFlight_)
+        return false;
+
+    framesInFlight_ = newFramesInFlight;
+    return true;
+}
+
+float FramePacingTuner::estimatePeriod(uint32_t framesInFlight) const noexcept
+{
+    const float serial = avgCpuTime_ + avgGpuTime_;
+    return (std::max)({ avgCpuTime_, avgGpuTime_, serial / framesInFlight });
+}
+
+float FramePacingTuner::estimateLatency(uint32_t framesInFlight) const noexcept
+{
+    const float serial = avgCpuTime_ + avgGpuTime_;
+    return (std::max)(serial, framesInFlight * estimatePeriod(framesInFlight));
+}
+
+AGZ_VULKAN_LAB_END
@@ -1,5 +1,8 @@
+#include <cstring>
+#include <map>
 #include <optional>
 
+#include <agz/vlab/window/debugUtils.h>
 #include <agz/vlab/window/graphicsDevice.h>
 #include <agz/vlab/window/swapchain.h>
 
@@ -7,47 +10,117 @@ AGZ_VULKAN_LAB_BEGIN
 
 namespace
 {
+    // max number of queues created for each used family
+    constexpr uint32_t MAX_QUEUES_PER_FAMILY = 4;
+
     struct GraphicsQueueFamilyIndices
     {
         std::optional<uint32_t> graphics;
+        std::optional<uint32_t> compute;
         std::optional<uint32_t> transfer;
         std::optional<uint32_t> present;
 
         bool isAvailable() const noexcept
         {
             return graphics.has_value() &&
+                   compute.has_value() &&
                    transfer.has_value() &&
                    present.has_value();
         }
     };
 
+    // surface can be null, in which case the graphics family presents
     GraphicsQueueFamilyIndices getGraphicsQueueIndices(
         vk::PhysicalDevice physicalDevice, vk::SurfaceKHR surface)
     {
+        using F = vk::QueueFlagBits;
+
         const auto families = physicalDevice.getQueueFamilyProperties();
+        const uint32_t familyCount = static_cast<uint32_t>(families.size());
+
+        auto has = [&](uint32_t i, vk::QueueFlagBits flag)
+        {
+            return static_cast<bool>(families[i].queueFlags & flag);
+        };
+
+        auto canPresent = [&](uint32_t i)
+        {
+            return !surface ||
+                   physicalDevice.getSurfaceSupportKHR(i, surface) == VK_TRUE;
+        };
 
         GraphicsQueueFamilyIndices ret;
-        for(uint32_t i = 0; i < families.size(); ++i)
+
+        // graphics. prefer a family that can also present
+
+        for(uint32_t i = 0; i < familyCount; ++i)
         {
-            // graphics
+            if(!has(i, F::eGraphics))
+                continue;
 
-            if(families[i].queueFlags & vk::QueueFlagBits::eGraphics)
+            if(!ret.graphics)
                 ret.graphics = i;
 
-            // transfer
-
-            if(families[i].queueFlags & vk::QueueFlagBits::eTransfer)
-                ret.transfer = i;
+            if(canPresent(i))
+            {
+                ret.graphics = i;
+                ret.present  = i;
+                break;
+            }
+        }
 
-            // presentation
+        if(!ret.graphics)
+            return ret;
 
-            if(physicalDevice.getSurfaceSupportKHR(i, surface))
+        for(uint32_t i = 0; !ret.present && i < familyCount; ++i)
+        {
+            if(canPresent(i))
                 ret.present = i;
+        }
 
-            if(ret.isAvailable())
+        // compute. prefer an async compute family
+
+        for(uint32_t i = 0; i < familyCount; ++i)
+        {
+            if(has(i, F::eCompute) && !has(i, F::eGraphics))
+            {
+                ret.compute = i;
                 break;
+            }
         }
 
+        if(!ret.compute && has(*ret.graphics, F::eCompute))
+            ret.compute = ret.graphics;
+
+        for(uint32_t i = 0; !ret.compute && i < familyCount; ++i)
+        {
+            if(has(i, F::eCompute))
+                ret.compute = i;
+        }
+
+        // transfer. prefer a dma family, then any non-graphics one.
+        // graphics/compute families always support transfer
+
+        for(uint32_t i = 0; i < familyCount; ++i)
+        {
+            if(has(i, F::eTransfer) &&
+               !has(i, F::eGraphics) && !has(i, F::eCompute))
+            {
+                ret.transfer = i;
+                break;
+            }
+        }
+
+        for(uint32_t i = 0; !ret.transfer && i < familyCount; ++i)
+        {
+            if(!has(i, F::eGraphics) &&
+               (has(i, F::eTransfer) || has(i, F::eCompute)))
+                ret.transfer = i;
+        }
+
+        if(!ret.transfer)
+            ret.transfer = ret.graphics;
+
         return ret;
     }
 }
@@ -70,7 +143,8 @@ std::vector<vk::PhysicalDevice> getAllPhysicalDevices(
 
 bool IsGraphicsPhysicalDevice(
     vk::PhysicalDevice physicalDevice, vk::SurfaceKHR surface,
-    const DeviceExtensionManager *extensions)
+    const DeviceExtensionManager *extensions,
+    const DeviceFeatureManager   *features)
 {
     // queues
 
@@ -79,24 +153,25 @@ bool IsGraphicsPhysicalDevice(
     if(!queueFamilyIndices.isAvailable())
         return false;
 
-    // gpu?
-
-    vk::PhysicalDeviceProperties prop = physicalDevice.getProperties();
-
-    if(prop.deviceType != vk::PhysicalDeviceType::eDiscreteGpu &&
-       prop.deviceType != vk::PhysicalDeviceType::eIntegratedGpu)
-        return false;
-
     // extensions
 
     DeviceExtensionManager exts;
     if(extensions)
         exts = *extensions;
-    exts.add(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    if(surface)
+        exts.add(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
     if(!exts.isAllSupported(physicalDevice))
         return false;
 
-    // swapchain
+    // features
+
+    if(features && !features->isAllSupported(physicalDevice))
+        return false;
+
+    // swapchain. skipped for offscreen-only devices
+
+    if(!surface)
+        return true;
 
     const auto swapchainProperty = querySwapchainProperty(
         physicalDevice, surface);
@@ -113,7 +188,9 @@ GraphicsDevice::~GraphicsDevice()
 
 void GraphicsDevice::Initialize(
     vk::PhysicalDevice physicalDevice, vk::SurfaceKHR surface,
-    const DeviceExtensionManager *extensions)
+    vk::DispatchLoaderDynamic    &dispatch,
+    const DeviceExtensionManager *extensions,
+    const DeviceFeatureManager   *features)
 {
     Destroy();
 
@@ -121,37 +198,143 @@ void GraphicsDevice::Initialize(
         physicalDevice, surface);
     assert(queueFamilyIndices.isAvailable());
 
-    const float queuePriority = 1;
+    graphicsIndex_ = queueFamilyIndices.graphics.value();
+    computeIndex_  = queueFamilyIndices.compute.value();
+    transferIndex_ = queueFamilyIndices.transfer.value();
+    presentIndex_  = queueFamilyIndices.present.value();
 
-    vk::DeviceQueueCreateInfo queueInfo[3] = {
-        { {}, queueFamilyIndices.graphics.value(),     1, &queuePriority },
-        { {}, queueFamilyIndices.transfer.value(),     1, &queuePriority },
-        { {}, queueFamilyIndices.present.value(),      1, &queuePriority }
-    };
+    // one create info for each used family, with as many queues as
+    // available (up to MAX_QUEUES_PER_FAMILY)
+
+    const auto familyProps = physicalDevice.getQueueFamilyProperties();
+
+    std::map<uint32_t, uint32_t> familyQueueCounts;
+    for(uint32_t family : {
+        graphicsIndex_, computeIndex_, transferIndex_, presentIndex_ })
+    {
+        familyQueueCounts[family] = (std::min)(
+            familyProps[family].queueCount, MAX_QUEUES_PER_FAMILY);
+    }
+
+    const std::vector<float> queuePriorities(MAX_QUEUES_PER_FAMILY, 1.0f);
+
+    std::vector<vk::DeviceQueueCreateInfo> queueInfo;
+    for(auto &[family, count] : familyQueueCounts)
+        queueInfo.push_back({ {}, family, count, queuePriorities.data() });
+
+    // features
+
+    DeviceFeatureManager featureMgr;
+    if(features)
+        featureMgr = *features;
+    featureMgr.request(DeviceFeature::TimelineSemaphore);
+
+    const auto supportedFeatures = featureMgr.querySupported(physicalDevice);
+
+    std::set<DeviceFeature> enabledFeatures;
+    for(auto f : featureMgr.getRequiredFeatures())
+    {
+        if(!supportedFeatures.count(f))
+        {
+            throw std::runtime_error(
+                std::string("device feature not supported: ")
+              + getDeviceFeatureName(f));
+        }
+        enabledFeatures.insert(f);
+    }
+    for(auto f : featureMgr.getOptionalFeatures())
+    {
+        if(supportedFeatures.count(f))
+            enabledFeatures.insert(f);
+    }
+
+    DeviceFeatureChain featureChain;
+    for(auto f : enabledFeatures)
+        featureChain.enable(f);
+
+    // extensions
 
     DeviceExtensionManager exts;
     if(extensions)
         exts = *extensions;
-    exts.add(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    if(surface)
+        exts.add(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    for(auto e : featureChain.getRequiredExtensions(
+        getEffectiveApiVersion(physicalDevice)))
+        exts.add(e);
     if(!exts.isAllSupported(physicalDevice))
         throw std::runtime_error("device extension(s) not supported");
 
-    vk::PhysicalDeviceFeatures deviceFeatures = {};
+    // optional. used to align gpu timestamps with the cpu clock
+
+    bool calibratedTimestamps = false;
+    for(auto &e : physicalDevice.enumerateDeviceExtensionProperties())
+    {
+        if(std::strcmp(&e.extensionName[0],
+                       VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME) == 0)
+        {
+            exts.add(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME);
+            calibratedTimestamps = true;
+            break;
+        }
+    }
+
+    // core features are passed through the chain head
 
     vk::DeviceCreateInfo deviceInfo(
-        {}, 3, queueInfo, 0, {},
+        {}, static_cast<uint32_t>(queueInfo.size()), queueInfo.data(), 0, {},
         static_cast<uint32_t>(exts.getExtensions().size()),
-        exts.getExtensions().data(), &deviceFeatures);
+        exts.getExtensions().data(), nullptr);
+    deviceInfo.pNext = &featureChain.getHead();
 
-    device_ = physicalDevice.createDeviceUnique(deviceInfo);
+    device_ = physicalDevice.createDeviceUnique(deviceInfo, nullptr, dispatch);
+    dispatch.init(device_.get());
 
-    graphicsIndex_ = queueFamilyIndices.graphics.value();
-    transferIndex_ = queueFamilyIndices.transfer.value();
-    presentIndex_  = queueFamilyIndices.present.value();
+    enabledFeatures_      = std::move(enabledFeatures);
+    calibratedTimestamps_ = calibratedTimestamps;
+
+    // queues
+
+    for(auto &[family, count] : familyQueueCounts)
+    {
+        auto &queues = queues_[family];
+        for(uint32_t i = 0; i < count; ++i)
+            queues.push_back(device_->getQueue(family, i, dispatch));
+    }
+
+    // roles sharing a family get different queues while there are enough.
+    // presentation uses the graphics queue when possible
 
-    graphicsQueue_     = device_->getQueue(graphicsIndex_, 0);
-    transferQueue_     = device_->getQueue(transferIndex_, 0);
-    presentationQueue_ = device_->getQueue(presentIndex_, 0);
+    std::map<uint32_t, uint32_t> nextQueue;
+    auto assignQueue = [&](uint32_t family)
+    {
+        auto &queues = queues_[family];
+        return queues[nextQueue[family]++ % queues.size()];
+    };
+
+    graphicsQueue_ = assignQueue(graphicsIndex_);
+    computeQueue_  = assignQueue(computeIndex_);
+    transferQueue_ = assignQueue(transferIndex_);
+
+    presentationQueue_ = presentIndex_ == graphicsIndex_ ?
+                         graphicsQueue_ : assignQueue(presentIndex_);
+
+    // a queue shared by several roles keeps the name set last
+
+    const vk::Device device = device_.get();
+    setDebugName(device, device,             "graphics device", dispatch);
+    setDebugName(device, presentationQueue_, "present queue",   dispatch);
+    setDebugName(device, transferQueue_,     "transfer queue",  dispatch);
+    setDebugName(device, computeQueue_,      "compute queue",   dispatch);
+    setDebugName(device, graphicsQueue_,     "graphics queue",  dispatch);
+}
+
+const std::vector<vk::Queue> &GraphicsDevice::queues(
+    uint32_t familyIndex) const
+{
+    static const std::vector<vk::Queue> EMPTY;
+    auto it = queues_.find(familyIndex);
+    return it != queues_.end() ? it->second : EMPTY;
 }
 
 void GraphicsDevice::Destroy()
@@ -161,12 +344,19 @@ void GraphicsDevice::Destroy()
         device_.reset();
 
         graphicsIndex_     = 0;
+        computeIndex_      = 0;
         transferIndex_     = 0;
         presentIndex_      = 0;
 
+        enabledFeatures_.clear();
+        calibratedTimestamps_ = false;
+
         graphicsQueue_     = nullptr;
+        computeQueue_      = nullptr;
         transferQueue_     = nullptr;
         presentationQueue_ = nullptr;
+
+        queues_.clear();
     }
 }
 
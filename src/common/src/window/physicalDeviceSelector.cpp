@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+#include <agz/vlab/window/physicalDeviceSelector.h>
+
+AGZ_VULKAN_LAB_BEGIN
+
+namespace
+{
+    int64_t getTypeScore(vk::PhysicalDeviceType type) noexcept
+    {
+        switch(type)
+        {
+        case vk::PhysicalDeviceType::eDiscreteGpu:   return 4000;
+        case vk::PhysicalDeviceType::eIntegratedGpu: return 3000;
+        case vk::PhysicalDeviceType::eVirtualGpu:    return 2000;
+        case vk::PhysicalDeviceType::eCpu:           return 1000;
+        default:                                     return 0;
+        }
+    }
+
+    vk::DeviceSize getDeviceLocalMemory(vk::PhysicalDevice device)
+    {
+        const auto memProps = device.getMemoryProperties();
+
+        vk::DeviceSize ret = 0;
+        for(uint32_t i = 0; i < memProps.memoryHeapCount; ++i)
+        {
+            if(memProps.memoryHeaps[i].flags &
+               vk::MemoryHeapFlagBits::eDeviceLocal)
+                ret += memProps.memoryHeaps[i].size;
+        }
+
+        return ret;
+    }
+
+    std::string toLower(std::string s)
+    {
+        for(auto &c : s)
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        return s;
+    }
+
+    bool isPreferred(
+        const std::string &preference, uint32_t index, const std::string &name)
+    {
+        if(preference.empty())
+            return false;
+
+        const bool isIndex = std::all_of(
+            preference.begin(), preference.end(),
+            [](char c) { return std::isdigit(static_cast<unsigned char>(c)); });
+        if(isIndex)
+            return std::strtoul(preference.c_str(), nullptr, 10) == index;
+
+        return toLower(name).find(toLower(preference)) != std::string::npos;
+    }
+}
+
+std::vector<PhysicalDeviceRank> rankPhysicalDevices(
+    vk::Instance                                   instance,
+    const PhysicalDeviceSelectionDesc             &desc,
+    const std::function<bool(vk::PhysicalDevice)> &filter)
+{
+    std::string preference = desc.preferred;
+    if(preference.empty() && desc.preferenceEnvVar)
+    {
+        if(const char *env = std::getenv(desc.preferenceEnvVar))
+            preference = env;
+    }
+
+    const auto devices = instance.enumeratePhysicalDevices();
+
+    std::vector<PhysicalDeviceRank> ret;
+    for(uint32_t i = 0; i < devices.size(); ++i)
+    {
+        const auto device = devices[i];
+        const auto props  = device.getProperties();
+
+        if(!desc.allowCpu && props.deviceType == vk::PhysicalDeviceType::eCpu)
+            continue;
+
+        if(filter && !filter(device))
+            continue;
+
+        PhysicalDeviceRank rank;
+        rank.device            = device;
+        rank.index             = i;
+        rank.name              = &props.deviceName[0];
+        rank.type              = props.deviceType;
+        rank.deviceLocalMemory = getDeviceLocalMemory(device);
+        rank.preferred         = isPreferred(preference, i, rank.name);
+
+        // type, then memory (up to 64GB, below type difference)
+
+        rank.score = getTypeScore(rank.type) * 1000;
+
+        const int64_t memoryGB = static_cast<int64_t>(
+            rank.deviceLocalMemory >> 30);
+        rank.score += (std::min<int64_t>)(memoryGB, 64) * 10;
+
+        // api version/features
+
+        if(props.apiVersion >= VK_API_VERSION_1_2)
+            rank.score += 5;
+
+        const auto features = device.getFeatures();
+        if(features.samplerAnisotropy)
+            rank.score += 1;
+        if(features.pipelineStatisticsQuery)
+            rank.score += 1;
+
+        // optional extensions
+
+        if(!desc.optionalExtensions.empty())
+        {
+            const auto exts = device.enumerateDeviceExtensionProperties();
+            for(auto name : desc.optionalExtensions)
+            {
+                const bool supported = std::any_of(
+                    exts.begin(), exts.end(),
+                    [&](const vk::ExtensionProperties &e)
+                {
+                    return std::strcmp(&e.extensionName[0], name) == 0;
+                });
+                if(supported)
+                    rank.score += 2;
+            }
+        }
+
+        if(rank.preferred)
+            rank.score += int64_t(1) << 40;
+
+        ret.push_back(std::move(rank));
+    }
+
+    std::stable_sort(ret.begin(), ret.end(),
+        [](const PhysicalDeviceRank &a, const PhysicalDeviceRank &b)
+    {
+        return a.score > b.score;
+    });
+
+    return ret;
+}
+
+const char *getPhysicalDeviceTypeName(vk::PhysicalDeviceType type) noexcept
+{
+    switch(type)
+    {
+    case vk::PhysicalDeviceType::eDiscreteGpu:   return "discrete";
+    case vk::PhysicalDeviceType::eIntegratedGpu: return "integrated";
+    case vk::PhysicalDeviceType::eVirtualGpu:    return "virtual";
+    case vk::PhysicalDeviceType::eCpu:           return "cpu";
+    default:                                     return "other";
+    }
+}
+
+void printPhysicalDeviceRanking(
+    std::ostream &out, const std::vector<PhysicalDeviceRank> &ranking)
+{
+    for(size_t i = 0; i < ranking.size(); ++i)
+    {
+        auto &r = ranking[i];
+        out << (i == 0 ? "* " : "  ")
+            << "[" << r.index << "] " << r.name
+            << " (" << getPhysicalDeviceTypeName(r.type)
+            << ", " << (r.deviceLocalMemory >> 20) << "MB"
+            << (r.preferred ? ", preferred" : "")
+            << "), score = " << r.score << std::endl;
+    }
+}
+
+AGZ_VULKAN_LAB_END
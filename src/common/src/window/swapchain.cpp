@@ -1,7 +1,40 @@
+#include <algorithm>
+
 #include <agz/vlab/window/swapchain.h>
 
 AGZ_VULKAN_LAB_BEGIN
 
+std::vector<vk::PresentModeKHR> getPreferredPresentModes(
+    PresentPolicy policy)
+{
+    switch(policy)
+    {
+    case PresentPolicy::AdaptiveVSync:
+        return { vk::PresentModeKHR::eFifoRelaxed, vk::PresentModeKHR::eFifo };
+    case PresentPolicy::NoVSync:
+        return { vk::PresentModeKHR::eMailbox, vk::PresentModeKHR::eImmediate,
+                 vk::PresentModeKHR::eFifo };
+    case PresentPolicy::Mailbox:
+        return { vk::PresentModeKHR::eMailbox, vk::PresentModeKHR::eFifo };
+    case PresentPolicy::Immediate:
+        return { vk::PresentModeKHR::eImmediate, vk::PresentModeKHR::eFifo };
+    default:
+        return { vk::PresentModeKHR::eFifo };
+    }
+}
+
+const char *getPresentModeName(vk::PresentModeKHR mode) noexcept
+{
+    switch(mode)
+    {
+    case vk::PresentModeKHR::eImmediate:   return "immediate";
+    case vk::PresentModeKHR::eMailbox:     return "mailbox";
+    case vk::PresentModeKHR::eFifo:        return "fifo";
+    case vk::PresentModeKHR::eFifoRelaxed: return "fifo relaxed";
+    default:                               return "unknown";
+    }
+}
+
 bool SwapchainProperty::IsAvailable() const noexcept
 {
     return !formats.empty() && !presentModes.empty();
@@ -62,6 +95,17 @@ vk::Extent2D SwapchainProperty::chooseExtent(
     return VkExtent2D{ w, h };
 }
 
+uint32_t SwapchainProperty::chooseImageCount(uint32_t preferred) const noexcept
+{
+    uint32_t ret = (std::max)(preferred, capabilities.minImageCount);
+
+    // 0 means no limit
+    if(capabilities.maxImageCount)
+        ret = (std::min)(ret, capabilities.maxImageCount);
+
+    return ret;
+}
+
 SwapchainProperty querySwapchainProperty(
     vk::PhysicalDevice device, vk::SurfaceKHR surface)
 {
@@ -0,0 +1,362 @@
+#include <iostream>
+
+#include <agz/vlab/window/debugUtils.h>
+#include <agz/vlab/window/physicalDeviceSelector.h>
+#include <agz/vlab/window/vulkanContext.h>
+
+#include <GLFW/glfw3.h>
+
+AGZ_VULKAN_LAB_BEGIN
+
+namespace
+{
+    int glfwRefCounter = 0;
+
+    // the context whose instance and device the default dispatcher is
+    // bound to. it is not rebound while this context is alive
+    const VulkanContext *dispatcherOwner = nullptr;
+
+    VKAPI_ATTR VkBool32 VKAPI_CALL vkDebugCallback(
+        VkDebugUtilsMessageSeverityFlagBitsEXT      severity,
+        VkDebugUtilsMessageTypeFlagsEXT             type,
+        const VkDebugUtilsMessengerCallbackDataEXT *callbackData,
+        void                                       *userData)
+    {
+        static_cast<DebugMessageLogger *>(userData)->log(callbackData);
+        return VK_FALSE;
+    }
+
+    vk::DebugUtilsMessengerCreateInfoEXT debugCreateInfo(
+        DebugMessageManager::Level level, DebugMessageLogger *logger) noexcept
+    {
+        vk::DebugUtilsMessageSeverityFlagsEXT severity;
+        switch(level)
+        {
+        case DebugMessageManager::Level::Verbose:
+            severity = vk::DebugUtilsMessageSeverityFlagBitsEXT::eError   |
+                       vk::DebugUtilsMessageSeverityFlagBitsEXT::eWarning |
+                       vk::DebugUtilsMessageSeverityFlagBitsEXT::eInfo    |
+                       vk::DebugUtilsMessageSeverityFlagBitsEXT::eVerbose;
+            break;
+        case DebugMessageManager::Level::Infomation:
+            severity = vk::DebugUtilsMessageSeverityFlagBitsEXT::eError   |
+                       vk::DebugUtilsMessageSeverityFlagBitsEXT::eWarning |
+                       vk::DebugUtilsMessageSeverityFlagBitsEXT::eInfo;
+            break;
+        case DebugMessageManager::Level::Warning:
+            severity = vk::DebugUtilsMessageSeverityFlagBitsEXT::eError   |
+                       vk::DebugUtilsMessageSeverityFlagBitsEXT::eWarning;
+            break;
+        default:
+            severity = vk::DebugUtilsMessageSeverityFlagBitsEXT::eError;
+            break;
+        }
+
+        const auto type = vk::DebugUtilsMessageTypeFlagBitsEXT::eGeneral |
+                          vk::DebugUtilsMessageTypeFlagBitsEXT::eValidation|
+                          vk::DebugUtilsMessageTypeFlagBitsEXT::ePerformance;
+
+        return vk::DebugUtilsMessengerCreateInfoEXT(
+            {}, severity, type, vkDebugCallback, logger);
+    }
+
+    vk::UniqueInstance createVkInstance(
+        const VulkanContextDesc &desc, DebugMessageLogger *logger)
+    {
+        // layers
+
+        if(desc.layers && !desc.layers->isAllSupported())
+            throw std::runtime_error("validation layer(s) unsupported");
+
+        // vk app info
+
+        vk::ApplicationInfo appInfo(
+            desc.appName.c_str(),
+            VK_MAKE_VERSION(1, 0, 0),
+            desc.appName.c_str(),
+            VK_MAKE_VERSION(1, 0, 0),
+            INSTANCE_API_VERSION);
+
+        // inst info
+
+        vk::InstanceCreateInfo instInfo;
+        instInfo.flags            = {};
+        instInfo.pApplicationInfo = &appInfo;
+
+        // validation layers
+
+        if(desc.layers)
+        {
+            if(!desc.layers->isAllSupported())
+                throw std::runtime_error("validation layer(s) unsupported");
+
+            const auto &layers = desc.layers->getLayers();
+
+            instInfo.enabledLayerCount = static_cast<uint32_t>(layers.size());
+            instInfo.ppEnabledLayerNames = layers.data();
+        }
+        else
+        {
+            instInfo.enabledLayerCount = 0;
+            instInfo.ppEnabledLayerNames = nullptr;
+        }
+
+        // debug message
+
+        vk::DebugUtilsMessengerCreateInfoEXT debugInfo;
+
+        if(desc.enableDebugMessage)
+        {
+            debugInfo = debugCreateInfo(desc.debugMsgLevel, logger);
+            instInfo.pNext = &debugInfo;
+        }
+        else
+            instInfo.pNext = nullptr;
+
+        // extensions
+
+        InstanceExtensionManager extsMgr;
+
+        if(desc.instanceExtensions)
+            extsMgr = *desc.instanceExtensions;
+
+        if(desc.enableDebugMessage)
+            extsMgr.add(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+
+        if(desc.windowSurfaces)
+        {
+            uint32_t glfwExtCount = 0;
+            const auto glfwExts =
+                glfwGetRequiredInstanceExtensions(&glfwExtCount);
+            extsMgr.add(glfwExts, glfwExtCount);
+        }
+
+        if(desc.headlessSurfaces)
+        {
+            extsMgr.add(VK_KHR_SURFACE_EXTENSION_NAME);
+            extsMgr.add(VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME);
+        }
+
+        if(!extsMgr.isAllSupported())
+            throw std::runtime_error("extension(s) unsupported");
+
+        auto &exts = extsMgr.getExtensions();
+        instInfo.enabledExtensionCount = static_cast<uint32_t>(exts.size());
+        instInfo.ppEnabledExtensionNames = exts.data();
+
+        // create instance
+
+        return createInstanceUnique(instInfo);
+    }
+
+}
+
+void acquireGlfw()
+{
+    if(!glfwRefCounter && glfwInit() != GLFW_TRUE)
+        throw std::runtime_error("failed to initialize glfw");
+    ++glfwRefCounter;
+}
+
+void releaseGlfw()
+{
+    assert(glfwRefCounter > 0);
+    if(!--glfwRefCounter)
+        glfwTerminate();
+}
+
+VulkanContext::~VulkanContext()
+{
+    Destroy();
+}
+
+void VulkanContext::InitializeInstance(const VulkanContextDesc &desc)
+{
+    Destroy();
+
+    // vulkan loader. kept loaded since glfw may not be initialized
+
+    static vk::DynamicLoader dl;
+    static bool loaderInitialized = false;
+    if(!loaderInitialized)
+    {
+        PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr = dl.getProcAddress
+            <PFN_vkGetInstanceProcAddr>("vkGetInstanceProcAddr");
+        VULKAN_HPP_DEFAULT_DISPATCHER.init(vkGetInstanceProcAddr);
+        loaderInitialized = true;
+    }
+
+    // glfw is needed to query surface extensions
+
+    if(desc.windowSurfaces)
+        acquireGlfw();
+    misc::scope_guard_t glfwGuard([&]
+    {
+        if(desc.windowSurfaces)
+            releaseGlfw();
+    });
+
+    // instance
+
+    // the logger also receives messages of instance creation
+
+    if(desc.enableDebugMessage)
+    {
+        debugMsgLogger_ = std::make_shared<DebugMessageLogger>(
+            desc.debugMsgLogger ? *desc.debugMsgLogger
+                                : DebugMessageLoggerDesc{});
+    }
+    misc::scope_guard_t loggerGuard([&]
+    {
+        debugMsgLogger_.reset();
+    });
+
+    instance_ = createVkInstance(desc, debugMsgLogger_.get());
+
+    // bind the default dispatcher if no other context uses it
+
+    if(!dispatcherOwner)
+    {
+        VULKAN_HPP_DEFAULT_DISPATCHER.init(instance_.get());
+        dispatcherOwner = this;
+    }
+    misc::scope_guard_t instanceGuard([&]
+    {
+        instance_.reset();
+        if(dispatcherOwner == this)
+            dispatcherOwner = nullptr;
+    });
+
+    // debug message manager
+
+    if(desc.enableDebugMessage)
+    {
+        debugMsgMgr_ = std::make_unique<DebugMessageManager>(
+            instance_.get(), desc.debugMsgLevel, debugMsgLogger_);
+    }
+
+    desc_         = desc;
+    glfwAcquired_ = desc.windowSurfaces;
+
+    instanceGuard.dismiss();
+    loggerGuard  .dismiss();
+    glfwGuard    .dismiss();
+}
+
+void VulkanContext::InitializeDevice(vk::SurfaceKHR surface)
+{
+    assert(instance_ && !graphicsDevice_.device());
+
+    // physical device
+
+    PhysicalDeviceSelectionDesc selectionDesc;
+    selectionDesc.preferred = desc_.preferredPhysicalDevice;
+
+    const auto graphicsPhysicalDevices = rankPhysicalDevices(
+        instance_.get(), selectionDesc,
+        [&](vk::PhysicalDevice physicalDevice)
+    {
+        return IsGraphicsPhysicalDevice(
+            physicalDevice, surface,
+            desc_.deviceExtensions, desc_.deviceFeatures);
+    });
+
+    if(graphicsPhysicalDevices.empty())
+        throw std::runtime_error("graphics physical device not found");
+
+    if(desc_.logPhysicalDevices)
+    {
+        std::cerr << "physical devices:" << std::endl;
+        printPhysicalDeviceRanking(std::cerr, graphicsPhysicalDevices);
+    }
+
+    physicalDevice_ = graphicsPhysicalDevices[0].device;
+
+    // graphics device & queues. device functions are loaded into
+    // deviceDispatch_ with vkGetDeviceProcAddr
+
+    deviceDispatch_.init(
+        instance_.get(), VULKAN_HPP_DEFAULT_DISPATCHER.vkGetInstanceProcAddr);
+
+    graphicsDevice_.Initialize(
+        physicalDevice_, surface, deviceDispatch_,
+        desc_.deviceExtensions, desc_.deviceFeatures);
+    misc::scope_guard_t deviceGuard([&]
+    {
+        graphicsDevice_.Destroy();
+        deviceDispatch_ = {};
+        physicalDevice_ = nullptr;
+    });
+
+    if(desc_.logPhysicalDevices && desc_.deviceFeatures)
+    {
+        std::cerr << "optional device features:";
+        for(auto f : desc_.deviceFeatures->getOptionalFeatures())
+        {
+            std::cerr << " " << getDeviceFeatureName(f)
+                      << (graphicsDevice_.isFeatureEnabled(f) ?
+                          "(on)" : "(off)");
+        }
+        std::cerr << std::endl;
+    }
+
+    if(dispatcherOwner == this)
+        VULKAN_HPP_DEFAULT_DISPATCHER.init(graphicsDevice_.device());
+
+    // device-wide objects
+
+    allocator_ = std::make_unique<VMAAlloc>(
+        instance_.get(), physicalDevice_, graphicsDevice_.device(),
+        deviceDispatch_);
+    misc::scope_guard_t allocatorGuard([&]
+    {
+        allocator_.reset();
+    });
+
+    pipelineCache_ = graphicsDevice_.device().createPipelineCacheUnique(
+        {}, nullptr, deviceDispatch_);
+    setDebugName(
+        graphicsDevice_.device(), pipelineCache_.get(), "pipeline cache",
+        deviceDispatch_);
+
+    allocatorGuard.dismiss();
+    deviceGuard   .dismiss();
+}
+
+void VulkanContext::Destroy()
+{
+    pipelineCache_.reset();
+    allocator_.reset();
+
+    graphicsDevice_.Destroy();
+    deviceDispatch_ = {};
+    physicalDevice_ = nullptr;
+
+    debugMsgMgr_.reset();
+    instance_.reset();
+    debugMsgLogger_.reset();
+
+    if(dispatcherOwner == this)
+        dispatcherOwner = nullptr;
+
+    if(glfwAcquired_)
+    {
+        glfwAcquired_ = false;
+        releaseGlfw();
+    }
+
+    desc_ = {};
+}
+
+bool VulkanContext::isDefaultDispatcherBound() const noexcept
+{
+    return dispatcherOwner == this;
+}
+
+bool VulkanContext::canPresent(vk::SurfaceKHR surface) const
+{
+    return physicalDevice_.getSurfaceSupportKHR(
+        graphicsDevice_.presentQueueFamilyIndex(), surface) == VK_TRUE;
+}
+
+AGZ_VULKAN_LAB_END
@@ -1,7 +1,18 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <deque>
 #include <iostream>
+#include <thread>
 
+#include <agz/vlab/profile/cpuTracer.h>
+#include <agz/vlab/thread/spscQueue.h>
+#include <agz/vlab/window/debugUtils.h>
 #include <agz/vlab/window/graphicsDevice.h>
 #include <agz/vlab/window/swapchain.h>
+#include <agz/vlab/window/vulkanContext.h>
 #include <agz/vlab/window/window.h>
 
 #include <GLFW/glfw3.h>
@@ -12,171 +23,250 @@ AGZ_VULKAN_LAB_BEGIN
 
 struct WindowImplData
 {
+    using Clock = std::chrono::steady_clock;
+
     // desc settings
 
+    bool headless = false;
+
+    // swapchain size in headless mode
+    int headlessWidth  = 0;
+    int headlessHeight = 0;
+
     int swapchainImageCount = 2;
     bool clipObscuredPixels  = true;
 
+    uint32_t framesInFlight = 2;
+
+    // WindowDesc::vsync. PresentPolicy::Default is resolved with it
+    bool vsync = true;
+
+    PresentPolicy presentPolicy = PresentPolicy::VSync;
+
     // others
 
     GLFWwindow *glfwWindow = nullptr;
 
-    vk::UniqueInstance instance;
-
-    std::unique_ptr<DebugMessageManager> debugMsgMgr;
+    std::shared_ptr<VulkanContext> context;
 
     vk::UniqueSurfaceKHR surface;
-    vk::PhysicalDevice physicalDevice;
 
-    GraphicsDevice graphicsDevice;
-    vk::Device     device; // not owner;
+    vk::PhysicalDevice physicalDevice; // not owner
+    vk::Device         device;         // not owner
 
     vk::UniqueSwapchainKHR swapchain;
 
     vk::SurfaceFormatKHR swapchainFormat;
     vk::Extent2D         swapchainExtent;
 
+    // swapchain images are created with eTransferSrc usage
+    bool swapchainReadable = false;
+    vk::PresentModeKHR   swapchainPresentMode = vk::PresentModeKHR::eFifo;
+
+    // clamped image count passed to the current swapchain
+    uint32_t swapchainRequestedImageCount = 0;
+
     std::vector<vk::Image>           swapchainImages;
     std::vector<vk::UniqueImageView> swapchainImageViews;
+
+    Window::DeferredDestroyer deferredDestroyer;
+
+    // deferred recreation
+
+    bool                swapchainDirty = false;
+    SwapchainStatistics swapchainStats;
+
+    // render thread mode
+
+    struct ThreadMessage
+    {
+        enum Type { Resize, Close };
+
+        Type type   = Resize;
+        int  width  = 0;
+        int  height = 0;
+    };
+
+    bool renderThreadMode = false;
+
+    SPSCQueue<ThreadMessage> threadMessages{ 256 };
+
+    std::atomic<bool> renderThreadExit = false;
+    std::atomic<bool> closeRequested   = false;
+
+    // latest framebuffer size received by the render thread
+    int threadFramebufferWidth  = 0;
+    int threadFramebufferHeight = 0;
+
+    // render on demand
+
+    std::atomic<bool> renderOnDemand = false;
+    std::atomic<bool> iconified      = false;
+
+    // guard redrawRequested/redrawDeadline. redrawCond is also notified
+    // when messages are sent to the render thread
+    std::mutex              redrawMutex;
+    std::condition_variable redrawCond;
+
+    bool              redrawRequested   = true;
+    bool              hasRedrawDeadline = false;
+    Clock::time_point redrawDeadline;
+
+    // windowed position/size before entering fullscreen
+
+    int windowedX = 0, windowedY = 0;
+    int windowedWidth = 0, windowedHeight = 0;
+
+    // present timing
+
+    struct PresentSample
+    {
+        float frameTime;
+        float acquireWait;
+        float presentLatency;
+    };
+
+    static constexpr size_t MAX_PRESENT_SAMPLES = 120;
+
+    std::vector<Clock::time_point> acquireTimes;
+    float                          lastAcquireWait = 0;
+    Clock::time_point              lastPresentTime;
+    bool                           hasPresented = false;
+    std::deque<PresentSample>      presentSamples;
 };
 
 namespace
 {
-    int glfwRefCounter = 0;
-
-    std::unordered_map<GLFWwindow *, Window *> glfwWindowToWindow;
+    std::unordered_map<GLFWwindow *, WindowImplData *> glfwWindowToWindow;
 
-    void glfwFramebufferResizeCallback(GLFWwindow *window, int width, int height)
+    void markSwapchainDirty(WindowImplData &data) noexcept
     {
-        auto it = glfwWindowToWindow.find(window);
-        if(it == glfwWindowToWindow.end())
-            return;
-        it->second->recreateSwapchain();
+        if(data.swapchainDirty)
+            ++data.swapchainStats.avoidedRecreations;
+        data.swapchainDirty = true;
     }
 
-    VKAPI_ATTR VkBool32 VKAPI_CALL vkDebugCallback(
-        VkDebugUtilsMessageSeverityFlagBitsEXT      severity,
-        VkDebugUtilsMessageTypeFlagsEXT             type,
-        const VkDebugUtilsMessengerCallbackDataEXT *callbackData,
-        void                                       *userData)
+    PresentPolicy resolvePresentPolicy(
+        const WindowImplData &data, PresentPolicy policy) noexcept
     {
-        std::cerr << callbackData->pMessage << std::endl;
-        return VK_FALSE;
+        if(policy != PresentPolicy::Default)
+            return policy;
+        return data.vsync ? PresentPolicy::VSync : PresentPolicy::NoVSync;
     }
 
-    vk::DebugUtilsMessengerCreateInfoEXT debugCreateInfo(
-        DebugMessageManager::Level level) noexcept
+    void requestRedraw(WindowImplData &data)
     {
-        vk::DebugUtilsMessageSeverityFlagsEXT severity;
-        switch(level)
         {
-        case DebugMessageManager::Level::Verbose:
-            severity = vk::DebugUtilsMessageSeverityFlagBitsEXT::eError   |
-                       vk::DebugUtilsMessageSeverityFlagBitsEXT::eWarning |
-                       vk::DebugUtilsMessageSeverityFlagBitsEXT::eInfo    |
-                       vk::DebugUtilsMessageSeverityFlagBitsEXT::eVerbose;
-            break;
-        case DebugMessageManager::Level::Infomation:
-            severity = vk::DebugUtilsMessageSeverityFlagBitsEXT::eError   |
-                       vk::DebugUtilsMessageSeverityFlagBitsEXT::eWarning |
-                       vk::DebugUtilsMessageSeverityFlagBitsEXT::eInfo;
-            break;
-        case DebugMessageManager::Level::Warning:
-            severity = vk::DebugUtilsMessageSeverityFlagBitsEXT::eError   |
-                       vk::DebugUtilsMessageSeverityFlagBitsEXT::eWarning;
-            break;
-        default:
-            severity = vk::DebugUtilsMessageSeverityFlagBitsEXT::eError;
-            break;
+            std::lock_guard lk(data.redrawMutex);
+            data.redrawRequested = true;
         }
-
-        const auto type = vk::DebugUtilsMessageTypeFlagBitsEXT::eGeneral |
-                          vk::DebugUtilsMessageTypeFlagBitsEXT::eValidation|
-                          vk::DebugUtilsMessageTypeFlagBitsEXT::ePerformance;
-
-        return vk::DebugUtilsMessengerCreateInfoEXT(
-            {}, severity, type, vkDebugCallback);
+        data.redrawCond.notify_all();
     }
 
-    vk::UniqueInstance createVkInstance(const WindowDesc &desc)
+    // called on main thread. returns false if the render thread has exited
+    bool pushThreadMessage(
+        WindowImplData &data, const WindowImplData::ThreadMessage &msg)
     {
-        // layers
-
-        if(desc.layers && !desc.layers->isAllSupported())
-            throw std::runtime_error("validation layer(s) unsupported");
-
-        // vk app info
-
-        vk::ApplicationInfo appInfo(
-            desc.title.c_str(),
-            VK_MAKE_VERSION(1, 0, 0),
-            desc.title.c_str(),
-            VK_MAKE_VERSION(1, 0, 0),
-            VK_API_VERSION_1_2);
+        while(!data.threadMessages.tryPush(msg))
+        {
+            if(data.renderThreadExit)
+                return false;
+            std::this_thread::yield();
+        }
 
-        // inst info
+        {
+            std::lock_guard lk(data.redrawMutex);
+        }
+        data.redrawCond.notify_all();
 
-        vk::InstanceCreateInfo instInfo;
-        instInfo.flags            = {};
-        instInfo.pApplicationInfo = &appInfo;
+        return true;
+    }
 
-        // validation layers
+    // called on render thread in render on demand mode. returns when a
+    // redraw is requested, the deadline is reached or a message arrives
+    void waitForRenderThreadWork(WindowImplData &data)
+    {
+        std::unique_lock lk(data.redrawMutex);
 
-        if(desc.layers)
+        auto pred = [&]
         {
-            if(!desc.layers->isAllSupported())
-                throw std::runtime_error("validation layer(s) unsupported");
-
-            const auto &layers = desc.layers->getLayers();
+            return data.redrawRequested || !data.threadMessages.empty();
+        };
 
-            instInfo.enabledLayerCount = static_cast<uint32_t>(layers.size());
-            instInfo.ppEnabledLayerNames = layers.data();
-        }
+        if(data.hasRedrawDeadline)
+            data.redrawCond.wait_until(lk, data.redrawDeadline, pred);
         else
-        {
-            instInfo.enabledLayerCount = 0;
-            instInfo.ppEnabledLayerNames = nullptr;
-        }
+            data.redrawCond.wait(lk, pred);
+    }
 
-        // debug message
+    // input/refresh callbacks. all of them request a redraw
 
-        vk::DebugUtilsMessengerCreateInfoEXT debugInfo;
+    void glfwRedrawCallback(GLFWwindow *window)
+    {
+        auto it = glfwWindowToWindow.find(window);
+        if(it != glfwWindowToWindow.end())
+            requestRedraw(*it->second);
+    }
 
-        if(desc.enableDebugMessage)
-        {
-            debugInfo = debugCreateInfo(desc.debugMsgLevel);
-            instInfo.pNext = &debugInfo;
-        }
-        else
-            instInfo.pNext = nullptr;
+    void glfwKeyCallback(GLFWwindow *window, int, int, int, int)
+    {
+        glfwRedrawCallback(window);
+    }
 
-        // extensions
+    void glfwMouseButtonCallback(GLFWwindow *window, int, int, int)
+    {
+        glfwRedrawCallback(window);
+    }
 
-        InstanceExtensionManager extsMgr;
+    void glfwCursorPosCallback(GLFWwindow *window, double, double)
+    {
+        glfwRedrawCallback(window);
+    }
 
-        if(desc.instanceExtensions)
-            extsMgr = *desc.instanceExtensions;
+    void glfwScrollCallback(GLFWwindow *window, double, double)
+    {
+        glfwRedrawCallback(window);
+    }
 
-        if(desc.enableDebugMessage)
-            extsMgr.add(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+    void glfwFocusCallback(GLFWwindow *window, int)
+    {
+        glfwRedrawCallback(window);
+    }
 
-        uint32_t glfwExtCount = 0;
-        const auto glfwExts = glfwGetRequiredInstanceExtensions(&glfwExtCount);
-        extsMgr.add(glfwExts, glfwExtCount);
+    void glfwIconifyCallback(GLFWwindow *window, int iconified)
+    {
+        auto it = glfwWindowToWindow.find(window);
+        if(it == glfwWindowToWindow.end())
+            return;
 
-        if(!extsMgr.isAllSupported())
-            throw std::runtime_error("extension(s) unsupported");
+        it->second->iconified = iconified == GLFW_TRUE;
+        requestRedraw(*it->second);
+    }
 
-        auto &exts = extsMgr.getExtensions();
-        instInfo.enabledExtensionCount = static_cast<uint32_t>(exts.size());
-        instInfo.ppEnabledExtensionNames = exts.data();
+    void glfwFramebufferResizeCallback(GLFWwindow *window, int width, int height)
+    {
+        auto it = glfwWindowToWindow.find(window);
+        if(it == glfwWindowToWindow.end())
+            return;
 
-        // create instance
+        auto &data = *it->second;
 
-        auto inst = createInstanceUnique(instInfo);
-        VULKAN_HPP_DEFAULT_DISPATCHER.init(inst.get());
+        requestRedraw(data);
 
-        return inst;
+        // the swapchain belongs to the render thread
+        if(data.renderThreadMode)
+        {
+            WindowImplData::ThreadMessage msg;
+            msg.type   = WindowImplData::ThreadMessage::Resize;
+            msg.width  = width;
+            msg.height = height;
+            pushThreadMessage(data, msg);
+            return;
+        }
+
+        // recreated at most once per frame in Window::doEvents
+        ++data.swapchainStats.resizeEventCount;
+        markSwapchainDirty(data);
     }
 
     struct SwapchainDesc
@@ -189,6 +279,7 @@ namespace
         uint32_t                   imageCount               = 0;
         vk::Extent2D               extent                   = {};
         bool                       clipped                  = true;
+        vk::SwapchainKHR           oldSwapchain             = nullptr;
     };
 
     vk::UniqueSwapchainKHR createVkSwapchain(
@@ -206,6 +297,11 @@ namespace
             1,
             vk::ImageUsageFlagBits::eColorAttachment);
 
+        // for Window::readbackSwapchainImage
+        if(desc.capabilities.supportedUsageFlags &
+           vk::ImageUsageFlagBits::eTransferSrc)
+            info.imageUsage |= vk::ImageUsageFlagBits::eTransferSrc;
+
         const uint32_t queueFamilyIndices[2] = {
             desc.graphicsQueueFamilyIndex,
             desc.presentQueueFamilyIndex
@@ -224,7 +320,7 @@ namespace
         info.compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eOpaque;
         info.presentMode    = desc.presentMode;
         info.clipped        = desc.clipped ? VK_TRUE : VK_FALSE;
-        info.oldSwapchain   = nullptr;
+        info.oldSwapchain   = desc.oldSwapchain;
 
         return device.createSwapchainKHRUnique(info);
     }
@@ -256,6 +352,25 @@ namespace
 
         return ret;
     }
+
+    void nameSwapchainObjects(
+        vk::Device                              device,
+        vk::SwapchainKHR                        swapchain,
+        const std::vector<vk::Image>           &images,
+        const std::vector<vk::UniqueImageView> &views)
+    {
+        if(!isDebugUtilsEnabled())
+            return;
+
+        setDebugName(device, swapchain, "swapchain");
+        for(size_t i = 0; i < images.size(); ++i)
+        {
+            const std::string index = std::to_string(i);
+            setDebugName(device, images[i], "swapchain image " + index);
+            setDebugName(
+                device, views[i].get(), "swapchain image view " + index);
+        }
+    }
 }
 
 WindowDesc &WindowDesc::setSize(int width, int height) noexcept
@@ -320,6 +435,13 @@ struct WindowDesc &WindowDesc::setDebugMessageLevel(
     return *this;
 }
 
+WindowDesc &WindowDesc::setDebugMessageLogger(
+    const DebugMessageLoggerDesc *desc) noexcept
+{
+    debugMsgLogger = desc;
+    return *this;
+}
+
 WindowDesc &WindowDesc::setLayers(ValidationLayerManager *layers) noexcept
 {
     this->layers = layers;
@@ -338,18 +460,66 @@ WindowDesc &WindowDesc::setDeviceExtensions(DeviceExtensionManager *exts) noexce
     return *this;
 }
 
+WindowDesc &WindowDesc::setDeviceFeatures(DeviceFeatureManager *features) noexcept
+{
+    deviceFeatures = features;
+    return *this;
+}
+
 WindowDesc &WindowDesc::setImageCount(uint32_t swapchainImageCount) noexcept
 {
     this->swapchainImageCount = swapchainImageCount;
     return *this;
 }
 
+WindowDesc &WindowDesc::setRenderOnDemand(bool enabled) noexcept
+{
+    renderOnDemand = enabled;
+    return *this;
+}
+
+WindowDesc &WindowDesc::setPhysicalDevice(std::string preferred) noexcept
+{
+    preferredPhysicalDevice = std::move(preferred);
+    return *this;
+}
+
+WindowDesc &WindowDesc::setLogPhysicalDevices(bool log) noexcept
+{
+    logPhysicalDevices = log;
+    return *this;
+}
+
+WindowDesc &WindowDesc::setHeadless(bool headless) noexcept
+{
+    this->headless = headless;
+    return *this;
+}
+
+WindowDesc &WindowDesc::setContext(std::shared_ptr<VulkanContext> context) noexcept
+{
+    this->context = std::move(context);
+    return *this;
+}
+
+WindowDesc &WindowDesc::setFramesInFlight(uint32_t framesInFlight) noexcept
+{
+    this->framesInFlight = framesInFlight;
+    return *this;
+}
+
 WindowDesc &WindowDesc::setObscuredPixels(bool enableClipping) noexcept
 {
     clipObscuredPixels = enableClipping;
     return *this;
 }
 
+WindowDesc &WindowDesc::setPresentPolicy(PresentPolicy policy) noexcept
+{
+    presentPolicy = policy;
+    return *this;
+}
+
 Window::~Window()
 {
     Destroy();
@@ -357,24 +527,59 @@ Window::~Window()
 
 void Window::Initialize(const WindowDesc &desc)
 {
-    // glfw initialization
+    const bool headless = desc.headless;
+
+    // vulkan context. created with the window if not shared
+
+    std::shared_ptr<VulkanContext> context = desc.context;
+    const bool ownContext = !context;
 
-    if(!glfwRefCounter)
+    if(ownContext)
     {
-        if(glfwInit() != GLFW_TRUE)
-            throw std::runtime_error("failed to initialize glfw");
+        VulkanContextDesc contextDesc;
+        contextDesc.appName                 = desc.title;
+        contextDesc.enableDebugMessage      = desc.enableDebugMessage;
+        contextDesc.debugMsgLevel           = desc.debugMsgLevel;
+        contextDesc.debugMsgLogger          = desc.debugMsgLogger;
+        contextDesc.layers                  = desc.layers;
+        contextDesc.instanceExtensions      = desc.instanceExtensions;
+        contextDesc.deviceExtensions        = desc.deviceExtensions;
+        contextDesc.deviceFeatures          = desc.deviceFeatures;
+        contextDesc.windowSurfaces          = !headless;
+        contextDesc.headlessSurfaces        = headless;
+        contextDesc.preferredPhysicalDevice = desc.preferredPhysicalDevice;
+        contextDesc.logPhysicalDevices      = desc.logPhysicalDevices;
+
+        context = std::make_shared<VulkanContext>();
+        context->InitializeInstance(contextDesc);
+    }
+    else
+    {
+        if(!context->IsAvailable())
+            throw std::runtime_error("shared vulkan context is not initialized");
+        if(headless && !context->isHeadlessSurfaceEnabled())
+            throw std::runtime_error("headless surfaces are not enabled");
+        if(!headless && !context->isWindowSurfaceEnabled())
+            throw std::runtime_error("window surfaces are not enabled");
+    }
 
-        vk::DynamicLoader dl;
-        PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr = dl.getProcAddress
-            <PFN_vkGetInstanceProcAddr>("vkGetInstanceProcAddr");
-        VULKAN_HPP_DEFAULT_DISPATCHER.init(vkGetInstanceProcAddr);
+    // swapchain functions are called through the default dispatcher
+
+    if(!context->isDefaultDispatcherBound())
+    {
+        throw std::runtime_error(
+            "the default dispatcher is bound to another vulkan context. "
+            "share it with WindowDesc::context");
     }
 
-    ++glfwRefCounter;
+    // glfw initialization. not used in headless mode
+
+    if(!headless)
+        acquireGlfw();
     misc::scope_guard_t glfwGuard([&]
     {
-        if(!--glfwRefCounter)
-            glfwTerminate();
+        if(!headless)
+            releaseGlfw();
     });
 
     // create WindowImplData
@@ -385,99 +590,113 @@ void Window::Initialize(const WindowDesc &desc)
         delete data_;
         data_ = nullptr;
     });
+    data_->context             = context;
+    data_->headless            = headless;
+    data_->headlessWidth       = desc.width;
+    data_->headlessHeight      = desc.height;
     data_->swapchainImageCount = desc.swapchainImageCount;
     data_->clipObscuredPixels   = desc.clipObscuredPixels;
+    data_->framesInFlight       = desc.framesInFlight;
+    data_->renderOnDemand       = desc.renderOnDemand;
+    data_->vsync                = desc.vsync;
 
-    // create glfw window
+    data_->presentPolicy = resolvePresentPolicy(*data_, desc.presentPolicy);
 
-    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    glfwWindowHint(GLFW_RESIZABLE, desc.resizable ? GLFW_TRUE : GLFW_FALSE);
-    glfwWindowHint(GLFW_MAXIMIZED, desc.maximized ? GLFW_TRUE : GLFW_FALSE);
-
-    const auto monitor = desc.fullscreen ? glfwGetPrimaryMonitor() : nullptr;
+    // create glfw window
 
-    data_->glfwWindow = glfwCreateWindow(
-        desc.width, desc.height, desc.title.c_str(), monitor, nullptr);
-    if(!data_->glfwWindow)
-        throw std::runtime_error("failed to create glfw window");
-    glfwWindowToWindow[data_->glfwWindow] = this;
-    misc::scope_guard_t windowGuard([&]
+    if(!headless)
     {
-        glfwWindowToWindow.erase(data_->glfwWindow);
-        glfwDestroyWindow(data_->glfwWindow);
-    });
-
-    glfwSetFramebufferSizeCallback(
-        data_->glfwWindow, glfwFramebufferResizeCallback);
-
-    // instance
-
-    data_->instance = createVkInstance(desc);
-
-    misc::scope_guard_t instanceGuard([&]
+        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+        glfwWindowHint(GLFW_RESIZABLE, desc.resizable ? GLFW_TRUE : GLFW_FALSE);
+        glfwWindowHint(GLFW_MAXIMIZED, desc.maximized ? GLFW_TRUE : GLFW_FALSE);
+
+        const auto monitor =
+            desc.fullscreen ? glfwGetPrimaryMonitor() : nullptr;
+
+        data_->glfwWindow = glfwCreateWindow(
+            desc.width, desc.height, desc.title.c_str(), monitor, nullptr);
+        if(!data_->glfwWindow)
+            throw std::runtime_error("failed to create glfw window");
+        data_->windowedX      = 64;
+        data_->windowedY      = 64;
+        data_->windowedWidth  = desc.width;
+        data_->windowedHeight = desc.height;
+        glfwWindowToWindow[data_->glfwWindow] = data_;
+    }
+    misc::scope_guard_t windowGuard([&]
     {
-        data_->instance.reset();
+        if(data_->glfwWindow)
+        {
+            glfwWindowToWindow.erase(data_->glfwWindow);
+            glfwDestroyWindow(data_->glfwWindow);
+        }
     });
 
-    // debug message manager
-
-    if(desc.enableDebugMessage)
+    if(!headless)
     {
-        data_->debugMsgMgr = std::make_unique<DebugMessageManager>(
-            data_->instance.get(), desc.debugMsgLevel);
+        glfwSetFramebufferSizeCallback(
+            data_->glfwWindow, glfwFramebufferResizeCallback);
+        glfwSetWindowRefreshCallback(data_->glfwWindow, glfwRedrawCallback);
+        glfwSetKeyCallback(data_->glfwWindow, glfwKeyCallback);
+        glfwSetMouseButtonCallback(data_->glfwWindow, glfwMouseButtonCallback);
+        glfwSetCursorPosCallback(data_->glfwWindow, glfwCursorPosCallback);
+        glfwSetScrollCallback(data_->glfwWindow, glfwScrollCallback);
+        glfwSetWindowFocusCallback(data_->glfwWindow, glfwFocusCallback);
+        glfwSetWindowIconifyCallback(data_->glfwWindow, glfwIconifyCallback);
     }
-    misc::scope_guard_t debugGuard([&]
-    {
-        data_->debugMsgMgr.reset();
-    });
 
     // framebuffer size
 
     int framebufferWidth, framebufferHeight;
-    glfwGetFramebufferSize(
-        data_->glfwWindow, &framebufferWidth, &framebufferHeight);
+    if(headless)
+    {
+        framebufferWidth  = desc.width;
+        framebufferHeight = desc.height;
+    }
+    else
+    {
+        glfwGetFramebufferSize(
+            data_->glfwWindow, &framebufferWidth, &framebufferHeight);
+    }
 
     // window surface
 
-    VkSurfaceKHR surface;
-    if(auto rt = glfwCreateWindowSurface(
-        data_->instance.get(), data_->glfwWindow, nullptr, &surface);
-        rt != VK_SUCCESS)
+    const vk::Instance instance = context->getInstance();
+
+    if(headless)
     {
-        throw std::runtime_error("failed to create window surface. VkResult: "
-                                + std::to_string(rt));
+        data_->surface = instance.createHeadlessSurfaceEXTUnique(
+            vk::HeadlessSurfaceCreateInfoEXT{});
     }
+    else
+    {
+        VkSurfaceKHR surface;
+        if(auto rt = glfwCreateWindowSurface(
+            instance, data_->glfwWindow, nullptr, &surface);
+            rt != VK_SUCCESS)
+        {
+            throw std::runtime_error(
+                "failed to create window surface. VkResult: "
+                + std::to_string(rt));
+        }
 
-    data_->surface = vk::UniqueSurfaceKHR(surface, data_->instance.get());
+        data_->surface = vk::UniqueSurfaceKHR(surface, instance);
+    }
     misc::scope_guard_t surfaceGuard([&]
     {
         data_->surface.reset();
     });
 
-    // physical device
-
-    const auto graphicsPhysicalDevices = getAllPhysicalDevices(
-        data_->instance.get(), [&](vk::PhysicalDevice physicalDevice)
-    {
-        return IsGraphicsPhysicalDevice(
-            physicalDevice, data_->surface.get(), desc.deviceExtensions);
-    });
-
-    if(graphicsPhysicalDevices.empty())
-        throw std::runtime_error("graphics physical device not found");
+    // physical device & graphics device. an owned context selects one
+    // presenting to this surface; a shared one must already support it
 
-    data_->physicalDevice = graphicsPhysicalDevices[0];
+    if(ownContext)
+        context->InitializeDevice(data_->surface.get());
+    else if(!context->canPresent(data_->surface.get()))
+        throw std::runtime_error("shared device cannot present to window");
 
-    // graphics device & queues
-
-    data_->graphicsDevice.Initialize(
-        data_->physicalDevice, data_->surface.get(), desc.deviceExtensions);
-    data_->device = data_->graphicsDevice.device();
-    misc::scope_guard_t deviceGuard([&]
-    {
-        data_->graphicsDevice.Destroy();
-        data_->device = nullptr;
-    });
+    data_->physicalDevice = context->getPhysicalDevice();
+    data_->device         = context->getDevice();
 
     // swapchain
 
@@ -486,14 +705,14 @@ void Window::Initialize(const WindowDesc &desc)
     const auto scFormat = swapchainProperty.chooseFormat(
         { { vk::Format::eB8G8R8A8Srgb, vk::ColorSpaceKHR::eSrgbNonlinear } });
     const auto scPresentMode = swapchainProperty.choosePresentMode(
-        { vk::PresentModeKHR::eMailbox });
+        getPreferredPresentModes(data_->presentPolicy));
     const auto scExtent = swapchainProperty.chooseExtent(
         { static_cast<uint32_t>(framebufferWidth),
           static_cast<uint32_t>(framebufferHeight) });
     const uint32_t scGraphicsQueueFamilyIndex =
-        data_->graphicsDevice.graphicsQueueFamilyIndex();
+        context->getGraphicsDevice().graphicsQueueFamilyIndex();
     const uint32_t scPresentQueueFamilyIndex =
-        data_->graphicsDevice.presentQueueFamilyIndex();
+        context->getGraphicsDevice().presentQueueFamilyIndex();
 
     SwapchainDesc scDesc = {};
     scDesc.capabilities             = swapchainProperty.capabilities;
@@ -501,14 +720,21 @@ void Window::Initialize(const WindowDesc &desc)
     scDesc.presentMode              = scPresentMode;
     scDesc.graphicsQueueFamilyIndex = scGraphicsQueueFamilyIndex;
     scDesc.presentQueueFamilyIndex  = scPresentQueueFamilyIndex;
-    scDesc.imageCount               = desc.swapchainImageCount;
+    scDesc.imageCount               = swapchainProperty.chooseImageCount(
+                                          desc.swapchainImageCount);
     scDesc.extent                   = scExtent;
     scDesc.clipped                  = desc.clipObscuredPixels;
 
     data_->swapchain = createVkSwapchain(
         data_->device, data_->surface.get(), scDesc);
-    data_->swapchainExtent = scDesc.extent;
-    data_->swapchainFormat = scDesc.format;
+    data_->swapchainExtent      = scDesc.extent;
+    data_->swapchainFormat      = scDesc.format;
+    data_->swapchainPresentMode = scDesc.presentMode;
+    data_->swapchainReadable    = static_cast<bool>(
+        scDesc.capabilities.supportedUsageFlags &
+        vk::ImageUsageFlagBits::eTransferSrc);
+
+    data_->swapchainRequestedImageCount = scDesc.imageCount;
     misc::scope_guard_t swapchainGuard([&]
     {
         data_->swapchain.reset();
@@ -523,6 +749,9 @@ void Window::Initialize(const WindowDesc &desc)
 
     data_->swapchainImageViews = createSwapchainImageViews(
         data_->device, data_->swapchainFormat.format, data_->swapchainImages);
+    nameSwapchainObjects(
+        data_->device, data_->swapchain.get(),
+        data_->swapchainImages, data_->swapchainImageViews);
     misc::scope_guard_t imgViewGuard([&]
     {
         data_->swapchainImageViews.clear();
@@ -530,10 +759,7 @@ void Window::Initialize(const WindowDesc &desc)
 
     imgViewGuard  .dismiss();
     swapchainGuard.dismiss();
-    deviceGuard   .dismiss();
     surfaceGuard  .dismiss();
-    debugGuard    .dismiss();
-    instanceGuard .dismiss();
     windowGuard   .dismiss();
     dataGuard     .dismiss();
     glfwGuard     .dismiss();
@@ -544,6 +770,11 @@ bool Window::IsAvailable() const noexcept
     return data_ != nullptr;
 }
 
+bool Window::isHeadless() const noexcept
+{
+    return data_->headless;
+}
+
 void Window::Destroy()
 {
     if(!data_)
@@ -553,41 +784,291 @@ void Window::Destroy()
 
     data_->swapchain.reset();
 
-    data_->debugMsgMgr.reset();
-
     data_->surface.reset();
 
-    data_->graphicsDevice.Destroy();
+    // destroys the context if not shared with other windows
+    data_->context.reset();
 
-    data_->instance.reset();
+    const bool headless = data_->headless;
 
-    glfwWindowToWindow.erase(data_->glfwWindow);
-    glfwDestroyWindow(data_->glfwWindow);
+    if(data_->glfwWindow)
+    {
+        glfwWindowToWindow.erase(data_->glfwWindow);
+        glfwDestroyWindow(data_->glfwWindow);
+    }
 
     delete data_;
+    data_ = nullptr;
 
-    if(!--glfwRefCounter)
-        glfwTerminate();
+    if(!headless)
+        releaseGlfw();
 }
 
 void Window::doEvents()
 {
-    glfwPollEvents();
+    AGZ_VLAB_TRACE_SCOPE("doEvents");
+
+    bool wait = false;
+    double timeout = -1;
+
+    if(data_->renderOnDemand)
+    {
+        std::lock_guard lk(data_->redrawMutex);
+        if(!data_->redrawRequested)
+        {
+            wait = true;
+            if(data_->hasRedrawDeadline)
+            {
+                const auto now = WindowImplData::Clock::now();
+                timeout = (std::max)(0.0, std::chrono::duration<double>(
+                    data_->redrawDeadline - now).count());
+            }
+        }
+    }
+
+    if(data_->headless)
+    {
+        // only timers and explicit requests can wake up a headless window
+        if(wait)
+        {
+            std::unique_lock lk(data_->redrawMutex);
+            auto pred = [&]
+            {
+                return data_->redrawRequested || data_->closeRequested;
+            };
+            if(timeout < 0)
+                data_->redrawCond.wait(lk, pred);
+            else
+            {
+                data_->redrawCond.wait_for(
+                    lk, std::chrono::duration<double>(timeout), pred);
+            }
+        }
+    }
+    else
+    {
+        if(!wait)
+            glfwPollEvents();
+        else if(timeout < 0)
+            glfwWaitEvents();
+        else
+            glfwWaitEventsTimeout(timeout);
+
+        // nothing is visible while iconified
+        while(data_->iconified && !glfwWindowShouldClose(data_->glfwWindow))
+            glfwWaitEvents();
+    }
+
+    if(data_->swapchainDirty)
+        recreateSwapchain();
+}
+
+void Window::setRenderOnDemand(bool enabled)
+{
+    data_->renderOnDemand = enabled;
+    requestRedraw();
+}
+
+bool Window::isRenderOnDemand() const noexcept
+{
+    return data_->renderOnDemand;
+}
+
+void Window::requestRedraw()
+{
+    agz::vlab::requestRedraw(*data_);
+    if(!data_->headless)
+        glfwPostEmptyEvent();
+}
+
+void Window::requestRedrawAfter(double seconds)
+{
+    const auto deadline = WindowImplData::Clock::now() +
+        std::chrono::duration_cast<WindowImplData::Clock::duration>(
+            std::chrono::duration<double>(seconds));
+
+    {
+        std::lock_guard lk(data_->redrawMutex);
+        if(!data_->hasRedrawDeadline || deadline < data_->redrawDeadline)
+        {
+            data_->hasRedrawDeadline = true;
+            data_->redrawDeadline    = deadline;
+        }
+    }
+    data_->redrawCond.notify_all();
+}
+
+bool Window::consumeRedrawRequest()
+{
+    if(!data_->renderOnDemand)
+        return true;
+
+    std::lock_guard lk(data_->redrawMutex);
+
+    if(data_->redrawRequested)
+    {
+        data_->redrawRequested = false;
+        return true;
+    }
+
+    if(data_->hasRedrawDeadline &&
+       WindowImplData::Clock::now() >= data_->redrawDeadline)
+    {
+        data_->hasRedrawDeadline = false;
+        return true;
+    }
+
+    return false;
+}
+
+void Window::runRenderThread(const std::function<void()> &frameFunc)
+{
+    assert(!data_->renderThreadMode);
+
+    // no os events to process. render on the calling thread
+    if(data_->headless)
+    {
+        while(!getCloseFlag())
+        {
+            doEvents();
+            if(consumeRedrawRequest())
+                frameFunc();
+        }
+        send(WindowCloseEvent{});
+        return;
+    }
+
+    glfwGetFramebufferSize(
+        data_->glfwWindow,
+        &data_->threadFramebufferWidth, &data_->threadFramebufferHeight);
+
+    data_->renderThreadMode = true;
+    data_->renderThreadExit = false;
+    data_->closeRequested   = false;
+
+    std::exception_ptr renderException;
+
+    std::thread renderThread([&]
+    {
+        CpuTracer::setThreadName("render thread");
+
+        try
+        {
+            for(;;)
+            {
+                WindowImplData::ThreadMessage msg;
+                while(data_->threadMessages.tryPop(msg))
+                {
+                    if(msg.type == WindowImplData::ThreadMessage::Close)
+                        data_->closeRequested = true;
+                    else
+                    {
+                        data_->threadFramebufferWidth  = msg.width;
+                        data_->threadFramebufferHeight = msg.height;
+                        ++data_->swapchainStats.resizeEventCount;
+                        markSwapchainDirty();
+                    }
+                }
+
+                if(data_->closeRequested)
+                    break;
+
+                // minimized. wait for next resize
+                if(data_->iconified ||
+                   !data_->threadFramebufferWidth ||
+                   !data_->threadFramebufferHeight)
+                {
+                    std::unique_lock lk(data_->redrawMutex);
+                    data_->redrawCond.wait_for(
+                        lk, std::chrono::milliseconds(100), [&]
+                    {
+                        return !data_->threadMessages.empty();
+                    });
+                    continue;
+                }
+
+                if(data_->swapchainDirty)
+                    recreateSwapchain();
+
+                if(!consumeRedrawRequest())
+                {
+                    waitForRenderThreadWork(*data_);
+                    continue;
+                }
+
+                frameFunc();
+            }
+
+            send(WindowCloseEvent{});
+        }
+        catch(...)
+        {
+            renderException = std::current_exception();
+        }
+
+        data_->renderThreadExit = true;
+        glfwPostEmptyEvent();
+    });
+
+    while(!data_->renderThreadExit)
+    {
+        glfwWaitEvents();
+
+        if(glfwWindowShouldClose(data_->glfwWindow))
+        {
+            WindowImplData::ThreadMessage msg;
+            msg.type = WindowImplData::ThreadMessage::Close;
+            pushThreadMessage(*data_, msg);
+            break;
+        }
+    }
+
+    renderThread.join();
+
+    // drop messages not consumed by the render thread
+
+    WindowImplData::ThreadMessage msg;
+    while(data_->threadMessages.tryPop(msg))
+        ;
+
+    data_->renderThreadMode = false;
+    if(data_->closeRequested)
+        glfwSetWindowShouldClose(data_->glfwWindow, GLFW_TRUE);
+
+    if(renderException)
+        std::rethrow_exception(renderException);
+}
+
+bool Window::isRenderThreadMode() const noexcept
+{
+    return data_->renderThreadMode;
 }
 
 bool Window::getCloseFlag() const
 {
+    if(data_->renderThreadMode || data_->headless)
+        return data_->closeRequested;
     return glfwWindowShouldClose(data_->glfwWindow);
 }
 
 void Window::setCloseFlag(bool close)
 {
+    // glfwSetWindowShouldClose is applied by the main thread on exit
+    if(data_->renderThreadMode || data_->headless)
+    {
+        {
+            std::lock_guard lk(data_->redrawMutex);
+            data_->closeRequested = close;
+        }
+        data_->redrawCond.notify_all();
+        return;
+    }
     glfwSetWindowShouldClose(data_->glfwWindow, close);
 }
 
 vk::Instance Window::getInstance() const noexcept
 {
-    return data_->instance.get();
+    return data_->context->getInstance();
 }
 
 vk::PhysicalDevice Window::getPhysicalDevice() const noexcept
@@ -597,29 +1078,50 @@ vk::PhysicalDevice Window::getPhysicalDevice() const noexcept
 
 DebugMessageManager *Window::getDebugMsgMgr() const
 {
-    if(!data_->debugMsgMgr)
+    auto debugMsgMgr = data_->context->getDebugMsgMgr();
+    if(!debugMsgMgr)
         throw std::runtime_error("debug message is not enabled");
-    return data_->debugMsgMgr.get();
+    return debugMsgMgr;
 }
 
 GraphicsDevice &Window::getGraphicsDevice() const noexcept
 {
-    return data_->graphicsDevice;
+    return data_->context->getGraphicsDevice();
+}
+
+VulkanContext &Window::getContext() const noexcept
+{
+    return *data_->context;
+}
+
+const std::shared_ptr<VulkanContext> &Window::getSharedContext() const noexcept
+{
+    return data_->context;
 }
 
 vk::Queue Window::getGraphicsQueue() const noexcept
 {
-    return data_->graphicsDevice.graphicsQueue();
+    return data_->context->getGraphicsDevice().graphicsQueue();
 }
 
 vk::Queue Window::getPresentQueue() const noexcept
 {
-    return data_->graphicsDevice.presentQueue();
+    return data_->context->getGraphicsDevice().presentQueue();
+}
+
+vk::Queue Window::getComputeQueue() const noexcept
+{
+    return data_->context->getGraphicsDevice().computeQueue();
+}
+
+vk::Queue Window::getTransferQueue() const noexcept
+{
+    return data_->context->getGraphicsDevice().transferQueue();
 }
 
 vk::Device Window::getDevice() const noexcept
 {
-    return data_->graphicsDevice.device();
+    return data_->context->getGraphicsDevice().device();
 }
 
 vk::SwapchainKHR Window::getSwapchain() const noexcept
@@ -657,45 +1159,159 @@ uint32_t Window::getSwapchainImageCount() const noexcept
 vk::ResultValue<uint32_t> Window::acquireNextImage(
     uint64_t timeout, vk::Semaphore semaphore, vk::Fence fence) const
 {
-    return data_->device.acquireNextImageKHR(
-        data_->swapchain.get(), timeout, semaphore, fence);
+    AGZ_VLAB_TRACE_SCOPE("acquireNextImage");
+
+    const auto start = WindowImplData::Clock::now();
+
+    uint32_t imageIndex = 0;
+    const auto result = data_->device.acquireNextImageKHR(
+        data_->swapchain.get(), timeout, semaphore, fence, &imageIndex);
+    const vk::ResultValue<uint32_t> ret(result, imageIndex);
+
+    const auto end = WindowImplData::Clock::now();
+
+    if(result == vk::Result::eSuboptimalKHR)
+    {
+        ++data_->swapchainStats.suboptimalCount;
+        markSwapchainDirty();
+    }
+    else if(result == vk::Result::eErrorOutOfDateKHR)
+    {
+        ++data_->swapchainStats.outOfDateCount;
+        markSwapchainDirty();
+    }
+
+    if(ret.result == vk::Result::eSuccess ||
+       ret.result == vk::Result::eSuboptimalKHR)
+    {
+        data_->acquireTimes.resize(data_->swapchainImages.size());
+        data_->acquireTimes[ret.value] = end;
+        data_->lastAcquireWait =
+            std::chrono::duration<float, std::milli>(end - start).count();
+    }
+
+    return ret;
+}
+
+vk::Result Window::present(
+    uint32_t imageIndex, vk::ArrayProxy<const vk::Semaphore> waitSemaphores)
+{
+    AGZ_VLAB_TRACE_SCOPE("present");
+
+    vk::SwapchainKHR swapchain = data_->swapchain.get();
+
+    vk::PresentInfoKHR presentInfo;
+    presentInfo
+        .setWaitSemaphoreCount(waitSemaphores.size())
+        .setPWaitSemaphores(waitSemaphores.data())
+        .setSwapchainCount(1)
+        .setPSwapchains(&swapchain)
+        .setPImageIndices(&imageIndex);
+
+    const auto result = data_->context->getGraphicsDevice().presentQueue().presentKHR(
+        &presentInfo);
+
+    if(result == vk::Result::eSuboptimalKHR)
+    {
+        ++data_->swapchainStats.suboptimalCount;
+        markSwapchainDirty();
+    }
+    else if(result == vk::Result::eErrorOutOfDateKHR)
+    {
+        ++data_->swapchainStats.outOfDateCount;
+        markSwapchainDirty();
+    }
+
+    // timing
+
+    using Ms = std::chrono::duration<float, std::milli>;
+
+    const auto now = WindowImplData::Clock::now();
+
+    if(data_->hasPresented && imageIndex < data_->acquireTimes.size())
+    {
+        WindowImplData::PresentSample sample;
+        sample.frameTime      = Ms(now - data_->lastPresentTime).count();
+        sample.acquireWait    = data_->lastAcquireWait;
+        sample.presentLatency =
+            Ms(now - data_->acquireTimes[imageIndex]).count();
+
+        data_->presentSamples.push_back(sample);
+        if(data_->presentSamples.size() > WindowImplData::MAX_PRESENT_SAMPLES)
+            data_->presentSamples.pop_front();
+    }
+
+    data_->lastPresentTime = now;
+    data_->hasPresented    = true;
+
+    return result;
 }
 
 void Window::recreateSwapchain()
 {
     int framebufferWidth, framebufferHeight;
-    glfwGetFramebufferSize(
-        data_->glfwWindow, &framebufferWidth, &framebufferHeight);
-    while(framebufferWidth == 0 || framebufferHeight == 0)
+
+    if(data_->headless)
+    {
+        framebufferWidth  = data_->headlessWidth;
+        framebufferHeight = data_->headlessHeight;
+    }
+    else if(data_->renderThreadMode)
+    {
+        // glfw window functions are restricted to the main thread
+        framebufferWidth  = data_->threadFramebufferWidth;
+        framebufferHeight = data_->threadFramebufferHeight;
+        if(framebufferWidth == 0 || framebufferHeight == 0)
+            return;
+    }
+    else
     {
         glfwGetFramebufferSize(
             data_->glfwWindow, &framebufferWidth, &framebufferHeight);
-        glfwWaitEvents();
+        while(framebufferWidth == 0 || framebufferHeight == 0)
+        {
+            glfwGetFramebufferSize(
+                data_->glfwWindow, &framebufferWidth, &framebufferHeight);
+            glfwWaitEvents();
+        }
     }
 
+    data_->swapchainDirty = false;
+    ++data_->swapchainStats.recreateCount;
+
     // pre recreation
 
     send(WindowPreRecreateSwapchainEvent{});
 
-    data_->device.waitIdle();
+    // images of the old swapchain may still be rendered to or presented
+    // by frames in flight. keep them alive until those frames retire
+
+    struct RetiredSwapchain
+    {
+        vk::UniqueSwapchainKHR           swapchain;
+        std::vector<vk::UniqueImageView> imageViews;
+    };
+
+    auto retired = std::make_shared<RetiredSwapchain>();
+    retired->swapchain  = std::move(data_->swapchain);
+    retired->imageViews = std::move(data_->swapchainImageViews);
 
     data_->swapchainImageViews.clear();
     data_->swapchainImages.clear();
-    data_->swapchain.reset();
 
     const auto swapchainProperty = querySwapchainProperty(
         data_->physicalDevice, data_->surface.get());
     const auto scFormat = swapchainProperty.chooseFormat(
         { { vk::Format::eB8G8R8A8Srgb, vk::ColorSpaceKHR::eSrgbNonlinear } });
     const auto scPresentMode = swapchainProperty.choosePresentMode(
-        { vk::PresentModeKHR::eMailbox });
+        getPreferredPresentModes(data_->presentPolicy));
     const auto scExtent = swapchainProperty.chooseExtent(
         { static_cast<uint32_t>(framebufferWidth),
           static_cast<uint32_t>(framebufferHeight) });
     const uint32_t scGraphicsQueueFamilyIndex =
-        data_->graphicsDevice.graphicsQueueFamilyIndex();
+        data_->context->getGraphicsDevice().graphicsQueueFamilyIndex();
     const uint32_t scPresentQueueFamilyIndex =
-        data_->graphicsDevice.presentQueueFamilyIndex();
+        data_->context->getGraphicsDevice().presentQueueFamilyIndex();
     
     SwapchainDesc scDesc;
     scDesc.capabilities             = swapchainProperty.capabilities;
@@ -703,14 +1319,22 @@ void Window::recreateSwapchain()
     scDesc.presentMode              = scPresentMode;
     scDesc.graphicsQueueFamilyIndex = scGraphicsQueueFamilyIndex;
     scDesc.presentQueueFamilyIndex  = scPresentQueueFamilyIndex;
-    scDesc.imageCount               = data_->swapchainImageCount;
+    scDesc.imageCount               = swapchainProperty.chooseImageCount(
+                                          data_->swapchainImageCount);
     scDesc.extent                   = scExtent;
     scDesc.clipped                  = data_->clipObscuredPixels;
+    scDesc.oldSwapchain             = retired->swapchain.get();
 
     data_->swapchain = createVkSwapchain(
         data_->device, data_->surface.get(), scDesc);
-    data_->swapchainExtent = scDesc.extent;
-    data_->swapchainFormat = scDesc.format;
+    data_->swapchainExtent      = scDesc.extent;
+    data_->swapchainFormat      = scDesc.format;
+    data_->swapchainPresentMode = scDesc.presentMode;
+    data_->swapchainReadable    = static_cast<bool>(
+        scDesc.capabilities.supportedUsageFlags &
+        vk::ImageUsageFlagBits::eTransferSrc);
+
+    data_->swapchainRequestedImageCount = scDesc.imageCount;
 
     // swapchain images
 
@@ -721,6 +1345,28 @@ void Window::recreateSwapchain()
 
     data_->swapchainImageViews = createSwapchainImageViews(
         data_->device, data_->swapchainFormat.format, data_->swapchainImages);
+    nameSwapchainObjects(
+        data_->device, data_->swapchain.get(),
+        data_->swapchainImages, data_->swapchainImageViews);
+
+    // release the old swapchain
+
+    if(data_->deferredDestroyer)
+    {
+        data_->deferredDestroyer([retired]
+        {
+            retired->imageViews.clear();
+            retired->swapchain.reset();
+        });
+    }
+    else
+    {
+        data_->context->getGraphicsDevice().graphicsQueue().waitIdle();
+        data_->context->getGraphicsDevice().presentQueue().waitIdle();
+
+        retired->imageViews.clear();
+        retired->swapchain.reset();
+    }
 
     // post recreation
 
@@ -730,4 +1376,289 @@ void Window::recreateSwapchain()
     });
 }
 
+void Window::setSwapchainImageCount(uint32_t imageCount)
+{
+    const auto swapchainProperty = querySwapchainProperty(
+        data_->physicalDevice, data_->surface.get());
+    imageCount = swapchainProperty.chooseImageCount(imageCount);
+
+    data_->swapchainImageCount = static_cast<int>(imageCount);
+
+    // the driver may create more images than requested, so compare with
+    // the previously requested count instead of the actual one
+    if(imageCount != data_->swapchainRequestedImageCount)
+    {
+        data_->swapchainRequestedImageCount = imageCount;
+        markSwapchainDirty();
+    }
+}
+
+void Window::setFramePacing(uint32_t framesInFlight, uint32_t imageCount)
+{
+    assert(framesInFlight > 0);
+
+    setSwapchainImageCount(imageCount);
+    data_->framesInFlight = framesInFlight;
+
+    send(WindowFramePacingEvent{
+        framesInFlight,
+        static_cast<uint32_t>(data_->swapchainImageCount)
+    });
+}
+
+uint32_t Window::getFramesInFlight() const noexcept
+{
+    return data_->framesInFlight;
+}
+
+void Window::markSwapchainDirty() const
+{
+    agz::vlab::markSwapchainDirty(*data_);
+}
+
+bool Window::isSwapchainDirty() const noexcept
+{
+    return data_->swapchainDirty;
+}
+
+const SwapchainStatistics &Window::getSwapchainStatistics() const noexcept
+{
+    return data_->swapchainStats;
+}
+
+void Window::setDeferredDestroyer(DeferredDestroyer destroyer)
+{
+    data_->deferredDestroyer = std::move(destroyer);
+}
+
+void Window::setFullscreen(bool fullscreen)
+{
+    if(data_->headless || fullscreen == isFullscreen())
+        return;
+
+    if(fullscreen)
+    {
+        glfwGetWindowPos(
+            data_->glfwWindow, &data_->windowedX, &data_->windowedY);
+        glfwGetWindowSize(
+            data_->glfwWindow,
+            &data_->windowedWidth, &data_->windowedHeight);
+
+        const auto monitor = glfwGetPrimaryMonitor();
+        const auto mode    = glfwGetVideoMode(monitor);
+
+        glfwSetWindowMonitor(
+            data_->glfwWindow, monitor, 0, 0,
+            mode->width, mode->height, mode->refreshRate);
+    }
+    else
+    {
+        glfwSetWindowMonitor(
+            data_->glfwWindow, nullptr,
+            data_->windowedX, data_->windowedY,
+            data_->windowedWidth, data_->windowedHeight, GLFW_DONT_CARE);
+    }
+}
+
+bool Window::isFullscreen() const noexcept
+{
+    return data_->glfwWindow &&
+           glfwGetWindowMonitor(data_->glfwWindow) != nullptr;
+}
+
+void Window::setPresentPolicy(PresentPolicy policy)
+{
+    policy = resolvePresentPolicy(*data_, policy);
+
+    if(policy == data_->presentPolicy)
+        return;
+    data_->presentPolicy = policy;
+
+    const auto swapchainProperty = querySwapchainProperty(
+        data_->physicalDevice, data_->surface.get());
+    const auto presentMode = swapchainProperty.choosePresentMode(
+        getPreferredPresentModes(policy));
+
+    if(presentMode != data_->swapchainPresentMode)
+    {
+        markSwapchainDirty();
+        resetPresentStatistics();
+    }
+}
+
+PresentPolicy Window::getPresentPolicy() const noexcept
+{
+    return data_->presentPolicy;
+}
+
+vk::PresentModeKHR Window::getPresentMode() const noexcept
+{
+    return data_->swapchainPresentMode;
+}
+
+PresentStatistics Window::getPresentStatistics() const
+{
+    PresentStatistics ret;
+
+    auto &samples = data_->presentSamples;
+    if(samples.empty())
+        return ret;
+
+    ret.sampleCount  = static_cast<uint32_t>(samples.size());
+    ret.minFrameTime = samples.front().frameTime;
+
+    for(auto &s : samples)
+    {
+        ret.avgFrameTime      += s.frameTime;
+        ret.minFrameTime       = (std::min)(ret.minFrameTime, s.frameTime);
+        ret.maxFrameTime       = (std::max)(ret.maxFrameTime, s.frameTime);
+        ret.avgAcquireWait    += s.acquireWait;
+        ret.avgPresentLatency += s.presentLatency;
+        ret.maxPresentLatency  =
+            (std::max)(ret.maxPresentLatency, s.presentLatency);
+    }
+
+    const float ratio = 1.0f / ret.sampleCount;
+    ret.avgFrameTime      *= ratio;
+    ret.avgAcquireWait    *= ratio;
+    ret.avgPresentLatency *= ratio;
+
+    if(ret.avgFrameTime > 0)
+        ret.fps = 1000.0f / ret.avgFrameTime;
+
+    return ret;
+}
+
+void Window::resetPresentStatistics()
+{
+    data_->presentSamples.clear();
+    data_->hasPresented = false;
+}
+
+std::vector<uint8_t> Window::readbackSwapchainImage(
+    uint32_t imageIndex, vk::ImageLayout currentLayout) const
+{
+    assert(imageIndex < data_->swapchainImages.size());
+
+    if(!data_->swapchainReadable)
+        throw std::runtime_error("swapchain image is not readable");
+
+    const vk::Image    image  = data_->swapchainImages[imageIndex];
+    const vk::Extent2D extent = data_->swapchainExtent;
+
+    // swapchain formats are 4 bytes per texel except for 64-bit hdr ones
+
+    const vk::Format format = data_->swapchainFormat.format;
+    const uint32_t texelSize =
+        format == vk::Format::eR16G16B16A16Sfloat ? 8 : 4;
+    const vk::DeviceSize size =
+        vk::DeviceSize(extent.width) * extent.height * texelSize;
+
+    // host visible buffer
+
+    auto buffer = data_->device.createBufferUnique(vk::BufferCreateInfo(
+        {}, size, vk::BufferUsageFlagBits::eTransferDst,
+        vk::SharingMode::eExclusive));
+
+    const auto memReqs  = data_->device.getBufferMemoryRequirements(*buffer);
+    const auto memProps = data_->physicalDevice.getMemoryProperties();
+    const auto memFlags = vk::MemoryPropertyFlagBits::eHostVisible |
+                          vk::MemoryPropertyFlagBits::eHostCoherent;
+
+    uint32_t memTypeIndex = memProps.memoryTypeCount;
+    for(uint32_t i = 0; i < memProps.memoryTypeCount; ++i)
+    {
+        if((memReqs.memoryTypeBits & (1u << i)) &&
+           (memProps.memoryTypes[i].propertyFlags & memFlags) == memFlags)
+        {
+            memTypeIndex = i;
+            break;
+        }
+    }
+    if(memTypeIndex == memProps.memoryTypeCount)
+        throw std::runtime_error("no host visible memory for readback");
+
+    auto memory = data_->device.allocateMemoryUnique(
+        vk::MemoryAllocateInfo(memReqs.size, memTypeIndex));
+    data_->device.bindBufferMemory(*buffer, *memory, 0);
+
+    // record copy
+
+    const uint32_t queueFamily =
+        data_->context->getGraphicsDevice().graphicsQueueFamilyIndex();
+    const vk::Queue queue = data_->context->getGraphicsDevice().graphicsQueue();
+
+    auto pool = data_->device.createCommandPoolUnique(vk::CommandPoolCreateInfo(
+        vk::CommandPoolCreateFlagBits::eTransient, queueFamily));
+    auto cmdBufs = data_->device.allocateCommandBuffersUnique(
+        vk::CommandBufferAllocateInfo(
+            *pool, vk::CommandBufferLevel::ePrimary, 1));
+    const vk::CommandBuffer cmd = *cmdBufs[0];
+
+    const vk::ImageSubresourceRange range(
+        vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+
+    cmd.begin(vk::CommandBufferBeginInfo(
+        vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+
+    cmd.pipelineBarrier(
+        vk::PipelineStageFlagBits::eAllCommands,
+        vk::PipelineStageFlagBits::eTransfer,
+        {}, {}, {},
+        vk::ImageMemoryBarrier(
+            vk::AccessFlagBits::eMemoryWrite,
+            vk::AccessFlagBits::eTransferRead,
+            currentLayout,
+            vk::ImageLayout::eTransferSrcOptimal,
+            VK_QUEUE_FAMILY_IGNORED,
+            VK_QUEUE_FAMILY_IGNORED,
+            image, range));
+
+    cmd.copyImageToBuffer(
+        image, vk::ImageLayout::eTransferSrcOptimal, *buffer,
+        vk::BufferImageCopy(
+            0, 0, 0,
+            vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1),
+            vk::Offset3D(0, 0, 0),
+            vk::Extent3D(extent.width, extent.height, 1)));
+
+    cmd.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTransfer,
+        vk::PipelineStageFlagBits::eAllCommands,
+        {}, {},
+        vk::BufferMemoryBarrier(
+            vk::AccessFlagBits::eTransferWrite,
+            vk::AccessFlagBits::eHostRead,
+            VK_QUEUE_FAMILY_IGNORED,
+            VK_QUEUE_FAMILY_IGNORED,
+            *buffer, 0, size),
+        vk::ImageMemoryBarrier(
+            vk::AccessFlagBits::eTransferRead,
+            {},
+            vk::ImageLayout::eTransferSrcOptimal,
+            currentLayout,
+            VK_QUEUE_FAMILY_IGNORED,
+            VK_QUEUE_FAMILY_IGNORED,
+            image, range));
+
+    cmd.end();
+
+    // submit and wait
+
+    queue.waitIdle();
+
+    auto fence = data_->device.createFenceUnique({});
+    queue.submit(vk::SubmitInfo(0, nullptr, nullptr, 1, &cmd), *fence);
+    if(data_->device.waitForFences(
+        *fence, true, UINT64_MAX) != vk::Result::eSuccess)
+        throw std::runtime_error("failed to wait for readback");
+
+    std::vector<uint8_t> result(static_cast<size_t>(size));
+    void *mapped = data_->device.mapMemory(*memory, 0, size);
+    std::memcpy(result.data(), mapped, result.size());
+    data_->device.unmapMemory(*memory);
+
+    return result;
+}
+
 AGZ_VULKAN_LAB_END